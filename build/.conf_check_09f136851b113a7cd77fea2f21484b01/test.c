@@ -0,0 +1,8 @@
+
+		#include <time.h>
+		int main() {
+			struct timespec ts;
+			::clock_gettime(CLOCK_MONOTONIC, &ts);
+			return 0;
+		}
+		
\ No newline at end of file
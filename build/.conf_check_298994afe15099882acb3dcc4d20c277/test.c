@@ -0,0 +1,8 @@
+
+		#include <stdint.h>
+		#include <mach/mach_time.h>
+		int main() {
+			::mach_absolute_time();
+			return 0;
+		}
+		
\ No newline at end of file
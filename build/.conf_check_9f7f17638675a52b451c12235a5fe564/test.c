@@ -0,0 +1,7 @@
+
+		#include <fcntl.h>
+		int main() {
+			::posix_fallocate(0, 0, 0);
+			return 0;
+		}
+		
\ No newline at end of file
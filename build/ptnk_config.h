@@ -0,0 +1,10 @@
+/* WARNING! All changes made to this file will be lost! */
+
+#ifndef _PTNK_CONFIG_H_WAF
+#define _PTNK_CONFIG_H_WAF
+
+#define USE_POSIX_FALLOCATE 1
+#define USE_CLOCK_GETTIME 1
+/* #undef USE_MACH_ABSOLUTE_TIME */
+
+#endif /* _PTNK_CONFIG_H_WAF */
@@ -1,6 +1,9 @@
 #include "ptnk/helperthr.h"
+#include "ptnk/epoch.h"
 
 #include <iostream>
+#include <vector>
+#include <thread>
 #include <unistd.h>
 #include <gtest/gtest.h>
 
@@ -37,3 +40,101 @@ TEST(helperthr, multiple)
 	usleep(100 * 1000);
 	EXPECT_EQ(32, count);
 }
+
+TEST(epoch, retire)
+{
+	EpochManager em;
+
+	// nothing inside -> run immediately
+	int count = 0;
+	em.retire([&count]() mutable { count ++; });
+	EXPECT_EQ(1, count);
+
+	EpochManager::Record* rec1 = em.enter();
+	em.retire([&count]() mutable { count ++; });
+	EXPECT_EQ(1, count) << "retired obj reclaimed while tx entered before is inside";
+	EXPECT_EQ(1U, em.numPending());
+
+	// tx entered after the retirement doesn't block it
+	int count2 = 0;
+	std::thread t([&em, &count, &count2]() mutable {
+		EpochManager::Record* rec2 = em.enter();
+		em.retire([&count2]() mutable { count2 ++; });
+		em.leave(rec2);
+	});
+	t.join();
+	EXPECT_EQ(1, count);
+	EXPECT_EQ(0, count2);
+
+	em.leave(rec1);
+	EXPECT_EQ(2, count);
+	EXPECT_EQ(1, count2);
+	EXPECT_EQ(0U, em.numPending());
+}
+
+TEST(epoch, records_reused)
+{
+	EpochManager em;
+
+	// records of exited thrs are reused by new ones
+	for(int i = 0; i < 16; ++ i)
+	{
+		std::thread t([&em]() {
+			em.leave(em.enter());
+		});
+		t.join();
+	}
+	EXPECT_EQ(1U, em.numRecords());
+
+	// many txs inside at once, across thrs
+	const int NUM_THRS = 4;
+	const int NUM_TXS_PER_THR = 1000;
+	std::vector<EpochManager::Record*> recs;
+	std::mutex mtx;
+	volatile int nDone = 0;
+	std::vector<std::thread> tg;
+	for(int i = 0; i < NUM_THRS; ++ i)
+	{
+		tg.push_back(std::thread([&em, &recs, &mtx, &nDone]() {
+			for(int j = 0; j < NUM_TXS_PER_THR; ++ j)
+			{
+				EpochManager::Record* rec = em.enter();
+				std::lock_guard<std::mutex> g(mtx);
+				recs.push_back(rec);
+			}
+
+			// keep the thr alive until all thrs entered
+			__sync_fetch_and_add(&nDone, 1);
+			while(nDone < NUM_THRS) std::this_thread::yield();
+		}));
+	}
+	for(auto& t: tg) t.join();
+	EXPECT_EQ((size_t)NUM_THRS, em.numRecords());
+
+	int count = 0;
+	em.retire([&count]() { count ++; });
+	for(EpochManager::Record* rec: recs)
+	{
+		EXPECT_EQ(0, count);
+		em.leave(rec);
+	}
+	EXPECT_EQ(1, count);
+}
+
+TEST(epoch, helper)
+{
+	EpochManager em;
+	Helper helper; // destructed before _em_
+	em.attachHelper(&helper);
+
+	volatile bool done = false;
+	EpochManager::Record* rec = em.enter();
+	em.retire([&done]() { done = true; });
+	em.leave(rec);
+
+	usleep(100 * 1000);
+	EXPECT_TRUE(done);
+
+	// synchronize w/o anything inside should not block
+	em.synchronize();
+}
@@ -68,6 +68,28 @@ struct ptnk_tx
 	}
 };
 
+struct ptnk_snapshot
+{
+	//! pointer to C++ impl.
+	ptnk::DB::Snapshot* impl;
+
+	//! error code
+	int ptnk_errno;
+
+	//! buffer used in read operations
+	ptnk::Buffer read_buf;
+
+	ptnk_snapshot(ptnk::DB::Snapshot* impl_)
+	:	impl(impl_),
+		ptnk_errno(0)
+	{ /* NOP */}
+
+	~ptnk_snapshot()
+	{
+		delete impl;
+	}
+};
+
 struct ptnk_cur
 {
 	//! pointer to the C++ impl.
@@ -325,6 +347,19 @@ try
 }
 COMMON_CATCH_BLOCKS(tx)
 
+int
+ptnk_tx_end_async(ptnk_tx_t* tx, ptnk_durable_cb_t cb, void* arg)
+try
+{
+	LOG_OUTF("ptnk_tx_end_async(tx = %p, cb = %p, arg = %p);\n", tx, cb, arg);
+	unique_ptr<ptnk_tx_t> tx_(tx);
+
+	return tx_->impl->tryCommitAsync([cb, arg] (std::exception_ptr err) {
+		cb(arg, err ? 0 : 1);
+	}) ? 1 : 0;
+}
+COMMON_CATCH_BLOCKS(tx)
+
 int
 ptnk_tx_error(ptnk_tx_t* tx)
 {
@@ -494,6 +529,96 @@ try
 }
 COMMON_CATCH_BLOCKS_PTR(tx)
 
+ptnk_snapshot_t*
+ptnk_snapshot_begin(ptnk_db_t* db)
+try
+{
+	LOG_OUTF("ptnk_snapshot_begin(db = %p);\n", db);
+	return new ptnk_snapshot_t(db->impl->newSnapshot());
+}
+COMMON_CATCH_BLOCKS_PTR(db)
+
+void
+ptnk_snapshot_end(ptnk_snapshot_t* ss)
+{
+	LOG_OUTF("ptnk_snapshot_end(ss = %p);\n", ss);
+	delete ss;
+}
+
+int
+ptnk_snapshot_error(ptnk_snapshot_t* ss)
+{
+	return ss->ptnk_errno;
+}
+
+ptnk_datum_t
+ptnk_snapshot_get(ptnk_snapshot_t* ss, ptnk_datum_t key)
+try
+{
+	LOG_OUTF("ptnk_snapshot_get(ss = %p, key = {%p, %u});\n", ss, key.dptr, key.dsize);
+
+	ss->impl->get(datum2CRef(key), &ss->read_buf);
+
+	ptnk_datum_t ret = {ss->read_buf.get(), static_cast<int>(ss->read_buf.valsize())};
+	return ret;
+}
+COMMON_CATCH_BLOCKS_DATUM(ss)
+
+const char*
+ptnk_snapshot_get_cstr(ptnk_snapshot_t* ss, const char* key)
+try
+{
+	LOG_OUTF("ptnk_snapshot_get_cstr(ss = %p, key = %s);\n", ss, key);
+
+	ss->impl->get(ptnk::cstr2ref(key), &ss->read_buf);
+
+	if(ss->read_buf.valsize() >= 0)
+	{
+		ss->read_buf.makeNullTerm();
+		return ss->read_buf.get();
+	}
+	else
+	{
+		return NULL;
+	}
+}
+COMMON_CATCH_BLOCKS_PTR(ss)
+
+ptnk_datum_t
+ptnk_snapshot_table_get(ptnk_snapshot_t* ss, ptnk_table_t* table, ptnk_datum_t key)
+try
+{
+	LOG_OUTF("ptnk_snapshot_table_get(ss = %p, table = %p, key = {%p, %u});\n", ss, table, key.dptr, key.dsize);
+
+	ptnk::TableOffCache* toc = static_cast<ptnk::TableOffCache*>(table);
+	ss->impl->get(toc, datum2CRef(key), &ss->read_buf);
+
+	ptnk_datum_t ret = {ss->read_buf.get(), static_cast<int>(ss->read_buf.valsize())};
+	return ret;
+}
+COMMON_CATCH_BLOCKS_DATUM(ss)
+
+const char*
+ptnk_snapshot_table_get_cstr(ptnk_snapshot_t* ss, ptnk_table_t* table, const char* key)
+try
+{
+	LOG_OUTF("ptnk_snapshot_table_get_cstr(ss = %p, table = %p, key = %s);\n", ss, table, key);
+
+	ptnk::TableOffCache* toc = static_cast<ptnk::TableOffCache*>(table);
+	ss->impl->get(toc, ptnk::cstr2ref(key), &ss->read_buf);
+
+	if(ss->read_buf.valsize() >= 0)
+	{
+		ss->read_buf.makeNullTerm();
+		return ss->read_buf.get();
+	}
+	else
+	{
+		return NULL;
+	}
+}
+COMMON_CATCH_BLOCKS_PTR(ss)
+
 ptnk_cur_t*
 ptnk_cur_front(ptnk_tx_t* tx, ptnk_table_t* table)
 try
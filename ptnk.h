@@ -21,6 +21,7 @@ extern "C" {
 struct ptnk_db;
 typedef struct ptnk_db ptnk_db_t;
 typedef struct ptnk_tx ptnk_tx_t;
+typedef struct ptnk_snapshot ptnk_snapshot_t;
 typedef void ptnk_table_t;
 typedef struct ptnk_cur ptnk_cur_t;
 
@@ -149,6 +150,27 @@ ptnk_tx_t* ptnk_tx_begin(ptnk_db_t* db);
  */
 int ptnk_tx_end(ptnk_tx_t* tx, int commit);
 
+/*! callback notifying that a transaction committed by ptnk_tx_end_async is durable */
+/*!
+ *	@param[in] arg		_arg_ passed to ptnk_tx_end_async
+ *	@param[in] ok		non-zero if the transaction was written to disk, zero if the disk write failed
+ */
+typedef void (*ptnk_durable_cb_t)(void* arg, int ok);
+
+/*! end transaction w/o waiting for the commit to be written to disk */
+/*!
+ *	Returns as soon as the transaction is validated.
+ *	With OAUTOSYNC, the disk write is done in background (on helper thread if OHELPERTHREAD).
+ *
+ *	@param[in] tx		transaction handle. _tx_ is released on return, like ptnk_tx_end does
+ *	@param[in] cb		called once the committed transaction is durable. Not called if the commit failed.
+ *						It may be called from another thread, or before this function returns.
+ *	@param[in] arg		passed to _cb_
+ *
+ *	@return return non-zero if the transaction was successfully committed
+ */
+int ptnk_tx_end_async(ptnk_tx_t* tx, ptnk_durable_cb_t cb, void* arg);
+
 /*! get last error code for tx related op. */
 int ptnk_tx_error(ptnk_tx_t* tx);
 
@@ -264,6 +286,66 @@ ptnk_datum_t ptnk_tx_table_get(ptnk_tx_t* tx, ptnk_table_t* table, ptnk_datum_t
  */
 const char* ptnk_tx_table_get_cstr(ptnk_tx_t* tx, ptnk_table_t* table, const char* key);
 
+/*! begin read-only transaction */
+/*!
+ *	Read-only transactions see a snapshot of committed transactions like ptnk_tx_t does,
+ *	but are much cheaper to begin and end.
+ *
+ *	@return new read-only transaction handle
+ */
+ptnk_snapshot_t* ptnk_snapshot_begin(ptnk_db_t* db);
+
+/*! end read-only transaction */
+/*!
+ *	@param[in] ss		read-only transaction handle
+ */
+void ptnk_snapshot_end(ptnk_snapshot_t* ss);
+
+/*! get last error code for read-only tx related op. */
+int ptnk_snapshot_error(ptnk_snapshot_t* ss);
+
+/*! fetch stored record from snapshot _ss_ */
+/*!
+ *  @param [in] ss		opened read-only transaction handle
+ *	@param [in] key		record key
+ *
+ *	@return fetched record
+ */
+ptnk_datum_t ptnk_snapshot_get(ptnk_snapshot_t* ss, ptnk_datum_t key);
+
+/*! fetch stored string record from snapshot _ss_ */
+/*! 
+ *  @param [in] ss		opened read-only transaction handle
+ *  @param [in] key		record key in null-terminated string
+ *
+ *  @return
+ *		fetched record value string stored in ptnk_snapshot_t internal buffer on success.
+ *		return NULL when the record is not found
+ */
+const char* ptnk_snapshot_get_cstr(ptnk_snapshot_t* ss, const char* key);
+
+/*! fetch stored record from snapshot _ss_ */
+/*!
+ *  @param [in] ss			opened read-only transaction handle
+ *  @param [in,out] table	table offset cache
+ *	@param [in] key			record key
+ *
+ *	@return fetched record
+ */
+ptnk_datum_t ptnk_snapshot_table_get(ptnk_snapshot_t* ss, ptnk_table_t* table, ptnk_datum_t key);
+
+/*! fetch stored string record from snapshot _ss_ */
+/*! 
+ *  @param [in] ss		opened read-only transaction handle
+ *  @param [in,out] table	table offset cache
+ *  @param [in] key		record key in null-terminated string
+ *
+ *  @return
+ *		fetched record value string stored in ptnk_snapshot_t internal buffer on success.
+ *		return NULL when the record is not found
+ */
+const char* ptnk_snapshot_table_get_cstr(ptnk_snapshot_t* ss, ptnk_table_t* table, const char* key);
+
 /*! get cursor pointing to the first record in the table */
 /*!
  *	@param [in] tx		transaction handle. This is required as cursor operations are applied to snapshot specified in the transaction.
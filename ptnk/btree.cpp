@@ -4,6 +4,10 @@
 
 #include <stdio.h>
 
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
 namespace ptnk
 {
 
@@ -80,11 +84,102 @@ btree_split_t::dump()
 }
 
 void
-Node::initBody(page_id_t pgidFirst)
+Node::initBody(page_id_t pgidFirst, BufferCRef prefix)
 {
 	footer().numKeys = 0;
 	footer().sizeFree = BODY_SIZE - sizeof(footer_t) - sizeof(page_id_t) /* ptr_{-1} */;
+	footer().hasPrefix = prefix.size() > 0;
 	ptrm1() = pgidFirst;
+
+	if(footer().hasPrefix)
+	{
+		PTNK_ASSERT(prefix.size() <= 0xff);
+
+		char* p = rawbody() + sizeof(page_id_t);
+		*reinterpret_cast<uint8_t*>(p) = prefix.size();
+		::memcpy(p + 1, prefix.get(), prefix.size());
+		footer().sizeFree -= 1 + prefix.size();
+	}
+}
+
+BufferCRef
+Node::kpsPrefix(const Vkp_t& kps, int b, int e)
+{
+	if(b >= e) return BufferCRef::INVALID_VAL;
+
+	const BufferCRef& first = kps[b].first;
+	size_t len = first.isNull() ? 0 : std::min<size_t>(first.size(), 0xff);
+	for(int i = b+1; i < e && len > 0; ++ i)
+	{
+		len = prefix_len_common(first, kps[i].first, len);
+	}
+
+	// prefix costs its size + 1 byte
+	if((e - b) * len < 1 + len) len = 0;
+
+	return BufferCRef(first.get(), len);
+}
+
+int
+Node::initBodyKPs(const Vkp_t& kps, int b, int e)
+{
+	const size_t sizeBody = BODY_SIZE - sizeof(footer_t) - sizeof(page_id_t) /* ptr_{-1} */;
+
+	// find the longest run of kps(b, i) fitting in the node w/ their common prefix elided (see kpsPrefix())
+	size_t sizeRaw = 0, szPrefix = 0;
+	int i = b + 1;
+	for(; i < e; ++ i)
+	{
+		const BufferCRef& key = kps[i].first;
+		PTNK_ASSERT(! key.isNull());
+
+		const size_t szPrefixNew = (i == b + 1) ? std::min<size_t>(key.size(), 0xff) : prefix_len_common(kps[b+1].first, key, szPrefix);
+		const size_t sizeRawNew = sizeRaw + packedsize(key) + sizeof(page_id_t) + sizeof(uint16_t)*2;
+		const size_t n = i - b;
+		const size_t sizeNew = (n * szPrefixNew < 1 + szPrefixNew) ? sizeRawNew : sizeRawNew - n * szPrefixNew + 1 + szPrefixNew;
+		if(sizeNew > sizeBody) break;
+
+		sizeRaw = sizeRawNew;
+		szPrefix = szPrefixNew;
+	}
+
+	initBody(kps[b].second, kpsPrefix(kps, b + 1, i));
+	for(int j = b + 1; j < i; ++ j)
+	{
+		kp_offset(j - b - 1) = addKP(kps[j]);
+	}
+
+	return i;
+}
+
+bool
+Node::isKeysVerbatim() const
+{
+	if(footer().hasPrefix) return false;
+
+	const int numKeys = footer().numKeys;
+	for(int i = 0; i < numKeys; ++ i)
+	{
+		size_t szPad;
+		kp(i, &szPad);
+		if(szPad > 0) return false;
+	}
+	return true;
+}
+
+bool
+Node::splitSharesPrefix(const btree_split_t& split) const
+{
+	if(! footer().hasPrefix) return true;
+
+	const BufferCRef p = prefix();
+	if(split.keyNew.isValid() && prefix_len_common(p, split.keyNew.rref(), p.size()) != static_cast<size_t>(p.size())) return false;
+	for(unsigned int i = 0; i < split.numSplit; ++ i)
+	{
+		if(prefix_len_common(p, split.split[i].key, p.size()) != static_cast<size_t>(p.size())) return false;
+	}
+
+	return true;
 }
 
 page_id_t
@@ -112,7 +207,7 @@ Node::query(const query_t& query) const
 		}
 	}
 
-	key_idx_comp comp = {this, query.key};
+	key_idx_comp comp = {this, prefixed_key_comp(prefix(), query.key)};
 	int i = idx_lower_bound(0, footer().numKeys, comp);
 	if(query.type == BEFORE)
 	{
@@ -120,9 +215,7 @@ Node::query(const query_t& query) const
 	}
 	else
 	{
-		BufferCRef key; page_id_t _;
-		tie(key, _) = kp(i);
-		if(! bufeq(key, query.key)) -- i;
+		if(comp(i) != 0) -- i;
 	}
 
 	if(i >= 0)
@@ -148,27 +241,44 @@ Node::handleChildSplit(btree_split_t* split, bool* bOvr, PageIO* pio)
 		return handleChildSplitSelfSplit(split, 0, bOvr, pio);
 	}
 
+	if(PTNK_UNLIKELY(! splitSharesPrefix(*split)))
+	{
+		// the prefix needs to be shortened, which involves Node defrag.
+		// (assume no prefix for room check)
+		int sizeFree = footer().sizeFree - prefix().size() * footer().numKeys;
+		for(unsigned int i = 0; i < split->numSplit; ++ i)
+		{
+			sizeFree -= packedsize(split->split[i].key) + sizeof(page_id_t) + sizeof(uint16_t)*2;
+		}
+		return handleChildSplitSelfSplit(split, sizeFree >= 0 ? 0 : BODY_SIZE/2, bOvr, pio);
+	}
+
 	if(PTNK_LIKELY(isRoomForSplitAvailable(*split)))
 	{
 		return handleChildSplitNoSelfSplit(split, bOvr, pio);
 	}
 	else
 	{
-		return handleChildSplitSelfSplit(split, BODY_SIZE/2, bOvr, pio);
+		// the rightmost child splitting is likely an append. leave the old node mostly full,
+		// as no more keys are expected to come in to it
+		const size_t thresSplit = (split->pgidSplit == ptrBack()) ? THRES_SPLIT_APPEND : BODY_SIZE/2;
+		return handleChildSplitSelfSplit(split, thresSplit, bOvr, pio);
 	}
 }
 
 bool
 Node::isRoomForSplitAvailable(const btree_split_t& split) const
 {
+	const int szPrefix = prefix().size();
+
 	int sizeFree = footer().sizeFree;
 	if(split.keyNew.isValid() && ! split.keyNew.isNull())
 	{
-		sizeFree -= split.keyNew.valsize();	
+		sizeFree -= split.keyNew.valsize() - szPrefix;
 	}
 	for(unsigned int i = 0; i < split.numSplit; ++ i)
 	{
-		sizeFree -= packedsize(split.split[i].key) + sizeof(page_id_t) + sizeof(uint16_t)*2;
+		sizeFree -= packedsize(split.split[i].key) - szPrefix + sizeof(page_id_t) + sizeof(uint16_t)*2;
 	}
 	return sizeFree >= 0;
 }
@@ -229,7 +339,7 @@ Node::handleChildSplitSelfSplit(btree_split_t* split, size_t thresSplit, bool* b
 	const int numKeys = footer().numKeys;
 
 	Node ovr(pio->modifyPage(*this, bOvr));
-	if(pageId() != ovr.pageId())
+	if(pageId() != ovr.pageId() && isKeysVerbatim())
 	{
 		// if operation result is to be saved on different page,
 		// the KPs stored on the old page is valid throughout the op
@@ -285,12 +395,14 @@ Node::handleChildSplitSelfSplit(btree_split_t* split, size_t thresSplit, bool* b
 	}
 	else
 	{
-		// if operation is done in-place, we need to keep copy of old kps
+		// if operation is done in-place (or keys need to be restored), we need to keep copy of old kps
 		// the copy is allocated from the stack by alloca
+		const BufferCRef prefixOld = prefix();
 #define ALLOC_COPY_OLDKP(i) \
-		kp_t e = kp(i); \
+		size_t szPad; \
+		kp_t e = kp(i, &szPad); \
 		char *kt = NULL; \
-		if(! e.first.isNull()) { kt = (char*)::alloca(e.first.size()); ::memcpy(kt, e.first.get(), e.first.size()); e.first = BufferCRef(kt, e.first.size()); }
+		if(! e.first.isNull()) { const size_t sz = prefixOld.size() + e.first.size() + szPad; kt = (char*)::alloca(sz); ::memcpy(kt, prefixOld.get(), prefixOld.size()); ::memcpy(kt + prefixOld.size(), e.first.get(), e.first.size()); ::memset(kt + sz - szPad, 0, szPad); e.first = BufferCRef(kt, sz); }
 
 		int i = 0;
 		if(pgidSplit != ptrm1_)
@@ -352,21 +464,36 @@ Node::handleChildSplitSelfSplit(btree_split_t* split, size_t thresSplit, bool* b
 	Node ret = Node(pio->readPage(pageOrigId())); // Node pg carrying split->pgidFollow
 
 	// set up old node
-	ovr.initBody(ptrm1_);
+	BufferCRef prefixNew = kpsPrefix(kps, 0, iE);
+	ovr.initBody(ptrm1_, prefixNew);
 	for(; i < iE; ++ i)
 	{
-		if(ovr.footer().sizeFree + packedsize(kps[i].first) + sizeof(page_id_t) + sizeof(uint16_t)*2 < thresSplit) break;
+		if(ovr.footer().sizeFree < packedsize(kps[i].first) - prefixNew.size() + sizeof(page_id_t) + sizeof(uint16_t)*2 + thresSplit) break;
 
 		ovr.kp_offset(i) = ovr.addKP(kps[i]);
 	}
-	pio->sync(ovr);
 	if(i == iE)
 	{
+		pio->sync(ovr);
+
 		// all kps stored into old node...
 
 		// split was actually not needed!
 		return ret;
 	}
+	{
+		// kps left in old node may share longer prefix
+		BufferCRef prefixOld = kpsPrefix(kps, 0, i);
+		if(prefixOld.size() > prefixNew.size())
+		{
+			ovr.initBody(ptrm1_, prefixOld);
+			for(int j = 0; j < i; ++ j)
+			{
+				ovr.kp_offset(j) = ovr.addKP(kps[j]);
+			}
+		}
+	}
+	pio->sync(ovr);
 
 	Node newNode = pio->newInitPage<Node>();
 
@@ -377,7 +504,7 @@ Node::handleChildSplitSelfSplit(btree_split_t* split, size_t thresSplit, bool* b
 		split->pgidSplit = pageOrigId();
 		split->addSplit(kp.first, newNode.pageId());
 
-		newNode.initBody(kp.second);
+		newNode.initBody(kp.second, kpsPrefix(kps, i, iE));
 	}
 
 	if(iFollow >= i)
@@ -417,7 +544,7 @@ Node::handleChildDel(page_id_t* pgidNextChild, page_id_t pgid, bool* bOvr, PageI
 	// find the old child page & copy kps
 	std::vector<kp_t> kps; kps.reserve(512);
 
-	if(pageId() != ovr.pageId())
+	if(pageId() != ovr.pageId() && isKeysVerbatim())
 	{
 		// if operation result is to be saved on different page,
 		// the KPs stored on the old page is valid throughout the op
@@ -458,12 +585,14 @@ Node::handleChildDel(page_id_t* pgidNextChild, page_id_t pgid, bool* bOvr, PageI
 	}
 	else
 	{
-		// if operation is done in-place, we need to keep copy of old kps
+		// if operation is done in-place (or keys need to be restored), we need to keep copy of old kps
 		// the copy is allocated from the stack by alloca
+		const BufferCRef prefixOld = prefix();
 #define ALLOC_COPY_OLDKP(i) \
-		kp_t e = kp(i); \
+		size_t szPad; \
+		kp_t e = kp(i, &szPad); \
 		char *kt = NULL; \
-		if(! e.first.isNull()) { kt = (char*)::alloca(e.first.size()); ::memcpy(kt, e.first.get(), e.first.size()); e.first = BufferCRef(kt, e.first.size()); }
+		if(! e.first.isNull()) { const size_t sz = prefixOld.size() + e.first.size() + szPad; kt = (char*)::alloca(sz); ::memcpy(kt, prefixOld.get(), prefixOld.size()); ::memcpy(kt + prefixOld.size(), e.first.get(), e.first.size()); ::memset(kt + sz - szPad, 0, szPad); e.first = BufferCRef(kt, sz); }
 
 		if(pgid == ptrm1_)
 		{
@@ -504,8 +633,8 @@ Node::handleChildDel(page_id_t* pgidNextChild, page_id_t pgid, bool* bOvr, PageI
 	}
 
 	// put kps back to the node
-	ovr.initBody(ptrm1_);
 	int i, iM = kps.size();
+	ovr.initBody(ptrm1_, kpsPrefix(kps, 0, iM));
 	for(i = 0; i < iM; ++ i)
 	{
 		ovr.kp_offset(i) = ovr.addKP(kps[i]);
@@ -617,7 +746,7 @@ void
 Node::dump_(PageIO* pio) const
 {
 	dumpHeader();
-	std::cout << "- Node <numKeys: " << footer().numKeys << ", sizeFree: " << footer().sizeFree << ">" << std::endl;
+	std::cout << "- Node <numKeys: " << footer().numKeys << ", sizeFree: " << footer().sizeFree << ", prefix: " << prefix().inspect() << ">" << std::endl;
 
 	std::string out1("  "), out2("  ");
 	out1 +=      " |*|";
@@ -625,11 +754,13 @@ Node::dump_(PageIO* pio) const
 	unsigned int i, numKeys = footer().numKeys;
 	for(i = 0; i < numKeys; ++ i)
 	{
-		BufferCRef k; page_id_t p;
-		tie(k, p) = kp(i);
+		size_t szPad;
+		kp_t e = kp(i, &szPad);
 
-		out1 += k.inspect(); out1 += "  |*|";
-		out2 += "    "; out2 += pgid2str(p);
+		out1 += e.first.inspect();
+		if(szPad > 0) { char buf[16]; sprintf(buf, "+%uz", (unsigned int)szPad); out1 += buf; }
+		out1 += "  |*|";
+		out2 += "    "; out2 += pgid2str(e.second);
 	}
 	puts(out1.c_str()); puts(out2.c_str());
 	puts("");
@@ -730,6 +861,41 @@ Node::dumpGraph_(FILE* fp, PageIO* pio) const
 	}
 }
 
+void
+Node::stat_(btree_stat_t* stat, int lvl, PageIO* pio) const
+{
+	++ stat->numNodes;
+	if(stat->height < lvl + 1) stat->height = lvl + 1;
+
+	const int numKeys = footer().numKeys;
+	for(int i = -1; i < numKeys; ++ i)
+	{
+		Page pg(pio->readPage(i < 0 ? ptrm1() : ptr(i)));
+		switch(pg.pageType())
+		{
+		case PT_NODE:
+			Node(pg).stat_(stat, lvl + 1, pio);
+			break;
+
+		case PT_LEAF:
+			++ stat->numLeaves;
+			stat->sizeFreeLeaves += Leaf(pg).sizeFree();
+			break;
+
+		default:
+			++ stat->numDupKeyTrees;
+			break;
+		}
+	}
+}
+
+void
+btree_stat(page_id_t idRoot, btree_stat_t* stat, PageIO* pio)
+{
+	*stat = btree_stat_t();
+	Node(pio->readPage(idRoot)).stat_(stat, 1, pio);
+}
+
 bool
 Node::refreshAllLeafPages_(void** cursor, page_id_t threshold, int numPages, PageIO* pio) const
 {
@@ -787,7 +953,7 @@ Node::refreshAllLeafPages_(void** cursor, page_id_t threshold, int numPages, Pag
 
 	if(bc.leaf.isValid())
 	{
-		*bufKeyResume = Leaf(bc.leaf).keyFirst();
+		Leaf(bc.leaf).keyFirst(bufKeyResume);
 	}
 	else
 	{
@@ -820,6 +986,110 @@ static Page::dyndispatcher_t g_leaf_handlers =
 
 Page::register_dyndispatcher g_leaf_reg(PT_LEAF, &g_leaf_handlers);
 
+//! find [*lo, *hi) range of _fp_ in the sorted fingerprint array _fps_[0, _n_)
+/*!
+ *	The array is scanned from the front w/ SIMD compares, counting the fingerprints less than / equal to _fp_.
+ *	The scan stops at the first block containing greater fingerprint as all the rest are greater too.
+ */
+inline
+void
+fp_equal_range(const int32_t* fps, int n, int32_t fp, int* lo, int* hi)
+{
+	int i = 0, nLess = 0, nEq = 0;
+#if defined(__AVX2__)
+	const __m256i vfp = _mm256_set1_epi32(fp);
+	for(; i + 8 <= n; i += 8)
+	{
+		const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(fps + i));
+		const unsigned int mLess = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(vfp, v)));
+		const unsigned int mEq = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(vfp, v)));
+		nLess += __builtin_popcount(mLess);
+		nEq += __builtin_popcount(mEq);
+		if((mLess | mEq) != 0xff) goto done;
+	}
+#elif defined(__SSE2__)
+	const __m128i vfp = _mm_set1_epi32(fp);
+	for(; i + 4 <= n; i += 4)
+	{
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(fps + i));
+		const unsigned int mLess = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(vfp, v)));
+		const unsigned int mEq = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(vfp, v)));
+		nLess += __builtin_popcount(mLess);
+		nEq += __builtin_popcount(mEq);
+		if((mLess | mEq) != 0xf) goto done;
+	}
+#endif
+	for(; i < n; ++ i)
+	{
+		if(fps[i] < fp)
+		{
+			++ nLess;
+		}
+		else if(fps[i] == fp)
+		{
+			++ nEq;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+done:
+#endif
+	*lo = nLess;
+	*hi = nLess + nEq;
+}
+
+//! bufcpy() for keys stored as (page prefix, suffix)
+inline
+size_t
+keycpy(BufferRef dest, BufferCRef prefix, BufferCRef suffix)
+{
+	if(prefix.size() == 0) return bufcpy(dest, suffix);
+
+	size_t size = bufcpy(dest, prefix);
+	if(size < static_cast<size_t>(dest.size()))
+	{
+		size += bufcpy(BufferRef(dest.get() + size, dest.size() - size), suffix);
+	}
+	return size;
+}
+
+//! shortest separator key _sep_ s.t. _left_ < _sep_ <= _right_
+/*!
+ *	bufcmp orders keys by size first, so _sep_ can't be shorter than _left_.
+ *	Instead, _sep_ takes as few leading bytes of _right_ as possible and is zero-filled after that,
+ *	as Node elides trailing zero bytes of its keys.
+ *
+ *	@param [out] buf
+ *		buffer of _right_.size() bytes to hold _sep_
+ */
+BufferCRef
+key_separator(BufferCRef left, BufferCRef right, char* buf)
+{
+	PTNK_ASSERT(bufcmp(left, right) < 0);
+
+	// NULL key is the smallest
+	if(left.isNull()) return BufferCRef(buf, 0);
+
+	if(left.size() < right.size())
+	{
+		// any key longer than _left_ will do
+		const size_t sz = left.size() + 1;
+		::memset(buf, 0, sz);
+		return BufferCRef(buf, sz);
+	}
+
+	// copy _right_ up to the first byte differing from _left_
+	const size_t sz = right.size();
+	size_t i = prefix_len_common(left, right, sz) + 1;
+	::memcpy(buf, right.get(), i);
+	::memset(buf + i, 0, sz - i);
+	return BufferCRef(buf, sz);
+}
+
 } // end of anonymous namespace
 
 void
@@ -835,6 +1105,91 @@ Leaf::initBody()
 {
 	footer().numKVs = 0;
 	footer().sizeFree = BODY_SIZE - sizeof(footer_t);
+	footer().hasPrefix = 0;
+	footer().reserved = 0;
+	footer().hasFP = PTNK_LEAF_FINGERPRINT;
+	static_assert(sizeof(footer_t) == 3, "layout flags must fit in the bits unused by sizeFree");
+}
+
+int32_t
+Leaf::fingerprint(BufferCRef suffix, size_t szPrefix)
+{
+	uint32_t fp = 0; // NULL key is the smallest
+	if(! suffix.isNull())
+	{
+		// bufcmp orders keys by size first
+		const size_t sz = szPrefix + suffix.size();
+		if(PTNK_UNLIKELY(sz >= 0xfe))
+		{
+			// keys in the saturated size bucket may differ in size. leave them all tied (full compare decides)
+			fp = 0xffu << 24;
+		}
+		else
+		{
+			fp = (sz + 1) << 24;
+
+			const size_t szS = suffix.size();
+			const uint8_t* p = reinterpret_cast<const uint8_t*>(suffix.get());
+			if(szS > 0) fp |= p[0] << 16;
+			if(szS > 1) fp |= p[1] << 8;
+			if(szS > 2) fp |= p[2];
+		}
+	}
+
+	// flip the sign bit so that fingerprints can be compared as signed ints
+	return static_cast<int32_t>(fp ^ 0x80000000);
+}
+
+void
+Leaf::insertSlot(int new_i, uint16_t kvo, int32_t fp)
+{
+	const int n = footer().numKVs; // includes the new record
+
+	if(footer().hasFP)
+	{
+		// fingerprint array moves down by one slot as numKVs grew
+		int32_t* fpsNew = fps();
+		const int32_t* fpsOld = reinterpret_cast<const int32_t*>(reinterpret_cast<char*>(fpsNew) + slotSize());
+		::memmove(fpsNew, fpsOld, sizeof(int32_t)*new_i);
+		::memmove(fpsNew + new_i + 1, fpsOld + new_i, sizeof(int32_t)*(n - 1 - new_i));
+		fpsNew[new_i] = fp;
+	}
+
+	// shift kvs after
+	for(int j = n-1; j > new_i; -- j)
+	{
+		kv_offset(j) = kv_offset(j-1);
+	}
+
+	kv_offset(new_i) = kvo;
+}
+
+void
+Leaf::buildFPs()
+{
+	if(! footer().hasFP) return;
+
+	int32_t* p = fps();
+	int32_t fp = 0;
+	const int n = footer().numKVs;
+	const size_t szPrefix = prefix().size();
+	for(int i = 0; i < n; ++ i)
+	{
+		uint16_t kvo = kv_offset(i);
+		if(! (kvo & VALUE_ONLY))
+		{
+			const packedkv_t* kv = reinterpret_cast<const packedkv_t*>(rawbody() + kvo);
+			if(PTNK_UNLIKELY(kv->szKey == NULL_TAG))
+			{
+				fp = fingerprint(BufferCRef::NULL_VAL);
+			}
+			else
+			{
+				fp = fingerprint(BufferCRef(kv->offset, kv->szKey), szPrefix);
+			}
+		}
+		p[i] = fp;
+	}
 }
 
 // #define VERBOSE_IDX
@@ -847,6 +1202,14 @@ Leaf::idx_lower_bound(int b, int e, BufferCRef key) const
 #endif
 	int d = e - b, d2, ms, m, diff;
 	bool isExact = false;
+	const prefixed_key_comp comp(prefix(), key);
+	if(footer().hasFP && d > 0 && comp.sharesPrefix())
+	{
+		// only records w/ the same fingerprint need full key comparison
+		int lo, hi;
+		fp_equal_range(fps() + b, d, fingerprint(comp.keySuffix, comp.szPrefix), &lo, &hi);
+		b += lo; d = hi - lo;
+	}
 	while(d > 0)
 	{
 #ifdef VERBOSE_IDX
@@ -886,7 +1249,7 @@ Leaf::idx_lower_bound(int b, int e, BufferCRef key) const
 			keyref = BufferCRef(kv->offset, kv->szKey);
 		}
 		
-		diff = bufcmp(keyref, key);
+		diff = comp(keyref);
 #ifdef VERBOSE_IDX
 		std::cout << "bufcmp " << keyref << " and " << key << " => " << diff << std::endl;
 #endif
@@ -902,7 +1265,7 @@ Leaf::idx_lower_bound(int b, int e, BufferCRef key) const
 				{
 					++ b;
 				}
-				while(kv_offset(b) & VALUE_ONLY);
+				while(b < ee && (kv_offset(b) & VALUE_ONLY));
 			}
 			else
 			{
@@ -930,6 +1293,14 @@ Leaf::idx_upper_bound(int b, int e, BufferCRef key) const
 #endif
 	int d = e - b, d2, ms, m, diff;
 	bool foundExact = false;
+	const prefixed_key_comp comp(prefix(), key);
+	if(footer().hasFP && d > 0 && comp.sharesPrefix())
+	{
+		// only records w/ the same fingerprint need full key comparison
+		int lo, hi;
+		fp_equal_range(fps() + b, d, fingerprint(comp.keySuffix, comp.szPrefix), &lo, &hi);
+		b += lo; d = hi - lo;
+	}
 	while(d > 0)
 	{
 #ifdef VERBOSE_IDX
@@ -969,7 +1340,7 @@ Leaf::idx_upper_bound(int b, int e, BufferCRef key) const
 			keyref = BufferCRef(kv->offset, kv->szKey);
 		}
 		
-		diff = bufcmp(keyref, key);
+		diff = comp(keyref);
 #ifdef VERBOSE_IDX
 		std::cout << "bufcmp " << keyref << " and " << key << " => " << diff << std::endl;
 #endif
@@ -985,7 +1356,7 @@ Leaf::idx_upper_bound(int b, int e, BufferCRef key) const
 				{
 					++ b;
 				}
-				while(kv_offset(b) & VALUE_ONLY);
+				while(b < ee && (kv_offset(b) & VALUE_ONLY));
 			}
 			else
 			{
@@ -1005,8 +1376,8 @@ Leaf::idx_upper_bound(int b, int e, BufferCRef key) const
 	return make_pair(b, foundExact);
 }
 
-BufferCRef
-Leaf::keyFirst() const
+void
+Leaf::keyFirst(Buffer* key) const
 {
 	uint16_t kvo = kv_offset(0);
 	PTNK_ASSERT(! (kvo & VALUE_ONLY));
@@ -1014,12 +1385,49 @@ Leaf::keyFirst() const
 	const packedkv_t* kv = reinterpret_cast<const packedkv_t*>(rawbody() + kvo);
 	if(PTNK_UNLIKELY(kv->szKey == NULL_TAG))
 	{
-		return BufferCRef::NULL_VAL;
+		*key = BufferCRef::NULL_VAL;
 	}
 	else
 	{
-		return BufferCRef(kv->offset, kv->szKey);	
+		*key = prefix();
+		key->append(BufferCRef(kv->offset, kv->szKey));
+	}
+}
+
+bool
+Leaf::isKeyAfterLast(BufferCRef key) const
+{
+	int i = numKVs() - 1;
+	if(i < 0) return true;
+
+	uint16_t kvo;
+	while((kvo = kv_offset(i)) & VALUE_ONLY)
+	{
+		-- i;
+	}
+
+	const packedkv_t* kv = reinterpret_cast<const packedkv_t*>(rawbody() + kvo);
+	if(PTNK_UNLIKELY(kv->szKey == NULL_TAG))
+	{
+		return bufcmp(BufferCRef::NULL_VAL, key) < 0;
 	}
+
+	prefixed_key_comp comp(prefix(), key);
+	return comp(BufferCRef(kv->offset, kv->szKey)) < 0;
+}
+
+BufferCRef
+Leaf::keyCopy(const packedkv_t* kv, char** tmpbuf) const
+{
+	if(PTNK_UNLIKELY(kv->szKey == NULL_TAG)) return BufferCRef::NULL_VAL;
+
+	const BufferCRef p = prefix();
+	char* k = *tmpbuf;
+	::memcpy(k, p.get(), p.size());
+	::memcpy(k + p.size(), kv->offset, kv->szKey);
+	*tmpbuf += p.size() + kv->szKey;
+
+	return BufferCRef(k, p.size() + kv->szKey);
 }
 
 void
@@ -1189,7 +1597,7 @@ Leaf::cursorGet(BufferRef key, ssize_t* szKey, BufferRef value, ssize_t* szValue
 		else
 		{
 			packedszKey = kv->szKey;
-			if(szKey) { *szKey = bufcpy(key, BufferCRef(kv->offset, packedszKey)); }
+			if(szKey) { *szKey = keycpy(key, prefix(), BufferCRef(kv->offset, packedszKey)); }
 		}
 
 		if(szValue)
@@ -1235,7 +1643,7 @@ Leaf::cursorGet(BufferRef key, ssize_t* szKey, BufferRef value, ssize_t* szValue
 			}
 			else
 			{
-				*szKey = bufcpy(key, BufferCRef(kv->offset, kv->szKey));
+				*szKey = keycpy(key, prefix(), BufferCRef(kv->offset, kv->szKey));
 			}
 		}
 	}
@@ -1321,7 +1729,7 @@ Leaf::isRoomForKVAvailable(BufferCRef key, BufferCRef value) const
 	if(footer().numKVs == 255) return false;
 
 	int sizeFree = footer().sizeFree;
-	sizeFree -= packedsize(key) + packedsize(value) + sizeof(uint16_t)*3;
+	sizeFree -= packedsize(key) - prefix().size() + packedsize(value) + sizeof(uint16_t)*2 + slotSize();
 	return sizeFree >= 0;
 }
 
@@ -1334,7 +1742,7 @@ Leaf::isRoomForVAvailable(BufferCRef value) const
 	if(footer().numKVs == 255) return false;
 
 	int sizeFree = footer().sizeFree;
-	sizeFree -= packedsize(value) + sizeof(uint16_t)*3;
+	sizeFree -= packedsize(value) + sizeof(uint16_t) + slotSize();
 	return sizeFree >= 0;
 }
 
@@ -1370,14 +1778,8 @@ Leaf::insert(BufferCRef key, BufferCRef value, btree_split_t* split, bool* bOvr,
 			// new value-only record fit in this leaf
 
 			uint16_t newv_offset = ovr.addV(value) + VALUE_ONLY;
-
-			// shift kvs after
-			for(int j = ovr.numKVs()-1; j > new_i; -- j)
-			{
-				ovr.kv_offset(j) = kv_offset(j-1);
-			}
-
-			ovr.kv_offset(new_i) = newv_offset;
+			const prefixed_key_comp comp(prefix(), key);
+			ovr.insertSlot(new_i, newv_offset, fingerprint(comp.keySuffix, comp.szPrefix));
 
 			split->reset();
 		}
@@ -1390,7 +1792,7 @@ Leaf::insert(BufferCRef key, BufferCRef value, btree_split_t* split, bool* bOvr,
 			std::cout << "insertSplit happened at k " << key.inspect() << " v " << value.inspect() << std::endl;
 		#endif
 
-			char tmpbuf[BODY_SIZE];
+			char tmpbuf[TMPBUF_SIZE];
 			VKV kvs; kvs.reserve(numKVs() + 1);
 			#ifdef FIXME_REF
 			if(*bOvr)
@@ -1415,45 +1817,60 @@ Leaf::insert(BufferCRef key, BufferCRef value, btree_split_t* split, bool* bOvr,
 void
 Leaf::insertIdxNoExact(Leaf ovr, int new_i, BufferCRef key, BufferCRef value, btree_split_t* split, PageIO* pio)
 {
+	const prefixed_key_comp comp(prefix(), key);
+	if(PTNK_UNLIKELY(! comp.sharesPrefix()))
+	{
+		insertRepack(ovr, new_i, key, value, split, pio);
+		return;
+	}
+
 	if(PTNK_LIKELY(isRoomForKVAvailable(key, value)))
 	{
 		// new kv fit in this leaf...
 		// no need to split
 
 		uint16_t newkv_offset = ovr.addKV(key, value);
-		
-		// shift kvs after
-		for(int j = ovr.numKVs()-1; j > new_i; -- j)
-		{
-			ovr.kv_offset(j) = ovr.kv_offset(j-1);
-		}
-
-		ovr.kv_offset(new_i) = newkv_offset;
+		ovr.insertSlot(new_i, newkv_offset, fingerprint(comp.keySuffix, comp.szPrefix));
 
 		split->reset();
 	}
 	else
 	{
 		// no room for new kv
-		
-		// need to split
+
+		// need to repack w/ longer prefix, or split
 	#ifdef VERBOSE_LEAF_SPLIT
 		std::cout << "insertSplit happened at k " << key.inspect() << " v " << value.inspect() << std::endl;
 	#endif
 
-		char tmpbuf[BODY_SIZE];
-		VKV kvs; kvs.reserve(numKVs() + 1);
-		#ifdef FIXME_REF
-		if(mod->isValid())
-		{
-			kvsRefInsert(kvs, key, value, new_i);
-		}
-		else
-		#endif
-		{
-			kvsCopyInsert(kvs, key, value, new_i, tmpbuf);
-		}
+		insertRepack(ovr, new_i, key, value, split, pio);
+	}
+}
+
+void
+Leaf::insertRepack(Leaf ovr, int new_i, BufferCRef key, BufferCRef value, btree_split_t* split, PageIO* pio)
+{
+	char tmpbuf[TMPBUF_SIZE];
+	VKV kvs; kvs.reserve(numKVs() + 1);
+	kvsCopyInsert(kvs, key, value, new_i, tmpbuf);
+
+	// check if kvs fit in this leaf w/ their common prefix elided
+	size_t nKeys;
+	const size_t szPrefix = kvsPrefixSize(kvs, &nKeys);
+	size_t sizeNeeded = szPrefix > 0 ? 1 + szPrefix : 0;
+	for(const KV& kv: kvs)
+	{
+		sizeNeeded += kv.second.packedsize() + sizeof(uint16_t) + slotSize();
+		if(kv.first.isValid()) sizeNeeded += kv.first.packedsize() - szPrefix + sizeof(uint16_t);
+	}
 
+	if(kvs.size() <= MAX_NUM_KVS && sizeNeeded <= BODY_SIZE - sizeof(footer_t))
+	{
+		ovr.fillKVs(kvs);
+		split->reset();
+	}
+	else
+	{
 		// if bulk insert, split at last
 		size_t thresSplit = (numKVs() == new_i) ? 0 : BODY_SIZE/2;
 		doSplit(kvs, ovr, thresSplit, split, pio);
@@ -1535,7 +1952,7 @@ Leaf::updateIdx(Leaf ovr, int i, BufferCRef value, btree_split_t* split, PageIO*
 	}
 
 	// prepare kvs for strategy 2 or 3
-	char tmpbuf[BODY_SIZE];
+	char tmpbuf[TMPBUF_SIZE];
 	VKV kvs;
 	#ifdef FIXME_REF
 	if(mod->isValid())
@@ -1603,7 +2020,7 @@ Leaf::cursorDelete(btree_cursor_t* cur, bool* bOvr, PageIO* pio)
 
 	Leaf ovr(pio->modifyPage(*this, bOvr));
 
-	char tmpbuf[BODY_SIZE];
+	char tmpbuf[TMPBUF_SIZE];
 	VKV kvs;
 	#ifdef FIXME_REF
 	if(mod->isValid())
@@ -1673,20 +2090,8 @@ Leaf::kvsCopy(VKV& kvs, int b, int e, BufferCRef* keyLast, char** tmpbuf) const
 		else
 		{
 			const packedkv_t* kv = reinterpret_cast<const packedkv_t*>(rawbody() + kvo);
-			size_t packedszKey;
-			if(PTNK_UNLIKELY(kv->szKey == NULL_TAG))
-			{
-				packedszKey = 0;
-				ki = BufferCRef::NULL_VAL;
-			}
-			else
-			{
-				packedszKey = kv->szKey;
-
-				::memcpy(*tmpbuf, kv->offset, kv->szKey);
-				ki = BufferCRef(*tmpbuf, kv->szKey);
-				*tmpbuf += kv->szKey;
-			}
+			size_t packedszKey = kv->szKey == NULL_TAG ? 0 : kv->szKey;
+			ki = keyCopy(kv, tmpbuf);
 
 			if(i == b && bufeq(*keyLast, ki))
 			{
@@ -1758,21 +2163,7 @@ Leaf::kvsCopyButIdx(VKV& kvs, int idx, char* tmpbuf) const
 		//      ^
 		//      \- key added to previous value only record
 
-		BufferCRef keyAtIdx(false);
-		{
-			const packedkv_t* kv = reinterpret_cast<const packedkv_t*>(rawbody() + kvo);
-
-			if(PTNK_UNLIKELY(kv->szKey == NULL_TAG))
-			{
-				keyAtIdx = BufferCRef::NULL_VAL;
-			}
-			else
-			{
-				::memcpy(tmpbuf, kv->offset, kv->szKey);
-				keyAtIdx = BufferCRef(tmpbuf, kv->szKey);
-				tmpbuf += kv->szKey;
-			}
-		}
+		BufferCRef keyAtIdx = keyCopy(reinterpret_cast<const packedkv_t*>(rawbody() + kvo), &tmpbuf);
 
 		BufferCRef valNext(false);
 		{
@@ -1810,8 +2201,46 @@ Leaf::kvsCopyInsert(VKV& kvs, BufferCRef key, BufferCRef value, int new_i, char*
 void
 Leaf::doDefrag(const VKV& kvs, Leaf ovr, PageIO* pio)
 {
-	ovr.footer().numKVs = 0;
-	ovr.footer().sizeFree = BODY_SIZE - sizeof(footer_t);
+	ovr.fillKVs(kvs);
+
+	pio->sync(ovr);
+}
+
+size_t
+Leaf::kvsPrefixSize(const VKV& kvs, size_t* nKeys)
+{
+	PTNK_ASSERT(kvs.empty() || kvs[0].first.isValid());
+
+	size_t len = 0;
+	*nKeys = 0;
+	for(const KV& kv: kvs)
+	{
+		if(! kv.first.isValid()) continue; // value-only record
+
+		if((*nKeys)++ == 0)
+		{
+			len = kv.first.isNull() ? 0 : std::min<size_t>(kv.first.size(), PREFIX_MAX);
+		}
+		else if(len > 0)
+		{
+			len = prefix_len_common(kvs[0].first, kv.first, len);
+		}
+	}
+
+	// prefix costs its size + 1 byte
+	return (*nKeys * len < 1 + len) ? 0 : len;
+}
+
+void
+Leaf::fillKVs(const VKV& kvs)
+{
+	size_t nKeys;
+	const size_t len = kvsPrefixSize(kvs, &nKeys);
+
+	footer().numKVs = 0;
+	footer().sizeFree = BODY_SIZE - sizeof(footer_t);
+	footer().hasPrefix = 0;
+	if(len > 0) setPrefix(BufferCRef(kvs[0].first.get(), len));
 
 	const int iE = kvs.size();
 	for(int i = 0; i < iE; ++ i)
@@ -1819,15 +2248,51 @@ Leaf::doDefrag(const VKV& kvs, Leaf ovr, PageIO* pio)
 		const KV& kv = kvs[i];
 		if(kv.first.isValid())
 		{
-			ovr.kv_offset(i) = ovr.addKV(kv);
+			kv_offset(i) = addKV(kv);
 		}
 		else
 		{
-			ovr.kv_offset(i) = ovr.addV(kv.second) + VALUE_ONLY;	
+			kv_offset(i) = addV(kv.second) + VALUE_ONLY;	
 		}
 	}
+	buildFPs();
+}
 
-	pio->sync(ovr);
+int
+Leaf::numKVsFit(const VKV& kvs, int b, int e) const
+{
+	const size_t szSlot = slotSize();
+	const size_t sizeBody = BODY_SIZE - sizeof(footer_t);
+
+	size_t sizeRaw = 0, nKeys = 0, szPrefix = 0;
+	int i = b;
+	for(; i < e && i - b < MAX_NUM_KVS; ++ i)
+	{
+		const KV& r = kvs[i];
+		size_t packedsize = r.second.packedsize() + sizeof(uint16_t) + szSlot;
+		size_t szPrefixNew = szPrefix;
+		if(r.first.isValid())
+		{
+			// regular key-value record
+			packedsize += r.first.packedsize() + sizeof(uint16_t);
+			if(nKeys == 0)
+			{
+				szPrefixNew = r.first.isNull() ? 0 : std::min<size_t>(r.first.size(), PREFIX_MAX);
+			}
+			else
+			{
+				szPrefixNew = prefix_len_common(kvs[b].first, r.first, szPrefix);
+			}
+		}
+
+		if(kvsPackedSize(sizeRaw + packedsize, nKeys + (r.first.isValid() ? 1 : 0), szPrefixNew) > sizeBody) break;
+
+		sizeRaw += packedsize;
+		if(r.first.isValid()) ++ nKeys;
+		szPrefix = szPrefixNew;
+	}
+
+	return i - b;
 }
 
 // #define VERBOSE_SPLIT
@@ -1842,10 +2307,20 @@ Leaf::doSplit(const VKV& kvs, Leaf ovr, size_t thresSplit, btree_split_t* split,
 	Leaf active;
 	bool oldUsed = false; // flag which is set true when ovr leaf has been used
 
-	int iLeaf = 0;
+	// new leaves inherit the layout of the leaf split
+	const size_t szSlot = ovr.slotSize();
+	const size_t sizeBody = BODY_SIZE - sizeof(footer_t);
+
+	// kvs[iLeafS, iKeyS) are to be filled in _active_ leaf,
+	// which takes kvsPackedSize(sizeRaw, nKeysLeaf, szPrefix) bytes w/ prefix elided (see fillKVs())
+	int iLeafS = 0;
+	size_t sizeRaw = 0, nKeysLeaf = 0, szPrefix = 0;
+
+	BufferCRef keyLast(false); // key of the last kv record added
+	char bufSep[BODY_SIZE];
+
 	int iKeyS = 0;
 	const int iE = static_cast<int>(kvs.size());
-	size_t sizeFree = 0;
 	while(iKeyS < iE)
 	{
 		size_t packedsize = 0;
@@ -1854,7 +2329,7 @@ Leaf::doSplit(const VKV& kvs, Leaf ovr, size_t thresSplit, btree_split_t* split,
 			const KV& r = kvs[iKeyS];
 
 			// regular key-value record
-			packedsize += r.first.packedsize() + r.second.packedsize() + sizeof(uint16_t)*3;
+			packedsize += r.first.packedsize() + r.second.packedsize() + sizeof(uint16_t)*2 + szSlot;
 		}
 		int iKeyE = iKeyS+1;
 		while(iKeyE < iE)
@@ -1863,20 +2338,36 @@ Leaf::doSplit(const VKV& kvs, Leaf ovr, size_t thresSplit, btree_split_t* split,
 			if(r.first.isValid()) break;
 
 			// value-only record
-			packedsize += r.second.packedsize() + sizeof(uint16_t)*2;
+			packedsize += r.second.packedsize() + sizeof(uint16_t) + szSlot;
 
 			++ iKeyE;
 		}
-		int nKeys = iKeyE - iKeyS;
+
+		bool bFit = false;
+		size_t szPrefixNew = 0;
+		if(active.isValid())
+		{
+			szPrefixNew = prefix_len_common(kvs[iLeafS].first, key, szPrefix);
+
+			bFit = kvsPackedSize(sizeRaw, nKeysLeaf, szPrefix) + thresSplit <= sizeBody
+				&& kvsPackedSize(sizeRaw + packedsize, nKeysLeaf + 1, szPrefixNew) <= sizeBody
+				&& iKeyE - iLeafS <= MAX_NUM_KVS;
+		}
 
 	#ifdef VERBOSE_SPLIT
 		std::cout << "key: " << key << std::endl;
 		std::cout << "iks: " << iKeyS << " e: " << iKeyE << std::endl;
-		std::cout << "packedsize: " << packedsize << " sizeFree: " << sizeFree << std::endl;
+		std::cout << "packedsize: " << packedsize << " sizeRaw: " << sizeRaw << " szPrefix: " << szPrefixNew << std::endl;
 	#endif
 
-		if(sizeFree < thresSplit || sizeFree < packedsize || (int)active.footer().numKVs + nKeys > MAX_NUM_KVS)
+		if(! bFit)
 		{
+			if(active.isValid())
+			{
+				active.fillKVs(VKV(kvs.begin() + iLeafS, kvs.begin() + iKeyS));
+				active = Leaf();
+			}
+
 			if(packedsize < BODY_SIZE*2/3)
 			{
 			#ifdef VERBOSE_SPLIT
@@ -1887,23 +2378,22 @@ Leaf::doSplit(const VKV& kvs, Leaf ovr, size_t thresSplit, btree_split_t* split,
 				if(! oldUsed)
 				{
 					active = ovr;
+					oldUsed = true;
 				}
 				else
 				{
 					active = Leaf(pio->newInitPage<Leaf>());
-				}
-				active.footer().numKVs = 0;
-				active.footer().sizeFree = BODY_SIZE - sizeof(footer_t);
+					active.footer().hasFP = ovr.footer().hasFP;
 
-				if(! oldUsed)
-				{
-					oldUsed = true;
-				}
-				else
-				{
-					split->addSplit(key, active.pageId());
+					// parent node only needs a key separating the leaves
+					split->addSplit(key_separator(keyLast, key, bufSep), active.pageId());
 					pio->sync(active); // FIXME: this assumes delayed sync
 				}
+
+				iLeafS = iKeyS;
+				sizeRaw = packedsize;
+				nKeysLeaf = 1;
+				szPrefix = key.isNull() ? 0 : std::min<size_t>(key.size(), PREFIX_MAX);
 			}
 			else
 			{
@@ -1939,25 +2429,22 @@ Leaf::doSplit(const VKV& kvs, Leaf ovr, size_t thresSplit, btree_split_t* split,
 					split->addSplit(key, dl.pageId());
 					pio->sync(dl);
 				}
-
-				iKeyS = iKeyE;
-				continue;
 			}
-
-			iLeaf = 0;
-		}
-
-		{
-			active.kv_offset(iLeaf++) = active.addKV(kvs[iKeyS]);
 		}
-		for(int j = iKeyS+1; j < iKeyE; ++ j)
+		else
 		{
-			active.kv_offset(iLeaf++) = active.addV(kvs[j].second) + VALUE_ONLY;
+			sizeRaw += packedsize;
+			++ nKeysLeaf;
+			szPrefix = szPrefixNew;
 		}
-		sizeFree = active.footer().sizeFree;
 
+		keyLast = key;
 		iKeyS = iKeyE;
 	}
+	if(active.isValid())
+	{
+		active.fillKVs(VKV(kvs.begin() + iLeafS, kvs.end()));
+	}
 
 	if(split->numSplit > 0)
 	{
@@ -1973,7 +2460,7 @@ Leaf::dump_() const
 {
 	dumpHeader();
 
-	std::cout << "  Leaf <numKVs: " << (size_t)footer().numKVs << ", sizeFree: " << footer().sizeFree << ">" << std::endl;
+	std::cout << "  Leaf <numKVs: " << (size_t)footer().numKVs << ", sizeFree: " << footer().sizeFree << ", fp: " << footer().hasFP << ", prefix: " << prefix() << ">" << std::endl;
 	Buffer k, v;
 	btree_cursor_t cursor; cursor.leaf = *this;
 	for(int i = 0; i < footer().numKVs; ++ i)
@@ -2924,7 +3411,8 @@ dktree_insert(btree_cursor_t* cur, BufferCRef key, BufferCRef value, btree_split
 			{
 				*cur = curN;
 				Leaf l(cur->leaf);
-				bool bUpdateKey = (bufcmp(key, l.keyFirst()) < 0);
+				Buffer keyFirst; l.keyFirst(&keyFirst);
+				bool bUpdateKey = (bufcmp(key, keyFirst.rref()) < 0);
 				l.insert(key, value, split, bOvr, pio);
 				if(bUpdateKey)
 				{
@@ -3191,18 +3679,64 @@ btree_propagate(btree_split_t& split, bool bPrevWasOvr, btree_cursor_t* cur, Pag
 	return pgidRoot;
 }
 
+//! remember the path to the leaf if _key_ is to be appended to the rightmost leaf
+static
+void
+btree_append_hint_update(btree_append_hint_t* hint, page_id_t pgidRoot, const btree_cursor_t& cur, BufferCRef key)
+{
+	hint->reset();
+
+	if(cur.leaf.pageType() != PT_LEAF || ! Leaf(cur.leaf).isKeyAfterLast(key)) return;
+
+	hint->path.push_back(pgidRoot);
+	for(VNode::const_iterator it = cur.nodes.begin(); it != cur.nodes.end(); ++ it)
+	{
+		const page_id_t pgidChild = it->ptrBack();
+		const page_id_t pgidNext = (it + 1 != cur.nodes.end()) ? (it + 1)->pageOrigId() : cur.leaf.pageOrigId();
+		if(pgidChild != pgidNext)
+		{
+			// not the rightmost leaf
+			hint->path.clear();
+			return;
+		}
+
+		hint->path.push_back(pgidChild);
+	}
+	hint->pgidRoot = pgidRoot;
+}
+
 page_id_t
-btree_put(page_id_t pgidRoot, BufferCRef key, BufferCRef value, put_mode_t mode, PageIO* pio)
+btree_put(page_id_t pgidRoot, BufferCRef key, BufferCRef value, put_mode_t mode, PageIO* pio, btree_append_hint_t* hint)
 {
 	PTNK_PROBE(PTNK_BTREE_PUT_START());
 
-	query_t query;
-	query.key = key;
-	query.type = MATCH_EXACT_NOLEAF;
-
-	// traverse node pages and find relavant leaf node
 	btree_cursor_t cur;
-	btree_query(&cur, pgidRoot, query, pio);
+	bool bHintUsed = false;
+	if(hint && hint->pgidRoot == pgidRoot && ! hint->path.empty())
+	{
+		// appending to the rightmost leaf? -> skip traversing node pages
+		Page pg(pio->readPage(hint->path.back()));
+		if(pg.pageType() == PT_LEAF && Leaf(pg).isKeyAfterLast(key))
+		{
+			cur.leaf = pg;
+			bHintUsed = true;
+		}
+	}
+
+	if(! bHintUsed)
+	{
+		query_t query;
+		query.key = key;
+		query.type = MATCH_EXACT_NOLEAF;
+
+		// traverse node pages and find relavant leaf node
+		btree_query(&cur, pgidRoot, query, pio);
+
+		if(hint)
+		{
+			btree_append_hint_update(hint, pgidRoot, cur, key);
+		}
+	}
 
 	bool bPrevWasOvr = false;
 	btree_split_t split;
@@ -3247,12 +3781,194 @@ btree_put(page_id_t pgidRoot, BufferCRef key, BufferCRef value, put_mode_t mode,
 		}
 	}
 
-	pgidRoot = btree_propagate(split, bPrevWasOvr, &cur, pio);
+	if(PTNK_UNLIKELY(bHintUsed && (split.isValid() || bPrevWasOvr)))
+	{
+		// node pages are needed for propagation after all
+		for(size_t i = 0; i + 1 < hint->path.size(); ++ i)
+		{
+			cur.nodes.push_back(Node(pio->readPage(hint->path[i])));
+		}
+	}
+	if(PTNK_UNLIKELY(hint && split.isValid()))
+	{
+		// rightmost path may change
+		hint->reset();
+	}
+
+	if(PTNK_LIKELY(! cur.nodes.empty()))
+	{
+		pgidRoot = btree_propagate(split, bPrevWasOvr, &cur, pio);
+	}
 
 	PTNK_PROBE(PTNK_BTREE_PUT_END());
 	return pgidRoot;
 }
 
+page_id_t
+btree_bulkload(btree_bulkload_src_t* src, PageIO* pio)
+{
+	typedef Leaf::KV KV;
+	typedef Leaf::VKV VKV;
+
+	enum
+	{
+		SIZE_BATCH = 64 * 1024, //!< bytes of kv records read from _src_ at once (must be larger than a leaf can hold)
+	};
+
+	// kv records read from _src_ and not yet stored in leaves.
+	// they are copied into _bytes_, as _src_ only keeps them valid until the next call
+	struct rec_t
+	{
+		size_t off;
+		ssize_t szKey, szValue;
+	};
+	std::string bytes;
+	std::vector<rec_t> recs;
+	VKV kvs;
+	bool bEnd = false;
+
+	// pages of the level being built and their separators (the keys preceding them in the parent node).
+	// separator of pages[i] is seps[pages[i].first, pages[i+1].first)
+	std::string seps;
+	std::vector<pair<size_t, page_id_t> > pages;
+	size_t offSepNext = 0;
+	char bufSep[PTNK_BODY_SIZE];
+
+	// step 1: pack the records into leaves
+	Leaf leaf;
+	int iS = 0;
+	for(;;)
+	{
+		if(iS > 0)
+		{
+			// drop records already stored
+			const size_t off = (iS < static_cast<int>(recs.size())) ? recs[iS].off : bytes.size();
+			bytes.erase(0, off);
+			recs.erase(recs.begin(), recs.begin() + iS);
+			for(rec_t& r: recs) r.off -= off;
+			iS = 0;
+		}
+
+		while(! bEnd && bytes.size() < SIZE_BATCH)
+		{
+			BufferCRef key, value;
+			if(! src->next(&key, &value))
+			{
+				bEnd = true;
+				break;
+			}
+			if(key.size() >= static_cast<ssize_t>(Page::BODY_SIZE/2) || value.size() >= static_cast<ssize_t>(Page::BODY_SIZE/2))
+			{
+				PTNK_THROW_RUNTIME_ERR("btree_bulkload: kv record too large");
+			}
+			if(! recs.empty())
+			{
+				const rec_t& last = recs.back();
+				if(bufcmp(BufferCRef(bytes.data() + last.off, last.szKey), key) >= 0)
+				{
+					PTNK_THROW_RUNTIME_ERR("btree_bulkload: keys not sorted in ascending order");
+				}
+			}
+
+			rec_t r;
+			r.off = bytes.size();
+			r.szKey = key.isNull() ? Buffer::NULL_TAG : key.size();
+			if(! key.isNull()) bytes.append(key.get(), key.size());
+			r.szValue = value.isNull() ? Buffer::NULL_TAG : value.size();
+			if(! value.isNull()) bytes.append(value.get(), value.size());
+			recs.push_back(r);
+		}
+
+		const int n = recs.size();
+		kvs.clear();
+		for(const rec_t& r: recs)
+		{
+			const char* p = bytes.data() + r.off;
+			kvs.push_back(KV(BufferCRef(p, r.szKey), BufferCRef(p + packedsize(BufferCRef(p, r.szKey)), r.szValue)));
+		}
+
+		while(iS < n)
+		{
+			if(! leaf.isValid()) leaf = pio->newInitPage<Leaf>();
+
+			int iE = iS + leaf.numKVsFit(kvs, iS, n);
+			if(iE == n && ! bEnd) break; // more records may fit in the leaf
+
+			if(iE > iS)
+			{
+				leaf.fillKVs(VKV(kvs.begin() + iS, kvs.begin() + iE));
+				pio->sync(leaf);
+			}
+			else
+			{
+				// the record doesn't fit even an empty leaf. store it in a dupkey leaf (see Leaf::doSplit)
+				DupKeyLeaf dl(leaf, /* force = */ true);
+				dl.hdr()->type = PT_DUPKEYLEAF;
+				dl.initBody(kvs[iS].first);
+
+				bool _;
+				dktree_insert_exactkey(dl, kvs[iS].second, &_, pio);
+				pio->sync(dl);
+
+				iE = iS + 1;
+			}
+			pages.push_back(make_pair(offSepNext, leaf.pageId()));
+			leaf = Leaf();
+
+			if(iE < n)
+			{
+				leaf = pio->newInitPage<Leaf>();
+
+				// dupkey leaf needs the exact key as its separator
+				offSepNext = seps.size();
+				BufferCRef sep = leaf.numKVsFit(kvs, iE, iE + 1) > 0 ? key_separator(kvs[iE-1].first, kvs[iE].first, bufSep) : kvs[iE].first;
+				seps.append(sep.get(), sep.size());
+			}
+			iS = iE;
+		}
+
+		if(bEnd && iS == n) break;
+	}
+
+	if(pages.empty())
+	{
+		return btree_init(pio);
+	}
+
+	// step 2: build node levels upon the pages, until the root
+	do
+	{
+		Node::Vkp_t kps; kps.reserve(pages.size());
+		for(size_t i = 0; i < pages.size(); ++ i)
+		{
+			const size_t offE = (i + 1 < pages.size()) ? pages[i+1].first : seps.size();
+			kps.push_back(Node::kp_t(BufferCRef(seps.data() + pages[i].first, offE - pages[i].first), pages[i].second));
+		}
+
+		std::string sepsUp;
+		std::vector<pair<size_t, page_id_t> > pagesUp;
+		const int iE = kps.size();
+		for(int i = 0; i < iE; )
+		{
+			Node node(pio->newInitPage<Node>());
+			const int iNext = node.initBodyKPs(kps, i, iE);
+			pio->sync(node);
+
+			// the node is preceded by the separator of its first child
+			pagesUp.push_back(make_pair(sepsUp.size(), node.pageId()));
+			sepsUp.append(kps[i].first.get(), kps[i].first.size());
+
+			i = iNext;
+		}
+
+		seps.swap(sepsUp);
+		pages.swap(pagesUp);
+	}
+	while(pages.size() > 1);
+
+	return pages[0].second;
+}
+
 page_id_t
 btree_del(page_id_t pgidRoot, BufferCRef key, PageIO* pio)
 {
@@ -32,6 +32,31 @@ class PageIO;
 
 struct btree_cursor_t;
 
+//! path to the rightmost leaf remembered across btree_put() calls
+/*!
+ *	Sequential inserts (e.g. timestamp / auto-increment keys) always land on the
+ *	rightmost leaf. btree_put() skips the root-to-leaf descent while _key_ sorts after
+ *	the last key of the leaf remembered here.
+ *
+ *	The hint is only valid while the btree is modified solely via btree_put() w/ this hint,
+ *	and must be reset() otherwise (btree_del, cursor ops, PageIO switch, etc.).
+ */
+struct btree_append_hint_t
+{
+	page_id_t pgidRoot; //!< root node page id the path below is valid for
+	std::vector<page_id_t> path; //!< page ids from the root node down to the rightmost leaf
+
+	btree_append_hint_t()
+	:	pgidRoot(PGID_INVALID)
+	{ /* NOP */ }
+
+	void reset()
+	{
+		pgidRoot = PGID_INVALID;
+		path.clear();
+	}
+};
+
 //! create new btree and return root node page id
 page_id_t btree_init(PageIO* pio);
 
@@ -73,10 +98,44 @@ ssize_t btree_get(page_id_t idRoot, BufferCRef key, BufferRef value, PageIO* pio
  *	@param [in] pio
  *		PageIO used for modification
  *
+ *	@param [in,out] hint
+ *		optional rightmost leaf hint to speed up sequential inserts. see btree_append_hint_t
+ *
  *	@return
  *		page id of the new root (this may/may not be same as _idRoot_)
  */
-page_id_t btree_put(page_id_t idRoot, BufferCRef key, BufferCRef value, put_mode_t mode, PageIO* pio);
+page_id_t btree_put(page_id_t idRoot, BufferCRef key, BufferCRef value, put_mode_t mode, PageIO* pio, btree_append_hint_t* hint = NULL);
+
+//! source of sorted kv records fed to btree_bulkload()
+struct btree_bulkload_src_t
+{
+	virtual ~btree_bulkload_src_t() { /* NOP */ }
+
+	//! fetch the next kv record
+	/*!
+	 *	_key_ / _value_ only need to stay valid until the next call.
+	 *
+	 *	@return
+	 *		false if no more records
+	 */
+	virtual bool next(BufferCRef* key, BufferCRef* value) = 0;
+};
+
+//! build a new btree bottom-up from sorted kv records
+/*!
+ *	Leaves are packed full in the order of the records, then node levels are built upon them
+ *	up to the root. This is much cheaper than btree_put()-ing the records one by one.
+ *
+ *	@param [in] src
+ *		kv records sorted in ascending key order. keys must be unique
+ *
+ *	@param [in] pio
+ *		PageIO used to alloc the new pages
+ *
+ *	@return
+ *		root node page id of the new btree
+ */
+page_id_t btree_bulkload(btree_bulkload_src_t* src, PageIO* pio);
 
 //! delete a first kv record with specified key
 /*!
@@ -136,6 +195,19 @@ bool btree_cursor_prev(btree_cursor_t* cur, PageIO* pio);
 bool btree_cursor_valid(btree_cursor_t* cur);
 void btree_cursor_dump(btree_cursor_t* cur, PageIO* pio);
 
+//! shape of a btree collected by btree_stat()
+struct btree_stat_t
+{
+	int height; //!< num of levels including the leaves
+	size_t numNodes;
+	size_t numLeaves;
+	size_t numDupKeyTrees; //!< dup key trees, counted by their root page
+	size_t sizeFreeLeaves; //!< total unclaimed space in leaves
+};
+
+//! walk the whole btree and collect its shape to _stat_
+void btree_stat(page_id_t idRoot, btree_stat_t* stat, PageIO* pio);
+
 #ifndef PTNK_NO_CURSOR_WRAP
 
 class btree_cursor_wrap : noncopyable
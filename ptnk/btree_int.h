@@ -4,6 +4,11 @@
 #include "page.h"
 #include "btree.h"
 
+#ifndef PTNK_LEAF_FINGERPRINT
+//! create new b-tree leaves w/ key fingerprint array (see Leaf::fps())
+#define PTNK_LEAF_FINGERPRINT 1
+#endif
+
 namespace ptnk
 {
 
@@ -79,6 +84,76 @@ struct btree_split_t
 
 struct btree_cursor_t;
 
+//! compare keys stored w/ common prefix of the page elided against _key_
+/*!
+ *	bufcmp orders keys by size first, so the page prefix is compared against _key_ only once
+ *	and only when the sizes match.
+ */
+struct prefixed_key_comp
+{
+	size_t szPrefix;
+	int diffPrefix; //!< memcmp(prefix, key, szPrefix) if key is long enough
+	BufferCRef key;
+	BufferCRef keySuffix; //!< _key_ w/o prefix (valid if sharesPrefix())
+
+	prefixed_key_comp(BufferCRef prefix, BufferCRef key_)
+	:	szPrefix(prefix.size()), diffPrefix(0), key(key_), keySuffix(key_)
+	{
+		if(szPrefix == 0) return;
+
+		if(! key.isNull() && key.size() >= static_cast<ssize_t>(szPrefix))
+		{
+			diffPrefix = ::memcmp(prefix.get(), key.get(), szPrefix);
+			keySuffix = BufferCRef(key.get() + szPrefix, key.size() - szPrefix);
+		}
+		else
+		{
+			keySuffix.reset();
+		}
+	}
+
+	//! returns true if _key_ starts w/ the prefix
+	bool sharesPrefix() const
+	{
+		return keySuffix.isValid() && diffPrefix == 0;
+	}
+
+	//! bufcmp(prefix + _suffix_ + _szPad_ zero bytes, key)
+	int operator()(BufferCRef suffix, size_t szPad = 0) const
+	{
+		if(PTNK_UNLIKELY(suffix.isNull())) return bufcmp(suffix, key);
+
+		int diff = static_cast<ssize_t>(szPrefix + szPad) + suffix.size() - key.size();
+		if(diff != 0) return diff;
+		if(diffPrefix != 0) return diffPrefix;
+		if(PTNK_LIKELY(szPad == 0)) return bufcmp(suffix, keySuffix);
+
+		if(suffix.size() > 0)
+		{
+			diff = ::memcmp(suffix.get(), keySuffix.get(), suffix.size());
+			if(diff != 0) return diff;
+		}
+		for(ssize_t i = suffix.size(); i < keySuffix.size(); ++ i)
+		{
+			if(keySuffix.get()[i] != 0) return -1;
+		}
+		return 0;
+	}
+};
+
+//! length of the prefix common to _a_ and _b_ (up to _lenMax_)
+inline
+size_t prefix_len_common(BufferCRef a, BufferCRef b, size_t lenMax)
+{
+	if(a.isNull() || b.isNull()) return 0;
+
+	size_t l = std::min(lenMax, static_cast<size_t>(std::min(a.size(), b.size())));
+	size_t i = 0;
+	while(i < l && a.get()[i] == b.get()[i]) ++ i;
+
+	return i;
+}
+
 //! B-tree node
 class Node : public Page
 {
@@ -100,7 +175,19 @@ public:
 		// footer().sizeFree = BODY_SIZE - sizeof(footer_t) - sizeof(page_id_t) /* ptr_{-1} */;
 	}
 
-	void initBody(page_id_t pgidFirst);
+	void initBody(page_id_t pgidFirst, BufferCRef prefix = BufferCRef::INVALID_VAL);
+
+	typedef pair<BufferCRef, page_id_t> kp_t;
+	typedef std::vector<kp_t> Vkp_t;
+
+	//! init body w/ _kps_[b].second as ptr_{-1}, followed by as many kps of _kps_(b, e) as fit
+	/*!
+	 *	The node is packed full w/ the common key prefix elided (used by btree_bulkload()).
+	 *
+	 *	@return
+	 *		idx of the first kp not stored
+	 */
+	int initBodyKPs(const Vkp_t& kps, int b, int e);
 
 	page_id_t query(const query_t& q) const;
 
@@ -159,7 +246,8 @@ public:
 
 	page_id_t ptrBack() const
 	{
-		return ptr(footer().numKeys);
+		const uint16_t numKeys = footer().numKeys;
+		return numKeys > 0 ? ptr(numKeys - 1) : ptrm1();
 	}
 
 	page_id_t ptrBefore(page_id_t p) const;
@@ -169,21 +257,41 @@ public:
 	void dump_(PageIO* pio = NULL) const;
 	void dumpGraph_(FILE* fp, PageIO* pio = NULL) const;
 	bool refreshAllLeafPages_(void** cursor, page_id_t threshold, int numPages, PageIO* pio) const;
+	void stat_(btree_stat_t* stat, int lvl, PageIO* pio) const;
+
+	//! key prefix common to all the keys in this node (elided from the stored keys)
+	BufferCRef prefix() const
+	{
+		if(! footer().hasPrefix) return BufferCRef(rawbody(), 0);
+
+		const char* p = rawbody() + sizeof(page_id_t);
+		return BufferCRef(p + 1, *reinterpret_cast<const uint8_t*>(p));
+	}
 
 private:
 	Node();
 
 	enum
 	{
-		NULL_TAG = 0xffff
+		NULL_TAG = 0xffff,
+
+		//! k_i size bits holding stored key size. the rest holds num of trailing zero bytes elided
+		KEYSIZE_MASK = 0x0fff,
+		PAD_SHIFT = 12,
+		PAD_MAX = 15,
+
+		//! free space left in the old node when the rightmost child split (append workload)
+		THRES_SPLIT_APPEND = BODY_SIZE/10,
 	};
 
-	// |*|*|k_0 size|k_0|*|k_1 size|k_1|*|k_2 size|k_2|...|k_{N-1}|*|k_N size|k_N| ..FREESPACE..
-	//  | |              |              |                          |
-	//  v > ptr_0        v              v                          v
-	// ptr_-1            ptr_1          ptr_2          ...         ptr_N
+	// |*|(prefix)|*|k_0 size|k_0|*|k_1 size|k_1|*|k_2 size|k_2|...|k_{N-1}|*|k_N size|k_N| ..FREESPACE..
+	//  |         |              |              |                          |
+	//  v         > ptr_0        v              v                          v
+	// ptr_-1                    ptr_1          ptr_2          ...         ptr_N
 	//
 	// above ptr:key sets may not be in order
+	// (prefix) is |prefix size (1 byte)|prefix| if footer().hasPrefix. keys k_i are stored w/o the prefix.
+	// k_i size holds num of trailing zero bytes elided from k_i in its upper bits (see KEYSIZE_MASK)
 	//
 	// ... |offset N|offset N-1|...|offset 0|footer| END
 	// offset i points to ptr_i (in real order)
@@ -193,7 +301,10 @@ private:
 		uint16_t numKeys;
 
 		//! free space size
-		uint16_t sizeFree;
+		uint16_t sizeFree : 15;
+
+		//! node has common key prefix (see prefix())
+		uint16_t hasPrefix : 1;
 	} __attribute__((__packed__));
 
 	footer_t& footer()
@@ -228,9 +339,12 @@ private:
 		return *reinterpret_cast<const page_id_t*>(rawbody());	
 	}
 
-	typedef pair<BufferCRef, page_id_t> kp_t;
-	typedef std::vector<kp_t> Vkp_t;
-	kp_t kp(uint16_t i) const
+	//! i-th key (w/o prefix) and ptr pair
+	/*!
+	 *	@param [out] szPad
+	 *		num of trailing zero bytes elided from the key
+	 */
+	kp_t kp(uint16_t i, size_t* szPad = NULL) const
 	{
 		pair<BufferCRef, page_id_t> ret;
 
@@ -240,10 +354,12 @@ private:
 		if(PTNK_UNLIKELY(*ksize == NULL_TAG))
 		{
 			ret.first = BufferCRef::NULL_VAL;
+			if(szPad) *szPad = 0;
 		}
 		else
 		{
-			ret.first = BufferCRef(ksize+1, *ksize);
+			ret.first = BufferCRef(ksize+1, *ksize & KEYSIZE_MASK);
+			if(szPad) *szPad = *ksize >> PAD_SHIFT;
 		}
 
 		ret.second = *reinterpret_cast<const page_id_t*>(kp);
@@ -264,16 +380,27 @@ private:
 	struct key_idx_comp
 	{
 		const Node* node;
-		BufferCRef key;
+		prefixed_key_comp comp;
 
 		int operator()(int i) const
 		{
-			pair<BufferCRef, page_id_t> kp(node->kp(i));
-			return bufcmp(kp.first, key);
+			size_t szPad;
+			pair<BufferCRef, page_id_t> kp(node->kp(i, &szPad));
+			return comp(kp.first, szPad);
 		}
 	};
+
+	//! returns true if the keys are stored as is (w/o prefix and trailing zeros elided)
+	bool isKeysVerbatim() const;
+
+	//! returns true if all the keys of _split_ start w/ the prefix of this node
+	bool splitSharesPrefix(const btree_split_t& split) const;
+
+	//! prefix common to keys of _kps_[b, e)
+	static BufferCRef kpsPrefix(const Vkp_t& kps, int b, int e);
 	friend struct ptr_idx_comp;
 
+	//! add _key_ (which must start w/ the prefix) and _ptr_ pair
 	uint16_t addKP(BufferCRef key, page_id_t ptr)
 	{
 		uint16_t offset = BODY_SIZE - footer().sizeFree - sizeof(uint16_t)*footer().numKeys - sizeof(footer_t);
@@ -283,13 +410,26 @@ private:
 		size_t kpackedsize = 0;
 		if(PTNK_UNLIKELY(key.isNull()))
 		{
+			PTNK_ASSERT(! footer().hasPrefix);
 			*ksize = NULL_TAG;
 			kpackedsize = 0;
 		}
 		else
 		{
-			kpackedsize = *ksize = key.size();
-			::memcpy(ksize+1, key.get(), kpackedsize);
+			const size_t szPrefix = prefix().size();
+			PTNK_ASSERT(key.size() >= static_cast<ssize_t>(szPrefix));
+
+			// elide trailing zero bytes, which separators are padded w/ (see Leaf::doSplit())
+			kpackedsize = key.size() - szPrefix;
+			size_t szPad = 0;
+			while(szPad < PAD_MAX && kpackedsize > 0 && key.get()[szPrefix + kpackedsize - 1] == 0)
+			{
+				-- kpackedsize; ++ szPad;
+			}
+			PTNK_ASSERT(kpackedsize < KEYSIZE_MASK); // KEYSIZE_MASK w/ PAD_MAX is NULL_TAG
+
+			*ksize = kpackedsize | (szPad << PAD_SHIFT);
+			::memcpy(ksize+1, key.get() + szPrefix, kpackedsize);
 		}
 
 		footer().sizeFree -= sizeof(page_id_t) + sizeof(uint16_t)*2 + kpackedsize;
@@ -352,17 +492,39 @@ public:
 	void dump_() const;
 	void dumpGraph_(FILE* fp) const;
 
-	BufferCRef keyFirst() const;
+	void keyFirst(Buffer* key) const;
+
+	//! returns true if _key_ sorts after every key in this leaf (i.e. put(_key_) is an append)
+	bool isKeyAfterLast(BufferCRef key) const;
 
 	int numKVs() const
 	{
 		return footer().numKVs;	
 	}
 
-private:
+	size_t sizeFree() const
+	{
+		return footer().sizeFree;
+	}
+
+	//! key prefix common to all the keys in this leaf (elided from the stored keys)
+	BufferCRef prefix() const
+	{
+		if(! footer().hasPrefix) return BufferCRef(rawbody(), 0);
+
+		return BufferCRef(rawbody() + 1, *reinterpret_cast<const uint8_t*>(rawbody()));
+	}
+
 	typedef std::pair<BufferCRef, BufferCRef> KV;
 	typedef std::vector<KV> VKV;
 
+	//! num of kvs from the head of _kvs_[b, e) which fit in this leaf packed by fillKVs()
+	int numKVsFit(const VKV& kvs, int b, int e) const;
+
+	//! reset the leaf and fill _kvs_ w/ their common prefix elided
+	void fillKVs(const VKV& kvs);
+
+private:
 	//! check if key-value record (_key_, _value_) can be inserted w/o split
 	bool isRoomForKVAvailable(BufferCRef key, BufferCRef value) const;
 
@@ -385,20 +547,62 @@ private:
 	void doDefrag(const VKV& kvs, Leaf ovr, PageIO* pio);
 	void doSplit(const VKV& kvs, Leaf ovr, size_t thresSplit, btree_split_t* split, PageIO* pio);
 
+	//! size of the prefix fillKVs() elides from _kvs_. num of key records is returned to _nKeys_
+	static size_t kvsPrefixSize(const VKV& kvs, size_t* nKeys);
+
+	//! size taken by kvs of _sizeRaw_ bytes incl. _nKeys_ keys, when _szPrefix_ bytes common prefix is elided
+	static size_t kvsPackedSize(size_t sizeRaw, size_t nKeys, size_t szPrefix)
+	{
+		// prefix costs its size + 1 byte (see kvsPrefixSize())
+		if(nKeys * szPrefix < 1 + szPrefix) return sizeRaw;
+		return sizeRaw - nKeys * szPrefix + 1 + szPrefix;
+	}
+
+	//! insert kv which doesn't fit in this leaf as is. the leaf is repacked w/ prefix recomputed, or split.
+	void insertRepack(Leaf ovr, int new_i, BufferCRef key, BufferCRef value, btree_split_t* split, PageIO* pio);
+
 	enum
 	{
 		NULL_TAG = 0xffff,
 		MAX_NUM_KVS = 255,
 
 		VALUE_ONLY = 0x8000,
+
+		//! max size of the prefix elided
+		PREFIX_MAX = 64,
+
+		//! size of tmpbuf needed to copy out all the kvs w/ prefix restored
+		TMPBUF_SIZE = BODY_SIZE + MAX_NUM_KVS*PREFIX_MAX,
 	};
 
+	// |(prefix)|kv_0|kv_1|...    ..FREESPACE..    |fp_0|...|fp_N|offset N|...|offset 0|footer| END
+	//
+	// (prefix) is |prefix size (1 byte)|prefix| if footer().hasPrefix. keys are stored w/o the prefix.
+	// fp_i exist if footer().hasFP (see fps())
+
 	struct footer_t
 	{
 		uint8_t numKVs; //!< number of kv pairs in this leaf
-		uint16_t sizeFree; //!< size of unclaimed space at last
+		uint16_t sizeFree : 13; //!< size of unclaimed space at last
+		uint16_t hasPrefix : 1; //!< leaf has common key prefix (see prefix())
+		uint16_t reserved : 1;
+		uint16_t hasFP : 1; //!< leaf keeps key fingerprint array (see fps())
 	} __attribute__((__packed__));
 
+	//! set prefix of the keys to be added. must be called on empty leaf
+	void setPrefix(BufferCRef prefix)
+	{
+		PTNK_ASSERT(footer().numKVs == 0);
+		PTNK_ASSERT(prefix.size() <= PREFIX_MAX);
+
+		footer().hasPrefix = prefix.size() > 0;
+		if(! footer().hasPrefix) return;
+
+		*reinterpret_cast<uint8_t*>(rawbody()) = prefix.size();
+		::memcpy(rawbody() + 1, prefix.get(), prefix.size());
+		footer().sizeFree -= 1 + prefix.size();
+	}
+
 	//! packed kv record in the leaf
 	struct packedkv_t
 	{
@@ -434,6 +638,46 @@ private:
 		return const_cast<Leaf*>(this)->kv_offset(i);	
 	}
 
+	//! size of per record slot (kv_offset + fingerprint if any)
+	size_t slotSize() const
+	{
+		return sizeof(uint16_t) + (footer().hasFP ? sizeof(int32_t) : 0);
+	}
+
+	//! fingerprint array placed right before kv_offset array
+	/*!
+	 *	fps()[i] holds fingerprint() of the key of record i (value-only records share the fingerprint of their key).
+	 *	Fingerprints are ordered consistently w/ bufcmp, so only records w/ equal fingerprint need full key comparison.
+	 *	Fingerprints are taken after the prefix, as all the keys in the leaf share it.
+	 */
+	int32_t* fps()
+	{
+		return reinterpret_cast<int32_t*>(rawbody() + BODY_SIZE - sizeof(footer_t) - slotSize()*footer().numKVs);
+	}
+
+	const int32_t* fps() const
+	{
+		return const_cast<Leaf*>(this)->fps();
+	}
+
+	//! (size bucket, first 3 bytes) of key packed into int32 so that bufcmp(a, b) < 0 implies fingerprint(a) <= fingerprint(b)
+	/*!
+	 *	Keys of size >= 254 fall into a single size bucket and carry no key bytes, so they all tie.
+	 *
+	 *	@param [in] suffix
+	 *		key w/o the first _szPrefix_ bytes
+	 */
+	static int32_t fingerprint(BufferCRef suffix, size_t szPrefix = 0);
+
+	//! copy key of _kv_ w/ prefix restored to _tmpbuf_
+	BufferCRef keyCopy(const packedkv_t* kv, char** tmpbuf) const;
+
+	//! insert slot for record already added by addKV/addV at _new_i_
+	void insertSlot(int new_i, uint16_t kvo, int32_t fp);
+
+	//! fill fingerprint array from records
+	void buildFPs();
+
 	BufferCRef getV(int i) const
 	{
 		uint16_t kvo = kv_offset(i);
@@ -475,9 +719,10 @@ private:
 
 	size_t offsetFree() const
 	{
-		return BODY_SIZE - footer().sizeFree - sizeof(uint16_t)*footer().numKVs - sizeof(footer_t);
+		return BODY_SIZE - footer().sizeFree - slotSize()*footer().numKVs - sizeof(footer_t);
 	}
 
+	//! add kv record. _key_ must start w/ the prefix
 	uint16_t addKV(BufferCRef key, BufferCRef value)
 	{
 		PTNK_ASSERT(key.isValid());
@@ -489,13 +734,17 @@ private:
 		size_t ksize_packed, vsize_packed;
 		if(PTNK_UNLIKELY(key.isNull()))
 		{
+			PTNK_ASSERT(! footer().hasPrefix);
 			kv->szKey = NULL_TAG;
 			ksize_packed = 0;
 		}
 		else
 		{
-			ksize_packed = kv->szKey = static_cast<size_t>(key.size());
-			::memcpy(kv->offset, key.get(), ksize_packed);
+			const size_t szPrefix = prefix().size();
+			PTNK_ASSERT(key.size() >= static_cast<ssize_t>(szPrefix));
+
+			ksize_packed = kv->szKey = static_cast<size_t>(key.size()) - szPrefix;
+			::memcpy(kv->offset, key.get() + szPrefix, ksize_packed);
 		}
 		
 		if(PTNK_UNLIKELY(value.isNull()))
@@ -508,7 +757,7 @@ private:
 			vsize_packed = kv->szValue = static_cast<size_t>(value.size());
 			::memcpy(kv->offset + ksize_packed, value.get(), vsize_packed);
 		}
-		footer().sizeFree -= sizeof(uint16_t)*3 + ksize_packed + vsize_packed;
+		footer().sizeFree -= sizeof(uint16_t)*2 + slotSize() + ksize_packed + vsize_packed;
 		++ footer().numKVs;
 
 		return offset;
@@ -532,7 +781,7 @@ private:
 			::memcpy(v->offset, value.get(), vsize_packed);
 		}
 
-		footer().sizeFree -= sizeof(uint16_t)*2 + vsize_packed;
+		footer().sizeFree -= sizeof(uint16_t) + slotSize() + vsize_packed;
 		++ footer().numKVs;
 
 		return offset;
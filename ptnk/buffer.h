@@ -214,6 +214,19 @@ public:
 		::memcpy(tgt.get(), popFront(tgt.size()), tgt.size());
 	}
 
+	//! pop varint encoded value (see varint_encode)
+	uint64_t popFrontVarint()
+	{
+		uint64_t v = 0;
+		for(unsigned int shift = 0; ; shift += 7)
+		{
+			PTNK_ASSERT(shift < 64);
+			const uint8_t b = *popFront(1);
+			v |= static_cast<uint64_t>(b & 0x7f) << shift;
+			if(! (b & 0x80)) return v;
+		}
+	}
+
 	std::string inspect() const;
 
 	std::string hexdump() const;
@@ -244,6 +257,28 @@ cstr2ref(const char* str)
 	return BufferCRef(str, ::strlen(str));
 }
 
+enum
+{
+	VARINT_SIZE_MAX = 10, //!< max num bytes of varint encoded uint64_t
+};
+
+//! encode _v_ to _buf_ as varint (7 bits per byte, LSB first, MSB set on all bytes but last)
+/*!
+ *	@return num bytes written
+ */
+inline
+size_t varint_encode(char buf[VARINT_SIZE_MAX], uint64_t v)
+{
+	size_t i = 0;
+	for(; v >= 0x80; v >>= 7)
+	{
+		buf[i++] = static_cast<char>(v | 0x80);
+	}
+	buf[i++] = static_cast<char>(v);
+
+	return i;
+}
+
 inline
 size_t bufcpy(BufferRef dest, BufferCRef src)
 {
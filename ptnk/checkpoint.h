@@ -0,0 +1,81 @@
+#ifndef _ptnk_checkpoint_h_
+#define _ptnk_checkpoint_h_
+
+#include "pageio.h"
+
+namespace ptnk
+{
+
+//! chunk of ovr table checkpoint written by TPIO::checkpoint
+/*!
+ *	Checkpoint data spans a chain of pages, linked from the last page (flagged PF_END_TX) to the first.
+ */
+class OvrCheckpointPage : public Page
+{
+public:
+	enum
+	{
+		TYPE = PT_OVRCHECKPOINT,
+	};
+
+	OvrCheckpointPage()
+	{ /* NOP */ }
+
+	explicit OvrCheckpointPage(const Page& pg, bool force = false)
+	{
+		if(! force) { PTNK_ASSERT(pg.pageType() == TYPE); }
+		*reinterpret_cast<Page*>(this) = pg;
+	}
+
+	void init(page_id_t id)
+	{
+		initHdr(id, TYPE);
+		pgidPrev() = PGID_INVALID;
+		size() = 0;
+	}
+
+	//! write front of _buf_ to the page
+	/*!
+	 *	@return
+	 *		rest of _buf_ which didn't fit in the page
+	 */
+	BufferCRef write(BufferCRef buf)
+	{
+		size_t wlen = std::min(static_cast<size_t>(buf.size()), capacity() - size());
+		::memcpy(data() + size(), buf.popFront(wlen), wlen);
+		size() += wlen;
+
+		return buf;
+	}
+
+	BufferCRef read() const
+	{
+		return BufferCRef(const_cast<OvrCheckpointPage*>(this)->data(), const_cast<OvrCheckpointPage*>(this)->size());
+	}
+
+	//! previous page of the checkpoint. PGID_INVALID for the first page
+	page_id_t& pgidPrev()
+	{
+		return *reinterpret_cast<page_id_t*>(rawbody());
+	}
+
+private:
+	static size_t capacity()
+	{
+		return PTNK_BODY_SIZE + PTNK_STREAK_SIZE - sizeof(page_id_t) - sizeof(size_t);
+	}
+
+	size_t& size()
+	{
+		return *reinterpret_cast<size_t*>(rawbody() + sizeof(page_id_t));
+	}
+
+	char* data()
+	{
+		return rawbody() + sizeof(page_id_t) + sizeof(size_t);
+	}
+};
+
+} // end of namespace ptnk
+
+#endif // _ptnk_checkpoint_h_
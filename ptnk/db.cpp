@@ -14,7 +14,12 @@ namespace ptnk
 {
 
 DB::DB(const char* filename, ptnk_opts_t opts, int mode)
+:	m_bRebaseQueued(false),
+	m_bCheckpointOnClose(true)
 {
+	// bounded sync is done by backend syncRange, which is enabled by OAUTOSYNC
+	if(opts & OBOUNDEDSYNC) opts |= OAUTOSYNC;
+
 	if(opts & OHELPERTHREAD)
 	{
 		m_helper.reset(new Helper);	
@@ -40,10 +45,16 @@ DB::DB(const char* filename, ptnk_opts_t opts, int mode)
 	}
 
 	m_tpio.reset(new TPIO(m_pio, opts));
+	if(m_helper)
+	{
+		m_tpio->attachHelper(m_helper.get());
+	}
 	initCommon();
 }
 
 DB::DB(const shared_ptr<PageIO>& pio, ptnk_opts_t opts)
+:	m_bRebaseQueued(false),
+	m_bCheckpointOnClose(true)
 {
 	// FIXME: OHELPERTHREAD would be ignored
 	m_pio = pio;
@@ -85,14 +96,44 @@ DB::initCommon()
 
 DB::~DB()
 {
-	/* NOP */
+	if(m_bCheckpointOnClose) closeCheckpoint();
+}
+
+void
+DB::closeCheckpoint()
+{
+	auto ckpt = [this] () {
+		try
+		{
+			m_tpio->checkpoint();
+		}
+		catch(std::exception& e)
+		{
+			// db is still restorable from the log
+			std::cerr << "ptnk: failed to write checkpoint on close: " << e.what() << std::endl;
+		}
+	};
+
+	if(! m_helper)
+	{
+		ckpt();
+		return;
+	}
+
+	// run on helper thr after the rebase job in progress, if any
+	std::promise<void> done;
+	m_helper->enq([&ckpt, &done] () {
+		ckpt();
+		done.set_value();
+	});
+	done.get_future().wait();
 }
 
 ssize_t
 DB::get(BufferCRef key, BufferRef value)
 {
-	Tx tx(this, m_tpio->newTransaction());
-	return tx.get(key, value);
+	Snapshot ss(this, m_tpio->newSnapshot());
+	return ss.get(key, value);
 }
 
 void
@@ -113,22 +154,145 @@ DB::newTransaction()
 	return tx;
 }
 
+DB::Snapshot*
+DB::newSnapshot()
+{
+	return new Snapshot(this, m_tpio->newSnapshot());
+}
+
+//! key ops done in a tx
+/*!
+ *	Keys / values are packed in a single byte array, so that recording an op costs no heap alloc in most cases.
+ */
+struct DB::Tx::oplog_t
+{
+	enum
+	{
+		SIZE_MAX_LOG = 64 * 1024, //!< give up recording ops when log grows larger than this
+	};
+
+	struct op_t
+	{
+		bool bPut;
+		put_mode_t mode;
+
+		bool bDefaultTable;
+		size_t offTable; ssize_t szTable;
+		size_t offKey; ssize_t szKey;
+		size_t offValue; ssize_t szValue;
+	};
+
+	std::vector<op_t> ops;
+	std::string bytes;
+
+	void pack(BufferCRef buf, size_t* off, ssize_t* sz)
+	{
+		*off = bytes.size();
+		*sz = buf.isNull() ? Buffer::NULL_TAG : buf.size();
+		if(! buf.isNull()) bytes.append(buf.get(), buf.size());
+	}
+
+	BufferCRef unpack(size_t off, ssize_t sz) const
+	{
+		return BufferCRef(bytes.data() + off, sz);
+	}
+
+	BufferCRef table(const op_t& op) const { return unpack(op.offTable, op.szTable); }
+	BufferCRef key(const op_t& op) const { return unpack(op.offKey, op.szKey); }
+	BufferCRef value(const op_t& op) const { return unpack(op.offValue, op.szValue); }
+};
+
+//! rightmost leaf hints of the tables put in a tx
+struct DB::Tx::hints_t
+{
+	enum
+	{
+		NUM_HINTS = 4, //!< num of tables tracked at once
+	};
+
+	btree_append_hint_t hints[NUM_HINTS];
+	int iNext; //!< next hint to be recycled
+
+	hints_t()
+	:	iNext(0)
+	{ /* NOP */ }
+
+	btree_append_hint_t* get(page_id_t pgidRoot)
+	{
+		for(int i = 0; i < NUM_HINTS; ++ i)
+		{
+			if(hints[i].pgidRoot == pgidRoot) return &hints[i];
+		}
+
+		btree_append_hint_t* h = &hints[iNext];
+		iNext = (iNext + 1) % NUM_HINTS;
+		h->reset();
+		return h;
+	}
+};
+
 DB::Tx::Tx(DB* db, unique_ptr<TPIOTxSession> pio)
 :	m_bCommitted(false),
 	m_db(db),
-	m_pio(move(pio))
+	m_pio(move(pio)),
+	m_bReplayable(true)
 {
 	/* NOP */
 }
 
 DB::Tx::~Tx()
 {
-	/* NOP */
+	m_db->m_tpio->notifyTxEnd(m_pio.get());
+}
+
+void
+DB::Tx::logOp(bool bPut, const BufferCRef* table, BufferCRef key, BufferCRef value, put_mode_t mode)
+{
+	if(! m_bReplayable) return;
+	if(! m_oplog) m_oplog.reset(new oplog_t);
+
+	oplog_t::op_t op;
+	op.bPut = bPut;
+	op.mode = mode;
+	op.bDefaultTable = (table == NULL);
+	m_oplog->pack(table ? *table : BufferCRef::NULL_VAL, &op.offTable, &op.szTable);
+	m_oplog->pack(key, &op.offKey, &op.szKey);
+	m_oplog->pack(bPut ? value : BufferCRef::NULL_VAL, &op.offValue, &op.szValue);
+	m_oplog->ops.push_back(op);
+
+	if(m_oplog->bytes.size() > oplog_t::SIZE_MAX_LOG)
+	{
+		// too large tx. its conflicts are not worth resolving
+		m_bReplayable = false;
+		m_oplog.reset();
+	}
+}
+
+TPIOTxSession*
+DB::Tx::pio()
+{
+	// page level access can't be replayed in tryResolveConflict
+	m_bReplayable = false;
+
+	// ... nor tracked by the append hints
+	m_hints.reset();
+
+	return m_pio.get();	
+}
+
+btree_append_hint_t*
+DB::Tx::appendHint(page_id_t pgidRoot)
+{
+	if(! m_hints) m_hints.reset(new hints_t);
+
+	return m_hints->get(pgidRoot);
 }
 
 void
 DB::Tx::tableCreate(BufferCRef table)
 {
+	m_bReplayable = false;
+
 	OverviewPage pgOvv(m_pio->readPage(m_pio->pgidStartPage()));
 	if(PGID_INVALID != pgOvv.getTableRoot(table))
 	{
@@ -143,14 +307,61 @@ DB::Tx::tableCreate(BufferCRef table)
 void
 DB::Tx::tableDrop(BufferCRef table)
 {
+	m_bReplayable = false;
+	m_hints.reset();
+
 	OverviewPage pgOvv(m_pio->readPage(m_pio->pgidStartPage()));
 
 	pgOvv.dropTable(table, NULL, m_pio.get());
 }
 
+//! returns true if the btree has no kv record
+static
+bool
+btree_empty(page_id_t pgidRoot, PageIO* pio)
+{
+	btree_cursor_wrap cur;
+	btree_cursor_front(cur.get(), pgidRoot, pio);
+
+	return ! btree_cursor_valid(cur.get());
+}
+
+void
+DB::Tx::bulkLoad(BufferCRef table, btree_bulkload_src_t* src)
+{
+	m_bReplayable = false;
+	m_hints.reset();
+
+	OverviewPage pgOvv(m_pio->readPage(m_pio->pgidStartPage()));
+
+	page_id_t pgidOldRoot = pgOvv.getTableRoot(table);
+	if(pgidOldRoot == PGID_INVALID) PTNK_THROW_RUNTIME_ERR("table not found");
+	if(! btree_empty(pgidOldRoot, m_pio.get())) PTNK_THROW_RUNTIME_ERR("bulkLoad: table not empty");
+
+	page_id_t pgidNewRoot = btree_bulkload(src, m_pio.get());
+	pgOvv.setTableRoot(table, pgidNewRoot, NULL, m_pio.get());
+}
+
+void
+DB::Tx::bulkLoad(btree_bulkload_src_t* src)
+{
+	m_bReplayable = false;
+	m_hints.reset();
+
+	OverviewPage pgOvv(m_pio->readPage(m_pio->pgidStartPage()));
+
+	page_id_t pgidOldRoot = pgOvv.getDefaultTableRoot();
+	if(! btree_empty(pgidOldRoot, m_pio.get())) PTNK_THROW_RUNTIME_ERR("bulkLoad: table not empty");
+
+	page_id_t pgidNewRoot = btree_bulkload(src, m_pio.get());
+	pgOvv.setDefaultTableRoot(pgidNewRoot, NULL, m_pio.get());
+}
+
 ssize_t
 DB::Tx::tableGetName(int idx, BufferRef name)
 {
+	m_bReplayable = false;
+
 	OverviewPage pgOvv(m_pio->readPage(m_pio->pgidStartPage()));
 	
 	return bufcpy(name, pgOvv.getTableName(idx));
@@ -163,6 +374,7 @@ DB::Tx::get(BufferCRef table, BufferCRef key, BufferRef value)
 	page_id_t pgidRoot = pgOvv.getTableRoot(table);
 	if(pgidRoot == PGID_INVALID) PTNK_THROW_RUNTIME_ERR("table not found");
 
+	logOp(false, &table, key);
 	return btree_get(pgidRoot, key, value, m_pio.get());
 }
 
@@ -173,6 +385,8 @@ DB::Tx::get(TableOffCache* table, BufferCRef key, BufferRef value)
 	page_id_t pgidRoot = pgOvv.getTableRoot(table);
 	if(pgidRoot == PGID_INVALID) PTNK_THROW_RUNTIME_ERR("table not found");
 
+	BufferCRef tableid = table->getTableId();
+	logOp(false, &tableid, key);
 	return btree_get(pgidRoot, key, value, m_pio.get());
 }
 
@@ -180,6 +394,7 @@ ssize_t
 DB::Tx::get(BufferCRef key, BufferRef value)
 {
 	OverviewPage pgOvv(m_pio->readPage(m_pio->pgidStartPage()));
+	logOp(false, NULL, key);
 	return btree_get(pgOvv.getDefaultTableRoot(), key, value, m_pio.get());
 }
 
@@ -190,7 +405,8 @@ DB::Tx::put(BufferCRef table, BufferCRef key, BufferCRef value, put_mode_t mode)
 
 	page_id_t pgidOldRoot = pgOvv.getTableRoot(table);
 	if(pgidOldRoot == PGID_INVALID) PTNK_THROW_RUNTIME_ERR("table not found");
-	page_id_t pgidNewRoot = btree_put(pgidOldRoot, key, value, mode, m_pio.get());
+	logOp(true, &table, key, value, mode);
+	page_id_t pgidNewRoot = btree_put(pgidOldRoot, key, value, mode, m_pio.get(), appendHint(pgidOldRoot));
 	// m_pio->notifyPageWOldLink(pgOvv.pageOrigId()); // this can be safely omitted
 	
 	// handle root node update
@@ -207,7 +423,9 @@ DB::Tx::put(TableOffCache* table, BufferCRef key, BufferCRef value, put_mode_t m
 
 	page_id_t pgidOldRoot = pgOvv.getTableRoot(table);
 	if(pgidOldRoot == PGID_INVALID) PTNK_THROW_RUNTIME_ERR("table not found");
-	page_id_t pgidNewRoot = btree_put(pgidOldRoot, key, value, mode, m_pio.get());
+	BufferCRef tableid = table->getTableId();
+	logOp(true, &tableid, key, value, mode);
+	page_id_t pgidNewRoot = btree_put(pgidOldRoot, key, value, mode, m_pio.get(), appendHint(pgidOldRoot));
 	// m_pio->notifyPageWOldLink(pgOvv.pageOrigId()); // this can be safely omitted
 	
 	// handle root node update
@@ -223,7 +441,8 @@ DB::Tx::put(BufferCRef key, BufferCRef value, put_mode_t mode)
 	OverviewPage pgOvv(m_pio->readPage(m_pio->pgidStartPage()));
 
 	page_id_t pgidOldRoot = pgOvv.getDefaultTableRoot();
-	page_id_t pgidNewRoot = btree_put(pgidOldRoot, key, value, mode, m_pio.get());
+	logOp(true, NULL, key, value, mode);
+	page_id_t pgidNewRoot = btree_put(pgidOldRoot, key, value, mode, m_pio.get(), appendHint(pgidOldRoot));
 	// m_pio->notifyPageWOldLink(pgOvv.pageOrigId()); // this can be safely omitted
 	
 	// handle root node update
@@ -250,6 +469,8 @@ inline
 DB::Tx::cursor_t*
 DB::Tx::curNew(BufferCRef table)
 {
+	m_bReplayable = false;
+
 	unique_ptr<cursor_t> cur(new cursor_t);
 
 	OverviewPage pgOvv(m_pio->readPage(m_pio->pgidStartPage()));
@@ -265,6 +486,8 @@ inline
 DB::Tx::cursor_t*
 DB::Tx::curNew(TableOffCache* table)
 {
+	m_bReplayable = false;
+
 	unique_ptr<cursor_t> cur(new cursor_t);
 
 	OverviewPage pgOvv(m_pio->readPage(m_pio->pgidStartPage()));
@@ -399,6 +622,8 @@ DB::Tx::curGet(BufferRef key, ssize_t* szKey, BufferRef value, ssize_t* szValue,
 void
 DB::Tx::curPut(cursor_t* cur, BufferCRef value)
 {
+	m_hints.reset();
+
 	page_id_t pgidOldRoot = btree_cursor_root(cur->curBTree);
 	page_id_t pgidNewRoot = btree_cursor_put(cur->curBTree, value, m_pio.get());
 
@@ -414,6 +639,8 @@ DB::Tx::curPut(cursor_t* cur, BufferCRef value)
 bool
 DB::Tx::curDelete(cursor_t* cur)
 {
+	m_hints.reset();
+
 	page_id_t pgidOldRoot = btree_cursor_root(cur->curBTree);
 	page_id_t pgidNewRoot;
 	bool bNextExist;
@@ -433,13 +660,48 @@ DB::Tx::curDelete(cursor_t* cur)
 
 bool
 DB::Tx::tryCommit()
+{
+	return tryCommitImpl(DurableCallback());
+}
+
+bool
+DB::Tx::tryCommitAsync(DurableCallback cbDurable)
+{
+	PTNK_ASSERT(cbDurable);
+
+	return tryCommitImpl(cbDurable);
+}
+
+bool
+DB::Tx::tryCommitAsync(std::shared_future<void>* durable)
+{
+	shared_ptr<std::promise<void> > p(new std::promise<void>);
+	std::shared_future<void> f = p->get_future().share();
+
+	bool bCommitted = tryCommitImpl([p] (std::exception_ptr err) {
+		if(err)
+		{
+			p->set_exception(err);	
+		}
+		else
+		{
+			p->set_value();
+		}
+	});
+	if(bCommitted) *durable = f;
+
+	return bCommitted;
+}
+
+bool
+DB::Tx::tryCommitImpl(const DurableCallback& cbDurable)
 {
 	PTNK_ASSERT(! m_bCommitted);
 
-	if(m_pio->tryCommit())
+	if(m_pio->tryCommitAsync(cbDurable) || tryResolveConflict(cbDurable))
 	{
 		m_bCommitted = true;
-		m_db->rebase(false); // rebase if needed
+		m_db->rebaseIfNeeded();
 
 		return true;
 	}
@@ -449,18 +711,180 @@ DB::Tx::tryCommit()
 	}
 }
 
+bool
+DB::Tx::tryResolveConflict(const DurableCallback& cbDurable)
+{
+	if(! m_bReplayable || ! m_oplog) return false;
+
+	// txs over rebase are not resolved. they are expected to be rare
+	if(m_db->m_tpio->isRebasedSince(m_pio.get())) return false;
+	const oplog_t& log = *m_oplog;
+
+	// committed state the tx was based on
+	Snapshot ssBase(m_db, m_db->m_tpio->newSnapshot(m_pio.get()));
+
+	char bufBase[PTNK_BODY_SIZE], bufLatest[PTNK_BODY_SIZE];
+	for(int iRetry = 0; iRetry < RESOLVE_RETRY; ++ iRetry)
+	{
+		Tx txLatest(m_db, m_db->m_tpio->newTransaction());
+		txLatest.m_bReplayable = false; // don't record replayed ops again
+
+		// step 1: check that no key touched by the tx has been changed by txs committed after its snapshot
+		for(const oplog_t::op_t& op: log.ops)
+		{
+			ssize_t szBase, szLatest;
+			if(op.bDefaultTable)
+			{
+				szBase = ssBase.get(log.key(op), BufferRef(bufBase, sizeof(bufBase)));
+				szLatest = txLatest.get(log.key(op), BufferRef(bufLatest, sizeof(bufLatest)));
+			}
+			else
+			{
+				szBase = ssBase.get(log.table(op), log.key(op), BufferRef(bufBase, sizeof(bufBase)));
+
+				OverviewPage pgOvv(txLatest.m_pio->readPage(txLatest.m_pio->pgidStartPage()));
+				if(pgOvv.getTableRoot(log.table(op)) == PGID_INVALID)
+				{
+					// table dropped after the tx snapshot
+					m_db->m_tpio->notifyConflict(false);
+					return false;
+				}
+				szLatest = txLatest.get(log.table(op), log.key(op), BufferRef(bufLatest, sizeof(bufLatest)));
+			}
+
+			if(szBase != szLatest || (szBase > 0 && ::memcmp(bufBase, bufLatest, szBase) != 0))
+			{
+				// real key level conflict
+				m_db->m_tpio->notifyConflict(false);
+				return false;
+			}
+		}
+
+		// step 2: redo the writes on the latest snapshot
+		for(const oplog_t::op_t& op: log.ops)
+		{
+			if(! op.bPut) continue;
+
+			if(op.bDefaultTable)
+			{
+				txLatest.put(log.key(op), log.value(op), op.mode);
+			}
+			else
+			{
+				txLatest.put(log.table(op), log.key(op), log.value(op), op.mode);
+			}
+		}
+
+		if(txLatest.m_pio->tryCommitAsync(cbDurable))
+		{
+			// the tx is now the committed one. the original session is ended along w/ txLatest
+			swap(m_pio, txLatest.m_pio);
+			m_db->m_tpio->notifyConflict(true);
+			return true;
+		}
+
+		// yet another tx committed in the meantime... retry
+	}
+
+	return false;
+}
+
 void
 DB::Tx::dumpStat() const
 {
 	std::cout << *m_pio << std::endl;
 }
 
+DB::Snapshot::Snapshot(DB* db, unique_ptr<TPIOSnapshot> pio)
+:	m_db(db),
+	m_pio(move(pio))
+{
+	/* NOP */
+}
+
+DB::Snapshot::~Snapshot()
+{
+	m_db->m_tpio->notifyTxEnd(m_pio.get());
+}
+
+ssize_t
+DB::Snapshot::get(BufferCRef table, BufferCRef key, BufferRef value)
+{
+	OverviewPage pgOvv(m_pio->readPage(m_pio->pgidStartPage()));
+	page_id_t pgidRoot = pgOvv.getTableRoot(table);
+	if(pgidRoot == PGID_INVALID) PTNK_THROW_RUNTIME_ERR("table not found");
+
+	return btree_get(pgidRoot, key, value, m_pio.get());
+}
+
+ssize_t
+DB::Snapshot::get(TableOffCache* table, BufferCRef key, BufferRef value)
+{
+	OverviewPage pgOvv(m_pio->readPage(m_pio->pgidStartPage()));
+	page_id_t pgidRoot = pgOvv.getTableRoot(table);
+	if(pgidRoot == PGID_INVALID) PTNK_THROW_RUNTIME_ERR("table not found");
+
+	return btree_get(pgidRoot, key, value, m_pio.get());
+}
+
+ssize_t
+DB::Snapshot::get(BufferCRef key, BufferRef value)
+{
+	OverviewPage pgOvv(m_pio->readPage(m_pio->pgidStartPage()));
+	return btree_get(pgOvv.getDefaultTableRoot(), key, value, m_pio.get());
+}
+
 void
 DB::rebase(bool force)
 {
 	m_tpio->rebase(force);
 }
 
+void
+DB::setGroupCommit(unsigned int windowUs, size_t batchMax)
+{
+	m_tpio->setGroupCommit(windowUs, batchMax);
+}
+
+void
+DB::setEagerWriteback(size_t pgsRun)
+{
+	m_tpio->setEagerWriteback(pgsRun);
+}
+
+void
+DB::setRebaseThreads(unsigned int nthr)
+{
+	m_tpio->setRebaseThreads(nthr);
+}
+
+void
+DB::setSyncBound(unsigned int intervalMs, size_t bytesMax)
+{
+	m_tpio->setSyncBound(intervalMs, bytesMax);
+}
+
+void
+DB::rebaseIfNeeded()
+{
+	if(! m_tpio->needRebase()) return;
+
+	if(! m_helper)
+	{
+		m_tpio->rebase(false);
+		return;
+	}
+
+	// let helper thr do the rebase, so that committing thr won't be blocked
+	if(! PTNK_CAS(&m_bRebaseQueued, false, true)) return;
+	m_helper->enq([this] () {
+		m_tpio->rebase(false);
+
+		PTNK_MEMBARRIER_COMPILER;
+		m_bRebaseQueued = false;
+	});
+}
+
 void
 DB::newPart(bool doRebase)
 {
@@ -493,11 +917,12 @@ DB::compactFast()
 	m_tpio->refreshOldPages(threshold);
 	std::cout << "refreshOldPages done." << std::endl;
 
-	// wait for end of txs started before refresh old pages
-	m_tpio->join();
-	
-	m_pio->discardOldPages(threshold);
-	std::cout << "discardOldPages done." << std::endl;
+	// discard old partitions after txs started before refresh old pages are done
+	shared_ptr<PageIO> pio = m_pio;
+	m_tpio->retire([pio, threshold] () {
+		pio->discardOldPages(threshold);
+		std::cout << "discardOldPages done." << std::endl;
+	});
 }
 
 void
@@ -5,15 +5,23 @@
 #include "query.h"
 #include "toc.h"
 
+#include <functional>
+#include <future>
+#include <exception>
+
 namespace ptnk
 {
 
 class TPIO;
 class TPIOTxSession;
+class TPIOSnapshot;
 
 class PageIO;
 class Helper;
 
+struct btree_append_hint_t;
+struct btree_bulkload_src_t;
+
 class DB
 {
 public:
@@ -100,6 +108,11 @@ public:
 			put(key, value);
 		}
 
+		//! load kv records sorted by key into the empty table _table_ at once (see btree_bulkload())
+		void bulkLoad(BufferCRef table, btree_bulkload_src_t* src);
+		//! load kv records sorted by key into the empty default table at once
+		void bulkLoad(btree_bulkload_src_t* src);
+
 		struct cursor_t;
 		static void curClose(cursor_t* cur);
 
@@ -125,12 +138,33 @@ public:
 
 		bool tryCommit();
 
+		//! called once the committed tx is durable. _err_ is set if the disk write failed
+		typedef std::function<void (std::exception_ptr err)> DurableCallback;
+
+		//! try committing the tx w/o waiting for the disk write
+		/*!
+		 *	Returns as soon as the tx is validated. Its writes are visible to txs started after this.
+		 *	W/ OAUTOSYNC, the tx pages are synced in background (on helper thr if OHELPERTHREAD).
+		 *
+		 *	@param [in] cbDurable
+		 *		called once the tx is durable, possibly on another thr or before this returns.
+		 *		not called if the commit failed.
+		 *
+		 *	@return
+		 *		true if the tx was committed
+		 */
+		bool tryCommitAsync(DurableCallback cbDurable);
+
+		//! same as above, but the completion is notified via _durable_
+		/*!
+		 *	@param [out] durable
+		 *		set on success. becomes ready once the tx is durable (rethrows disk write error on get())
+		 */
+		bool tryCommitAsync(std::shared_future<void>* durable);
+
 		void dumpStat() const;
 
-		TPIOTxSession* pio()
-		{
-			return m_pio.get();	
-		}
+		TPIOTxSession* pio();
 
 	private:
 		Tx(DB* db, unique_ptr<TPIOTxSession> pio);
@@ -138,20 +172,128 @@ public:
 		cursor_t* curNew(BufferCRef table);
 		cursor_t* curNew(TableOffCache* table);
 
+		//! try committing the tx on the latest snapshot after page level conflict
+		/*!
+		 *	If none of the keys the tx has read / written has been changed since the tx snapshot,
+		 *	the conflict was a false one caused by page granularity (e.g. diff keys in the same leaf).
+		 *	The key ops of the tx are then replayed on the latest snapshot and committed.
+		 *
+		 *	@return
+		 *		true if the tx was committed
+		 */
+		bool tryResolveConflict(const DurableCallback& cbDurable);
+
+		//! tryCommit impl. waits for the disk write if _cbDurable_ is empty
+		bool tryCommitImpl(const DurableCallback& cbDurable);
+
+		enum
+		{
+			RESOLVE_RETRY = 3, //!< max num of replays tried in tryResolveConflict
+		};
+
+		//! record key op to m_oplog
+		/*!
+		 *	@param [in] table
+		 *		table id. NULL for default table
+		 */
+		void logOp(bool bPut, const BufferCRef* table, BufferCRef key, BufferCRef value = BufferCRef::NULL_VAL, put_mode_t mode = PUT_UPDATE);
+
+		//! rightmost leaf hint for sequential puts into the table w/ root _pgidRoot_
+		btree_append_hint_t* appendHint(page_id_t pgidRoot);
+
 		bool m_bCommitted;
 
 		DB* m_db;
 		unique_ptr<TPIOTxSession> m_pio;
 
+		//! key ops done in the tx (for tryResolveConflict)
+		struct oplog_t;
+		unique_ptr<oplog_t> m_oplog;
+
+		//! false if the tx has done ops which are not recorded in m_oplog (cursor / table ops)
+		bool m_bReplayable;
+
+		//! rightmost leaf hints of recently put tables. reset on modifications other than put
+		struct hints_t;
+		unique_ptr<hints_t> m_hints;
+
 		friend class DB;
 	};
 	friend class Tx;
 	Tx* newTransaction();
 
+	//! read-only transaction class
+	/*!
+	 *	Sees a snapshot of committed txs, like Tx does.
+	 *	As nothing can be written, it is much cheaper to start and end than Tx.
+	 */
+	class Snapshot
+	{
+	public:
+		~Snapshot();
+
+		ssize_t get(BufferCRef table, BufferCRef key, BufferRef value);
+		void get(BufferCRef table, BufferCRef key, Buffer* value)
+		{
+			value->setValsize(get(table, key, value->wref()));
+		}
+
+		ssize_t get(TableOffCache* table, BufferCRef key, BufferRef value);
+		void get(TableOffCache* table, BufferCRef key, Buffer* value)
+		{
+			value->setValsize(get(table, key, value->wref()));
+		}
+
+		ssize_t get(BufferCRef key, BufferRef value);
+		void get(BufferCRef key, Buffer* value)
+		{
+			value->setValsize(get(key, value->wref()));
+		}
+
+		ssize_t get_k32u(uint32_t nkey, BufferRef value)
+		{
+			uint32_t kb = PTNK_BSWAP32(nkey); BufferCRef key(&kb, 4);
+			return get(key, value);
+		}
+		void get_k32u(uint32_t nkey, Buffer* value)
+		{
+			uint32_t kb = PTNK_BSWAP32(nkey); BufferCRef key(&kb, 4);
+			get(key, value);
+		}
+
+	private:
+		Snapshot(DB* db, unique_ptr<TPIOSnapshot> pio);
+
+		DB* m_db;
+		unique_ptr<TPIOSnapshot> m_pio;
+
+		friend class DB;
+	};
+	friend class Snapshot;
+	Snapshot* newSnapshot();
+
 	void rebase(bool force = true);
 	void newPart(bool doRebase = true);
 	void compactFast();
 
+	//! tune group commit of OAUTOSYNC syncs. see TPIO::setGroupCommit
+	void setGroupCommit(unsigned int windowUs, size_t batchMax);
+
+	//! start writeback of large tx pages before commit. see TPIO::setEagerWriteback
+	void setEagerWriteback(size_t pgsRun);
+
+	//! set num thrs rebase runs on. see TPIO::setRebaseThreads
+	void setRebaseThreads(unsigned int nthr);
+
+	//! write checkpoint of ovr table on close for faster reopen (default: true). see TPIO::checkpoint
+	void setCheckpointOnClose(bool b)
+	{
+		m_bCheckpointOnClose = b;
+	}
+
+	//! tune loss bound of OBOUNDEDSYNC commits. see TPIO::setSyncBound
+	void setSyncBound(unsigned int intervalMs, size_t bytesMax);
+
 	// ====== inspectors ======
 	
 	void dump() const;
@@ -169,6 +311,17 @@ public:
 private:
 	void handleHookAddNewPartition();
 
+	//! rebase if TPIO's RebasePolicy says so. done on helper thr if available
+	void rebaseIfNeeded();
+
+	//! checkpoint TPIO state on helper thr (if any) before it is stopped
+	void closeCheckpoint();
+
+	//! true if rebase job is queued to helper thr
+	bool m_bRebaseQueued;
+
+	bool m_bCheckpointOnClose;
+
 	shared_ptr<PageIO> m_pio;
 	unique_ptr<TPIO> m_tpio;
 
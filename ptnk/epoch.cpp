@@ -0,0 +1,321 @@
+#include "epoch.h"
+#include "helperthr.h"
+#include "exceptions.h"
+
+#include <assert.h>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+#include <condition_variable>
+
+namespace ptnk
+{
+
+namespace
+{
+
+volatile uint64_t g_idNext = 1;
+
+//! id of this thr. 0 if not yet assigned
+__thread uint64_t t_idThr = 0;
+
+//! single entry cache of EpochManager::localRecord
+__thread uint64_t t_idCached = 0;
+__thread EpochManager::Record* t_recCached = nullptr;
+
+//! ids of EpochManagers alive. guards records from being released after the manager is gone
+std::mutex g_mtxLive;
+std::unordered_set<uint64_t> g_live;
+
+//! records owned by this thr. released on thr exit
+struct ThrRecords
+{
+	struct ent_t
+	{
+		uint64_t idEM;
+		EpochManager::Record* rec;
+	};
+	std::vector<ent_t> ents;
+
+	~ThrRecords()
+	{
+		std::lock_guard<std::mutex> g(g_mtxLive);
+		for(const ent_t& e: ents)
+		{
+			if(g_live.count(e.idEM)) e.rec->owner = 0;
+		}
+	}
+
+	//! forget records of managers already gone
+	/*!
+	 *	@note g_mtxLive must be held
+	 */
+	void prune()
+	{
+		auto itE = std::remove_if(ents.begin(), ents.end(), [] (const ent_t& e) { return g_live.count(e.idEM) == 0; });
+		ents.erase(itE, ents.end());
+	}
+};
+thread_local ThrRecords t_records;
+
+} // end of anonymous namespace
+
+EpochManager::EpochManager()
+:	m_epoch(1),
+	m_records(nullptr),
+	m_id(__sync_fetch_and_add(&g_idNext, 1)),
+	m_nPending(0),
+	m_helper(nullptr),
+	m_bReclaimQueued(false)
+{
+	std::lock_guard<std::mutex> g(g_mtxLive);
+	g_live.insert(m_id);
+}
+
+EpochManager::~EpochManager()
+{
+	{
+		std::lock_guard<std::mutex> g(g_mtxLive);
+		g_live.erase(m_id);
+	}
+
+	for(retired_t& r: m_retired)
+	{
+		r.cb();
+	}
+	m_retired.clear();
+
+	Record* rec = m_records;
+	while(rec)
+	{
+		Record* next = rec->next;
+		assert(rec->state == 0); // no tx should be active on destruction (can't throw from d-tor)
+		delete rec;
+		rec = next;
+	}
+}
+
+EpochManager::Record*
+EpochManager::localRecord()
+{
+	if(PTNK_LIKELY(t_idCached == m_id))
+	{
+		return t_recCached;
+	}
+
+	if(! t_idThr)
+	{
+		t_idThr = __sync_fetch_and_add(&g_idNext, 1);
+	}
+
+	Record* rec = nullptr;
+	for(const ThrRecords::ent_t& e: t_records.ents)
+	{
+		if(e.idEM == m_id) { rec = e.rec; break; }
+	}
+
+	if(! rec)
+	{
+		// reuse record released by exited thr
+		for(Record* r = m_records; r; r = r->next)
+		{
+			if(r->owner == 0 && PTNK_CAS(&r->owner, 0, t_idThr)) { rec = r; break; }
+		}
+
+		if(! rec)
+		{
+			rec = new Record;
+			rec->state = 0;
+			rec->owner = t_idThr;
+
+			Record* head;
+			do
+			{
+				head = m_records;
+				rec->next = head;
+			}
+			while(! PTNK_CAS(&m_records, head, rec));
+		}
+
+		std::lock_guard<std::mutex> g(g_mtxLive);
+		t_records.prune();
+
+		ThrRecords::ent_t e = {m_id, rec};
+		t_records.ents.push_back(e);
+	}
+
+	t_idCached = m_id;
+	t_recCached = rec;
+	return rec;
+}
+
+EpochManager::Record*
+EpochManager::enter()
+{
+	Record* rec = localRecord();
+
+	for(;;)
+	{
+		const uint64_t o = rec->state;
+		PTNK_MEMBARRIER_COMPILER;
+
+		uint64_t n;
+		if((o & NEST_MASK) == 0)
+		{
+			n = (m_epoch << NEST_BITS) | 1;
+		}
+		else
+		{
+			PTNK_CHECK((o & NEST_MASK) != NEST_MASK);
+			n = o + 1;
+		}
+
+		// CAS also acts as a full barrier. reads by the tx won't go before this
+		if(PTNK_CAS(&rec->state, o, n)) break;
+	}
+
+	return rec;
+}
+
+void
+EpochManager::leave(Record* rec)
+{
+	uint64_t n;
+	for(;;)
+	{
+		const uint64_t o = rec->state;
+		PTNK_MEMBARRIER_COMPILER;
+		PTNK_ASSERT((o & NEST_MASK) != 0);
+
+		n = ((o & NEST_MASK) == 1) ? 0 : o - 1;
+		if(PTNK_CAS(&rec->state, o, n)) break;
+	}
+
+	if(n == 0 && m_nPending > 0)
+	{
+		scheduleReclaim();
+	}
+}
+
+void
+EpochManager::retire(Callback cb)
+{
+	{
+		std::lock_guard<std::mutex> g(m_mtxRetired);
+
+		// txs which may have seen the obj have entered in or before the current epoch
+		const uint64_t epoch = __sync_fetch_and_add(&m_epoch, 1);
+
+		retired_t r = {epoch, std::move(cb)};
+		m_retired.push_back(std::move(r));
+		++ m_nPending;
+	}
+
+	scheduleReclaim();
+}
+
+void
+EpochManager::synchronize()
+{
+	std::mutex mtx;
+	std::condition_variable cond;
+	bool done = false;
+
+	retire([&mtx, &cond, &done]() {
+		std::lock_guard<std::mutex> g(mtx);
+		done = true;
+		cond.notify_all();
+	});
+
+	std::unique_lock<std::mutex> g(mtx);
+	while(! done)
+	{
+		cond.wait(g);
+	}
+}
+
+uint64_t
+EpochManager::minActiveEpoch() const
+{
+	// epoch must be read before scanning records:
+	// txs which enter after the scan won't see objs retired before the read
+	uint64_t ret = m_epoch;
+	PTNK_MEMBARRIER_HW;
+
+	for(Record* r = m_records; r; r = r->next)
+	{
+		const uint64_t s = r->state;
+		if(s & NEST_MASK)
+		{
+			ret = std::min(ret, s >> NEST_BITS);
+		}
+	}
+
+	return ret;
+}
+
+size_t
+EpochManager::reclaim()
+{
+	std::vector<Callback> ready;
+	{
+		std::lock_guard<std::mutex> g(m_mtxRetired);
+		if(m_retired.empty()) return 0;
+
+		const uint64_t epochMin = minActiveEpoch();
+		while(! m_retired.empty() && m_retired.front().epoch < epochMin)
+		{
+			ready.push_back(std::move(m_retired.front().cb));
+			m_retired.pop_front();
+		}
+		m_nPending -= ready.size();
+	}
+
+	// run callbacks outside the lock, as they may retire other objs
+	for(Callback& cb: ready)
+	{
+		cb();
+	}
+
+	return ready.size();
+}
+
+size_t
+EpochManager::numRecords() const
+{
+	size_t ret = 0;
+	for(Record* r = m_records; r; r = r->next)
+	{
+		++ ret;
+	}
+
+	return ret;
+}
+
+void
+EpochManager::attachHelper(Helper* helper)
+{
+	PTNK_CHECK(! m_helper);
+
+	m_helper = helper;
+}
+
+void
+EpochManager::scheduleReclaim()
+{
+	if(! m_helper)
+	{
+		reclaim();
+		return;
+	}
+
+	if(! PTNK_CAS(&m_bReclaimQueued, false, true)) return;
+	m_helper->enq([this] () {
+		m_bReclaimQueued = false;
+		PTNK_MEMBARRIER_HW;
+
+		reclaim();
+	});
+}
+
+} // end of namespace ptnk
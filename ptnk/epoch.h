@@ -0,0 +1,150 @@
+#ifndef _ptnk_epoch_h_
+#define _ptnk_epoch_h_
+
+#include "common.h"
+#include <mutex>
+#include <deque>
+#include <functional>
+
+namespace ptnk
+{
+
+class Helper;
+
+//! epoch based reclamation
+/*!
+ *	Txs enter the epoch domain before they take their snapshot and leave it when they are done.
+ *	Objects which are no longer reachable from new snapshots (pages below compaction threshold,
+ *	ActiveOvr generations replaced by rebase, ...) are retired w/ a callback,
+ *	which is run once all txs entered before the retirement have left.
+ *
+ *	Each thread has its own epoch record, so that entering / leaving doesn't contend w/ other thrs.
+ *	A record is active while any of txs started on the thr is alive,
+ *	and holds the global epoch at the time the first of them entered.
+ *	(so a thr which keeps overlapping txs alive delays reclamation)
+ *	There's no limit on num of txs inside the domain (up to 64k nested per thr).
+ *
+ *	Records are padded to their own cachelines, and released on thr exit to be reused by new thrs,
+ *	so the registry stays as large as the max num of thrs alive at once.
+ *
+ *	Callbacks are run on the helper thr if attached.
+ *	Otherwise, they are run by the thr which leaves the domain last.
+ *	Either way, retire() itself never blocks.
+ */
+class EpochManager : noncopyable
+{
+public:
+	EpochManager();
+
+	//! runs all pending callbacks. all txs should have left
+	~EpochManager();
+
+	struct Record
+	{
+		//! global epoch when first tx entered << NEST_BITS | num txs inside. 0 if no tx is inside
+		volatile uint64_t state;
+
+		//! id of the thr owning this record. 0 if free
+		volatile uint64_t owner;
+
+		Record* next;
+
+		//! pad to 2 cachelines, so that _state_ of other thrs' records are never on the same line
+		char pad[128 - sizeof(uint64_t)*2 - sizeof(Record*)];
+	};
+
+	//! enter the epoch domain from the calling thr
+	/*!
+	 *	@return
+	 *		record to be passed to leave(). leave() may be called from another thr
+	 */
+	Record* enter();
+	void leave(Record* rec);
+
+	//! RAII helper for enter / leave
+	class Guard : noncopyable
+	{
+	public:
+		Guard(EpochManager* em)
+		:	m_em(em), m_rec(em->enter())
+		{ /* NOP */ }
+
+		~Guard()
+		{
+			m_em->leave(m_rec);
+		}
+
+	private:
+		EpochManager* m_em;
+		Record* m_rec;
+	};
+
+	typedef std::function<void ()> Callback;
+
+	//! run _cb_ after all txs entered before this call have left
+	void retire(Callback cb);
+
+	//! block until all txs entered before this call have left
+	/*!
+	 *	@note calling thr must not be inside the domain
+	 */
+	void synchronize();
+
+	//! run callbacks whose grace period has passed
+	/*!
+	 *	@return num callbacks run
+	 */
+	size_t reclaim();
+
+	void attachHelper(Helper* helper);
+
+	uint64_t epoch() const
+	{
+		return m_epoch;
+	}
+
+	size_t numPending() const
+	{
+		return m_nPending;
+	}
+
+	//! num records ever alloced (max num of thrs entered at once)
+	size_t numRecords() const;
+
+private:
+	enum { NEST_BITS = 16 };
+	static constexpr uint64_t NEST_MASK = (1ULL << NEST_BITS) - 1;
+
+	Record* localRecord();
+
+	//! oldest epoch which may still be observed by txs inside the domain
+	uint64_t minActiveEpoch() const;
+
+	void scheduleReclaim();
+
+	volatile uint64_t m_epoch;
+
+	//! linked list of per-thr records. records are never removed until destruction
+	Record* volatile m_records;
+
+	//! unique id of this obj. used as key of thr local record cache
+	uint64_t m_id;
+
+	struct retired_t
+	{
+		uint64_t epoch; //!< epoch the obj was retired in
+		Callback cb;
+	};
+	std::mutex m_mtxRetired;
+	std::deque<retired_t> m_retired;
+	volatile size_t m_nPending;
+
+	Helper* m_helper;
+
+	//! true if reclaim job is queued to helper thr
+	volatile bool m_bReclaimQueued;
+};
+
+} // end of namespace ptnk
+
+#endif // _ptnk_epoch_h_
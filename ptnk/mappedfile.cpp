@@ -317,6 +317,38 @@ MappedFile::sync(local_pgid_t pgidStart, local_pgid_t pgidEnd)
 #endif
 }
 
+void
+MappedFile::writeback(local_pgid_t pgidStart, local_pgid_t pgidEnd)
+{
+	if(m_bInMem) return;
+
+#if defined(PTNK_SYNC_FILE_RANGE) && ! defined(PTNK_FDATASYNC)
+	if(pgidEnd > m_numPagesReserved) pgidEnd = m_numPagesReserved;
+
+	loff_t off = ((loff_t)pgidStart) * PTNK_PAGE_SIZE;
+	loff_t len = ((loff_t)(pgidEnd - pgidStart + 1)) * PTNK_PAGE_SIZE;
+	if(len < 0) return;
+	PTNK_ASSURE_SYSCALL(::sync_file_range(m_fd, off, len, SYNC_FILE_RANGE_WRITE));
+#else
+	// NOP: msync(MS_ASYNC) doesn't start writeback on linux
+	(void)pgidStart; (void)pgidEnd;
+#endif
+}
+
+void
+MappedFile::prefetch(local_pgid_t pgidStart, local_pgid_t pgidEnd)
+{
+	if(m_bInMem || m_numPagesReserved == 0) return;
+
+	if(pgidEnd >= m_numPagesReserved) pgidEnd = m_numPagesReserved - 1;
+	if(pgidStart > pgidEnd) return;
+
+	loff_t off = ((loff_t)pgidStart) * PTNK_PAGE_SIZE;
+	loff_t len = ((loff_t)(pgidEnd - pgidStart + 1)) * PTNK_PAGE_SIZE;
+	// only a hint. failure is not an error
+	::posix_fadvise(m_fd, off, len, POSIX_FADV_WILLNEED);
+}
+
 void
 MappedFile::makeReadOnly()
 {
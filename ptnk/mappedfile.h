@@ -46,6 +46,12 @@ public:
 	char* calcPtr(local_pgid_t pgid);
 	void sync(local_pgid_t pgidStart, local_pgid_t pgidEnd);
 
+	//! start writeback of the pages w/o waiting for it
+	void writeback(local_pgid_t pgidStart, local_pgid_t pgidEnd);
+
+	//! start reading the pages into page cache w/o waiting for it
+	void prefetch(local_pgid_t pgidStart, local_pgid_t pgidEnd);
+
 	bool isReadOnly() const { return m_isReadOnly; }
 	void makeReadOnly();
 
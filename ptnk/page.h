@@ -37,6 +37,9 @@ enum page_type_t_
 	//! compaction map page
 	PT_COMPMAP,
 
+	//! ovr table checkpoint page
+	PT_OVRCHECKPOINT,
+
 	PT_DEBUG,
 	PT_DEBUG_BINARYTREE,
 
@@ -69,6 +72,12 @@ struct page_hdr_t
 
 		//! this transaction is rebase transaction (valid only w/ PF_END_TX)
 		PF_TX_REBASE = 1 << 2,
+
+		//! streak of the transaction is in compact format (see TPIO::commitTxPages)
+		PF_STREAK_COMPACT = 1 << 3,
+
+		//! streak of the transaction lists its pages written back before commit, which are left unstamped (see TPIO::commitTxPages)
+		PF_STREAK_EAGER = 1 << 4,
 	};
 	flags_t flags;
 } __attribute__((__packed__));
@@ -199,6 +208,7 @@ public:
 		
 		hdr()->id = idNew;
 		hdr()->type = pg.hdr()->type;
+		hdr()->flags = 0; // _idNew_ may be a reused page. it stays uncommitted until the tx stamps it
 		if(pg.isBase() || pg.hdr()->idOvrTgt == PGID_INVALID)
 		{
 			hdr()->idOvrTgt = pg.hdr()->id;
@@ -53,6 +53,18 @@ PageIO::syncRange(page_id_t pgidStart, page_id_t pgidEnd)
 	}
 }
 
+void
+PageIO::writebackRange(page_id_t pgidStart, page_id_t pgidEnd)
+{
+	/* NOP */
+}
+
+void
+PageIO::prefetchRange(page_id_t pgidStart, page_id_t pgidEnd)
+{
+	/* NOP */
+}
+
 page_id_t
 PageIO::getFirstPgId() const
 {
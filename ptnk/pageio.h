@@ -95,6 +95,15 @@ public:
 	//! notify PageIO content update for the pages where pgidStart <= pgid < pgidEnd
 	virtual void syncRange(page_id_t pgidStart, page_id_t pgidEnd);
 
+	//! hint PageIO to start writing out the pages where pgidStart <= pgid <= pgidEnd w/o waiting
+	/*!
+	 *	The pages may be modified afterwards. syncRange is still needed to make them durable.
+	 */
+	virtual void writebackRange(page_id_t pgidStart, page_id_t pgidEnd);
+
+	//! hint PageIO that the pages where pgidStart <= pgid <= pgidEnd will be read soon
+	virtual void prefetchRange(page_id_t pgidStart, page_id_t pgidEnd);
+
 	//! pgid of the youngest page accessible
 	virtual page_id_t getFirstPgId() const;
 
@@ -183,6 +183,14 @@ PageIOMem::syncRange(page_id_t pgidStart, page_id_t pgidEnd)
 	m_mf->sync(pgidStart, pgidEnd);
 }
 
+void
+PageIOMem::writebackRange(page_id_t pgidStart, page_id_t pgidEnd)
+{
+	if(!m_sync || !m_isFile) return;
+
+	m_mf->writeback(pgidStart, pgidEnd);
+}
+
 void
 PageIOMem::scanLastPgId()
 {
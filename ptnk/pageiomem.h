@@ -22,6 +22,7 @@ public:
 	virtual Page readPage(page_id_t pgid);
 	virtual void sync(page_id_t pgid);
 	virtual void syncRange(page_id_t pgidStart, page_id_t pgidEnd);
+	virtual void writebackRange(page_id_t pgidStart, page_id_t pgidEnd);
 
 	virtual page_id_t getLastPgId() const;
 
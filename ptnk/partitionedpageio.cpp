@@ -410,6 +410,40 @@ PartitionedPageIO::sync(page_id_t pgid)
 
 void
 PartitionedPageIO::syncRange(page_id_t pgidStart, page_id_t pgidEnd)
+{
+	syncRangeImpl(pgidStart, pgidEnd, true);
+}
+
+void
+PartitionedPageIO::writebackRange(page_id_t pgidStart, page_id_t pgidEnd)
+{
+	syncRangeImpl(pgidStart, pgidEnd, false);
+}
+
+void
+PartitionedPageIO::prefetchRange(page_id_t pgidStart, page_id_t pgidEnd)
+{
+	PTNK_ASSERT(pgidStart <= pgidEnd);
+
+	const part_id_t partEnd = PGID_PARTID(pgidEnd);
+	part_id_t partStart;
+	while(PTNK_UNLIKELY((partStart = PGID_PARTID(pgidStart)) != partEnd))
+	{
+		if(m_parts[partStart])
+		{
+			m_parts[partStart]->prefetch(PGID_LOCALID(pgidStart), PTNK_LOCALID_INVALID);
+		}
+		pgidStart = PGID_PARTSTART(partStart + 1);
+	}
+
+	if(m_parts[partStart])
+	{
+		m_parts[partStart]->prefetch(PGID_LOCALID(pgidStart), PGID_LOCALID(pgidEnd));
+	}
+}
+
+void
+PartitionedPageIO::syncRangeImpl(page_id_t pgidStart, page_id_t pgidEnd, bool bWait)
 {
 	PTNK_ASSERT(pgidStart <= pgidEnd);
 
@@ -419,15 +453,25 @@ PartitionedPageIO::syncRange(page_id_t pgidStart, page_id_t pgidEnd)
 	{
 		if(! m_parts[partStart]) return;
 
-		m_parts[partStart]->sync(
-			PGID_LOCALID(pgidStart), PTNK_LOCALID_INVALID
-			);
+		if(bWait)
+		{
+			m_parts[partStart]->sync(PGID_LOCALID(pgidStart), PTNK_LOCALID_INVALID);
+		}
+		else
+		{
+			m_parts[partStart]->writeback(PGID_LOCALID(pgidStart), PTNK_LOCALID_INVALID);
+		}
 		pgidStart = PGID_PARTSTART(partStart + 1);
 	}
 
-	m_parts[partStart]->sync(
-		PGID_LOCALID(pgidStart), PGID_LOCALID(pgidEnd)
-		);
+	if(bWait)
+	{
+		m_parts[partStart]->sync(PGID_LOCALID(pgidStart), PGID_LOCALID(pgidEnd));
+	}
+	else
+	{
+		m_parts[partStart]->writeback(PGID_LOCALID(pgidStart), PGID_LOCALID(pgidEnd));
+	}
 }
 
 page_id_t
@@ -51,6 +51,8 @@ public:
 	virtual Page readPage(page_id_t pgid);
 	virtual void sync(page_id_t pgid);
 	virtual void syncRange(page_id_t pgidStart, page_id_t pgidEnd);
+	virtual void writebackRange(page_id_t pgidStart, page_id_t pgidEnd);
+	virtual void prefetchRange(page_id_t pgidStart, page_id_t pgidEnd);
 
 	virtual page_id_t getLastPgId() const;
 	virtual local_pgid_t getPartLastLocalPgId(part_id_t ptid) const;
@@ -82,6 +84,9 @@ public:
 	size_t numPartitions_() const;
 
 private:
+	//! sync (_bWait_) or start writeback of the pages in range, which may span partitions
+	void syncRangeImpl(page_id_t pgidStart, page_id_t pgidEnd, bool bWait);
+
 	//! open partitioned db files and populate m_parts
 	/*!
 	 *	@return
@@ -1,6 +1,8 @@
 #include "pol.h"
 #include "page.h"
 
+#include <iterator>
+
 namespace ptnk
 {
 
@@ -20,18 +22,40 @@ void
 PagesOldLink::merge(const PagesOldLink& o)
 {
 	// add entries in o
-	std::copy(o.m_impl.begin(), o.m_impl.end(), std::inserter(m_impl, m_impl.begin()));
+	Vpage_id_t merged;
+	merged.reserve(m_impl.size() + o.m_impl.size());
+	std::set_union(m_impl.begin(), m_impl.end(), o.m_impl.begin(), o.m_impl.end(), std::back_inserter(merged));
+	m_impl.swap(merged);
 
 #ifdef DUMP_POL_UPD
 	std::cout << "dump upd: ";
 	for(page_id_t pgid: m_impl)
 	{
-		std::cout << e.pgid << ", ";
+		std::cout << pgid << ", ";
 	}
 	std::cout << std::endl;
 #endif // DUMP_POL_UPD
 }
 
+void
+PagesOldLink::merge(const std::vector<const PagesOldLink*>& os)
+{
+	// concat then sort once, rather than merging one by one
+	size_t n = m_impl.size();
+	for(const PagesOldLink* o: os)
+	{
+		n += o->m_impl.size();
+	}
+	m_impl.reserve(n);
+	for(const PagesOldLink* o: os)
+	{
+		m_impl.insert(m_impl.end(), o->m_impl.begin(), o->m_impl.end());
+	}
+
+	std::sort(m_impl.begin(), m_impl.end());
+	m_impl.erase(std::unique(m_impl.begin(), m_impl.end()), m_impl.end());
+}
+
 void
 PagesOldLink::dumpStr(std::ostream& s) const
 {
@@ -4,25 +4,67 @@
 #include "types.h"
 #include "buffer.h"
 
+#include <algorithm>
+
 namespace ptnk
 {
 
+//! set of pages w/ links to already overridden pages
+/*!
+ *	Kept as a sorted vector of pgids, as the set is built mostly by appending
+ *	and read on rebase by merging and binary searching.
+ */
 class PagesOldLink
 {
 public:
+	enum
+	{
+		NPOS = ~(size_t)0
+	};
+
 	PagesOldLink();
 	~PagesOldLink();
 
 	void add(page_id_t pgid)
 	{
-		m_impl.insert(pgid);
+		if(m_impl.empty() || m_impl.back() < pgid)
+		{
+			m_impl.push_back(pgid);
+			return;
+		}
+
+		Vpage_id_t::iterator it = std::lower_bound(m_impl.begin(), m_impl.end(), pgid);
+		if(*it != pgid) m_impl.insert(it, pgid);
+	}
+
+	//! add pgids in [b, e), which need not be sorted
+	template<typename It>
+	void addRange(It b, It e)
+	{
+		const size_t nPrev = m_impl.size();
+		m_impl.insert(m_impl.end(), b, e);
+		std::sort(m_impl.begin() + nPrev, m_impl.end());
+		std::inplace_merge(m_impl.begin(), m_impl.begin() + nPrev, m_impl.end());
+		m_impl.erase(std::unique(m_impl.begin(), m_impl.end()), m_impl.end());
 	}
 
 	void merge(const PagesOldLink& o);
 
+	//! merge entries of all _os_ at once
+	void merge(const std::vector<const PagesOldLink*>& os);
+
 	bool contains(page_id_t pgid) const
 	{
-		return m_impl.find(pgid) != m_impl.end();	
+		return std::binary_search(m_impl.begin(), m_impl.end(), pgid);
+	}
+
+	//! get index of _pgid_ in [0, size()), or NPOS if not contained
+	size_t indexOf(page_id_t pgid) const
+	{
+		Vpage_id_t::const_iterator it = std::lower_bound(m_impl.begin(), m_impl.end(), pgid);
+		if(it == m_impl.end() || *it != pgid) return NPOS;
+
+		return it - m_impl.begin();
 	}
 
 	void clear()
@@ -30,13 +72,23 @@ public:
 		m_impl.clear();	
 	}
 
-	size_t size()
+	size_t size() const
 	{
 		return m_impl.size();	
 	}
 
+	Vpage_id_t::const_iterator begin() const
+	{
+		return m_impl.begin();
+	}
+
+	Vpage_id_t::const_iterator end() const
+	{
+		return m_impl.end();
+	}
+
 	template<typename T>
-	void dump(T& tgt)
+	void dump(T& tgt) const
 	{
 		size_t count = m_impl.size();
 		tgt.write(BufferCRef(&count, sizeof(size_t)));
@@ -54,6 +106,7 @@ public:
 		size_t count;
 		tgt.popFrontTo(&count, sizeof(size_t));
 
+		m_impl.reserve(m_impl.size() + count);
 		for(size_t i = 0; i < count; ++ i)
 		{
 			page_id_t pgid;
@@ -63,13 +116,44 @@ public:
 		}
 	}
 
+	//! dump in compact format: varint count, followed by varint deltas of sorted pgids
+	template<typename T>
+	void dumpCompact(T& tgt) const
+	{
+		Buffer buf; buf.reset();
+		char v[VARINT_SIZE_MAX];
+		buf.append(BufferCRef(v, varint_encode(v, m_impl.size())));
+
+		page_id_t pgidPrev = 0;
+		for(page_id_t pgid: m_impl)
+		{
+			buf.append(BufferCRef(v, varint_encode(v, pgid - pgidPrev)));
+			pgidPrev = pgid;
+		}
+
+		tgt.write(buf.rref());
+	}
+
+	template<typename T>
+	void restoreCompact(T& tgt)
+	{
+		const size_t count = tgt.popFrontVarint();
+
+		m_impl.reserve(m_impl.size() + count);
+		page_id_t pgid = 0;
+		for(size_t i = 0; i < count; ++ i)
+		{
+			pgid += tgt.popFrontVarint();
+
+			add(pgid);
+		}
+	}
+
 	void dumpStr(std::ostream& s) const;
 
 private:
-	//! pages with links to already overrode pages
-	Spage_id_t m_impl;
-
-	friend class TPIO;
+	//! pages with links to already overrode pages, sorted w/o duplicates
+	Vpage_id_t m_impl;
 };
 inline
 std::ostream& operator<<(std::ostream& s, const PagesOldLink& o)
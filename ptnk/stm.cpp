@@ -2,6 +2,9 @@
 #include "exceptions.h"
 #include "sysutils.h"
 
+#include <stdlib.h>
+#include <new>
+
 namespace ptnk
 {
 
@@ -12,93 +15,460 @@ operator<<(std::ostream& s, const OvrEntry& e)
 	return s;
 }
 
-LocalOvr::LocalOvr(OvrEntry* hashOvrs[], ver_t verRead, page_id_t pgidStartPage)
-:	m_pgidStartPageOrig(pgidStartPage),
-	m_pgidStartPage(pgidStartPage),
-	m_verRead(verRead), m_verWrite(0),
-	m_prev(NULL),
-	m_mergeOngoing(false), m_merged(false),
-	m_bTerminator(false)
+OvrArena::OvrArena()
+:	m_chunk(nullptr), m_nchunks(0)
 {
-	if(hashOvrs)
+	/* NOP */
+}
+
+OvrArena::~OvrArena()
+{
+	for(chunk_t* c = m_chunk; c;)
 	{
-		for(int i = 0; i < TPIO_NHASH; ++ i)
+		chunk_t* prev = c->prev;
+		::free(c);
+		c = prev;
+	}
+}
+
+void*
+OvrArena::alloc(size_t size, Stat* stat)
+{
+	size = (size + 7) & ~static_cast<size_t>(7);
+	++ stat->nAlloc;
+
+	for(;;)
+	{
+		chunk_t* c = m_chunk;
+		if(c)
 		{
-			m_hashOvrs[i] = hashOvrs[i];
+			size_t off = __sync_fetch_and_add(&c->used, size);
+			if(off + size <= c->size) return c->data + off;
+
+			// chunk exhausted...
 		}
+
+		// install new chunk
+		size_t csize = std::max(static_cast<size_t>(CHUNK_SIZE), size);
+		chunk_t* cnew = reinterpret_cast<chunk_t*>(::malloc(sizeof(chunk_t) + csize));
+		if(! cnew) throw std::bad_alloc();
+		cnew->prev = c;
+		cnew->size = csize;
+		cnew->used = size;
+
+		if(PTNK_CAS(&m_chunk, c, cnew))
+		{
+			__sync_fetch_and_add(&m_nchunks, 1);
+			++ stat->nChunkAlloc;
+			return cnew->data;
+		}
+		else
+		{
+			// other thr installed new chunk. RETRY!
+			::free(cnew);
+		}
+	}
+}
+
+OvrHash::OvrHash()
+:	m_tbl(nullptr), m_tblFirst(nullptr),
+	m_arena(nullptr), m_arenastat(nullptr)
+{
+	/* NOP */
+}
+
+OvrHash::~OvrHash()
+{
+	if(m_arena) return; // tables are released along w/ the arena
+
+	for(table_t* tbl = m_tblFirst; tbl;)
+	{
+		table_t* next = tbl->next;
+		::free(tbl);
+		tbl = next;
+	}
+}
+
+OvrHash::table_t*
+OvrHash::newTable(size_t nslots)
+{
+	const size_t size = sizeof(table_t) + sizeof(slot_t) * (nslots - 1);
+
+	table_t* tbl;
+	if(m_arena)
+	{
+		tbl = reinterpret_cast<table_t*>(m_arena->alloc(size, m_arenastat));
 	}
 	else
 	{
-		for(int i = 0; i < TPIO_NHASH; ++ i)
+		tbl = reinterpret_cast<table_t*>(::malloc(size));
+		if(! tbl) throw std::bad_alloc();
+	}
+
+	tbl->nslots = nslots;
+	tbl->count = 0;
+	tbl->next = nullptr;
+	tbl->iMigrate = 0;
+	tbl->nMigrated = 0;
+	for(size_t i = 0; i < nslots; ++ i)
+	{
+		tbl->slots[i].pgid = PGID_INVALID;
+		tbl->slots[i].head = nullptr;
+	}
+
+	return tbl;
+}
+
+void
+OvrHash::discardTable(table_t* tbl)
+{
+	// table allocated from arena is left there until the arena is destructed
+	if(! m_arena) ::free(tbl);
+}
+
+OvrHash::slot_t*
+OvrHash::claimSlot(table_t* tbl, page_id_t pgid)
+{
+	const size_t mask = tbl->nslots - 1;
+	size_t i = hashs(pgid) & mask;
+	for(size_t nprobe = 0; nprobe < tbl->nslots; ++ nprobe, i = (i + 1) & mask)
+	{
+		slot_t& s = tbl->slots[i];
+		if(PTNK_UNLIKELY(isFrozen(s.head))) return nullptr;
+
+		page_id_t p = s.pgid;
+		if(p == pgid) return &s;
+		if(p == PGID_INVALID)
 		{
-			m_hashOvrs[i] = nullptr;
+			if(PTNK_CAS(&s.pgid, PGID_INVALID, pgid))
+			{
+				__sync_fetch_and_add(&tbl->count, 1);
+				return &s;
+			}
+			else if(s.pgid == pgid)
+			{
+				// other thr claimed the slot for the same pgid
+				return &s;
+			}
 		}
 	}
+
+	// table full. (only possible when many thrs claim slots at once)
+	return nullptr;
 }
 
-LocalOvr::~LocalOvr()
+bool
+OvrHash::pushTo(table_t* tbl, OvrEntry* e)
+{
+	slot_t* s = claimSlot(tbl, e->pgidOrig);
+	if(! s) return false;
+
+	for(;;)
+	{
+		OvrEntry* h = s->head;
+		if(PTNK_UNLIKELY(isFrozen(h))) return false;
+
+		// _e_ already pushed
+		if(h == e || (h && h->ver > e->ver)) return true;
+
+		e->prev = h;
+		if(PTNK_CAS(&s->head, h, e)) return true;
+	}
+}
+
+void
+OvrHash::push(OvrEntry* e)
 {
-	if(! m_merged)
+	for(;;)
 	{
-		// OvrEntry ownership not transferred to ActiveOvr...
+		table_t* tbl = m_tbl;
+		if(PTNK_UNLIKELY(! tbl || tbl->next || (tbl->count + 1) * 2 > tbl->nslots))
+		{
+			grow(size() + 1);
+			continue;
+		}
 
-		// need to delete "OvrEntry"s this has created
+		if(pushTo(tbl, e)) return;
 
-		for(int i = 0; i < TPIO_NHASH; ++ i)
+		// _tbl_ got frozen while pushing. help migration and RETRY!
+		helpGrow(tbl, 0);
+	}
+}
+
+void
+OvrHash::erase(page_id_t pgid)
+{
+	table_t* tbl = m_tbl;
+	if(! tbl) return;
+
+	const size_t mask = tbl->nslots - 1;
+	for(size_t i = hashs(pgid) & mask;; i = (i + 1) & mask)
+	{
+		slot_t& s = tbl->slots[i];
+		if(s.pgid == pgid)
 		{
-			for(OvrEntry* e = m_hashOvrs[i]; e && e->ver == LocalOvr::TAG_TXVER_LOCAL;)
-			{
-				OvrEntry* prev = e->prev;
-				delete e;
-				e = prev;
-			}
+			// leave pgid as a tombstone, so that probe sequences of other pgids won't break
+			s.head = nullptr;
+			return;
+		}
+		if(s.pgid == PGID_INVALID) return;
+	}
+}
+
+void
+OvrHash::grow(size_t n)
+{
+	table_t* tbl = m_tbl;
+	if(tbl)
+	{
+		helpGrow(tbl, n);
+		return;
+	}
+
+	// install first table
+	size_t nslotsNew = NSLOTS_MIN;
+	while(n * 2 > nslotsNew) nslotsNew <<= 1;
+
+	table_t* tblNew = newTable(nslotsNew);
+	if(PTNK_CAS(&m_tbl, nullptr, tblNew))
+	{
+		m_tblFirst = tblNew;
+	}
+	else
+	{
+		// other thr installed the table
+		discardTable(tblNew);
+	}
+}
+
+void
+OvrHash::helpGrow(table_t* tbl, size_t n)
+{
+	// step 1: set up new table if no other thr has done so
+	table_t* tblNew = tbl->next;
+	if(! tblNew)
+	{
+		n = std::max(n, tbl->count + 1);
+		size_t nslotsNew = tbl->nslots * 2;
+		while(n * 2 > nslotsNew) nslotsNew <<= 1;
+
+		tblNew = newTable(nslotsNew);
+		if(! PTNK_CAS(&tbl->next, nullptr, tblNew))
+		{
+			discardTable(tblNew);
+			tblNew = tbl->next;
+		}
+	}
+
+	// step 2: migrate slots chunk by chunk along w/ other thrs
+	const size_t nslots = tbl->nslots;
+	for(;;)
+	{
+		const size_t iBegin = __sync_fetch_and_add(&tbl->iMigrate, MIGRATE_CHUNK);
+		if(iBegin >= nslots) break;
+
+		const size_t iEnd = std::min(iBegin + MIGRATE_CHUNK, nslots);
+		for(size_t i = iBegin; i < iEnd; ++ i)
+		{
+			migrateSlot(tbl, i, tblNew);
+		}
+		__sync_fetch_and_add(&tbl->nMigrated, iEnd - iBegin);
+	}
+
+	// step 3: chunks taken by other thrs may not be done yet.
+	//         Instead of waiting for them, migrate them here (migration is idempotent)
+	if(tbl->nMigrated < nslots)
+	{
+		for(size_t i = 0; i < nslots; ++ i)
+		{
+			migrateSlot(tbl, i, tblNew);
+		}
+	}
+
+	// step 4: publish new table
+	PTNK_MEMBARRIER_HW; // all slots must be migrated before publishing new table
+	PTNK_CAS(&m_tbl, tbl, tblNew);
+}
+
+void
+OvrHash::migrateSlot(table_t* tbl, size_t i, table_t* tblNew)
+{
+	slot_t& s = tbl->slots[i];
+
+	// freeze the slot so that no entry is pushed to it anymore
+	OvrEntry* h;
+	for(;;)
+	{
+		h = s.head;
+		if(isFrozen(h)) break;
+		if(PTNK_CAS(&s.head, h, reinterpret_cast<OvrEntry*>(reinterpret_cast<uintptr_t>(h) | TAG_FROZEN))) break;
+	}
+
+	OvrEntry* e = untag(h);
+	if(! e) return; // empty slot or tombstone
+
+	slot_t* sNew = claimSlot(tblNew, s.pgid);
+	if(! sNew)
+	{
+		// _tblNew_ is already published and being grown further,
+		// which means that migration of _tbl_ has been completed by other thr
+		return;
+	}
+
+	// fails if the slot has already been migrated by other thr
+	PTNK_CAS(&sNew->head, nullptr, e);
+}
+
+bool PgidBloomFilter::s_bypass = false;
+
+void
+PgidBloomFilter::resize(size_t nEntries, OvrArena* arena, OvrArena::Stat* stat)
+{
+	// new size: power of 2 words, leaving room to grow 2x before next rebuild
+	size_t nwords = NWORDS_INLINE;
+	while(nwords * WORD_BITS < nEntries * BITS_PER_ENTRY * 2) nwords <<= 1;
+
+	if(nwords != m_nwords)
+	{
+		if(m_bvHeap) delete[] m_bv;
+
+		if(arena)
+		{
+			m_bv = reinterpret_cast<word_t*>(arena->alloc(nwords * sizeof(word_t), stat));
+			m_bvHeap = false;
 		}
+		else
+		{
+			m_bv = new word_t[nwords];
+			m_bvHeap = true;
+		}
+		m_nwords = nwords;
 	}
+	::memset(m_bv, 0, m_nwords * sizeof(word_t));
+}
+
+bool
+PgidBloomFilter::mayContain(const PgidBloomFilter& o) const
+{
+	if(PTNK_UNLIKELY(s_bypass)) return true;
+
+	// fold the larger filter onto the smaller one.
+	// As the sizes are power of 2, bit _b_ in the larger filter corresponds to bit (b mod nbits_small) in the smaller one.
+	const PgidBloomFilter& l = (m_nwords >= o.m_nwords) ? *this : o;
+	const PgidBloomFilter& s = (m_nwords >= o.m_nwords) ? o : *this;
+	const size_t maskS = s.m_nwords - 1;
+	int nCommon = 0;
+	for(size_t i = 0; i < l.m_nwords; ++ i)
+	{
+		nCommon += __builtin_popcountll(l.m_bv[i] & s.m_bv[i & maskS]);
+		if(nCommon >= NPROBES) return true;
+	}
+
+	return false;
+}
+
+LocalOvr::LocalOvr(const OvrHash* ovrsGlobal, OvrArena* arena, ver_t verRead, page_id_t pgidStartPage)
+:	m_arena(arena),
+	m_ovrsGlobal(ovrsGlobal),
+	m_pgidStartPageOrig(pgidStartPage),
+	m_pgidStartPage(pgidStartPage),
+	m_verRead(verRead), m_verWrite(0),
+	m_nChainWalk(0),
+	m_nConflictCheck(0), m_nConflictCheckBf(0),
+	m_prev(NULL),
+	m_iMerge(0), m_nMerged(0), m_merged(false),
+	m_bTerminator(false)
+{
+	if(m_arena)
+	{
+		m_ovrsLocal.attachArena(m_arena, &m_allocstat);
+	}
+}
+
+LocalOvr::~LocalOvr()
+{
+	// "OvrEntry"s this has created are allocated from the arena of ActiveOvr.
+	// They are released when the ActiveOvr is destructed.
 }
 
 pair<page_id_t, ovr_status_t>
 LocalOvr::searchOvr(page_id_t pgid)
 {
-	int h = pgidhash(pgid);
+	if(OvrEntry* e = m_ovrsLocal.head(pgid))
+	{
+		return make_pair(e->pgidOvr, OVR_LOCAL);
+	}
+
+	if(m_ovrsGlobal)
+	{
+		for(OvrEntry* e = m_ovrsGlobal->head(pgid); e; e = e->prev)
+		{
+			++ m_nChainWalk;
+			if(e->ver > m_verRead)
+			{
+				// ovr entry is newer than read snapshot
+				continue;
+			}
+
+			return make_pair(e->pgidOvr, OVR_GLOBAL);
+		}
+	}
+
+	return make_pair(pgid, OVR_NONE); // no actie ovr pg found
+}
 
-	for(OvrEntry* e = m_hashOvrs[h]; e; e = e->prev)
+pair<page_id_t, ovr_status_t>
+OvrSnapshot::searchOvr(page_id_t pgid)
+{
+	for(OvrEntry* e = m_ovrsGlobal->head(pgid); e; e = e->prev)
 	{
+		++ m_nChainWalk;
 		if(e->ver > m_verRead)
 		{
 			// ovr entry is newer than read snapshot
 			continue;
 		}
 
-		if(e->pgidOrig == pgid)
-		{
-			ovr_status_t st = (e->ver == TAG_TXVER_LOCAL) ? OVR_LOCAL : OVR_GLOBAL;
-			return make_pair(e->pgidOvr, st);
-		}
+		return make_pair(e->pgidOvr, OVR_GLOBAL);
 	}
 
-	return make_pair(pgid, OVR_NONE); // no actie ovr pg found
+	return make_pair(pgid, OVR_NONE);
 }
 
 void
 LocalOvr::addOvr(page_id_t pgidOrig, page_id_t pgidOvr)
 {
-	m_pgidOrigs.push_back(pgidOrig);
+	if(OvrEntry* e = m_ovrsLocal.head(pgidOrig))
+	{
+		// page already overridden in this tx. just replace the ovr tgt
+		e->pgidOvr = pgidOvr;
+		return;
+	}
 
 	// set up hash
 	{
-		// referencing to elem inside vector is unsafe (realloc will change its addr)
-		OvrEntry* e = new OvrEntry;
+		PTNK_ASSERT(m_arena);
+		OvrEntry* e = m_arena->allocObj<OvrEntry>(&m_allocstat);
 		e->pgidOrig = pgidOrig;
 		e->pgidOvr = pgidOvr;
 		e->ver = TAG_TXVER_LOCAL;
 
-		int h = pgidhash(pgidOrig);
-		e->prev = m_hashOvrs[h];
-		m_hashOvrs[h] = e;
+		m_ovrsLocal.push(e);
 	}
 
 	// add entry to bloom filter
-	m_bfOvrs.add(pgidOrig);
+	if(PTNK_UNLIKELY(m_bfOvrs.needRebuild(m_ovrsLocal.size())))
+	{
+		// filter is getting crowded. rebuild w/ larger one
+		m_bfOvrs.resize(m_ovrsLocal.size(), m_arena, &m_allocstat);
+		m_ovrsLocal.forEach([this](OvrEntry* e) {
+			m_bfOvrs.add(e->pgidOrig);
+		});
+	}
+	else
+	{
+		m_bfOvrs.add(pgidOrig);
+	}
 }
 
 bool
@@ -110,61 +480,26 @@ LocalOvr::checkConflict(LocalOvr* other)
 		return false;
 	}
 
+	++ m_nConflictCheck;
 	if(! other->m_bfOvrs.mayContain(m_bfOvrs))
 	{
 		// a bloomfilter ensures that there are no conflict.
+		++ m_nConflictCheckBf;
 		return false;
 	}
 
-	#if 1
-	ver_t verWOther = other->verWrite();
-	for(int i = 0; i < TPIO_NHASH; ++ i)
-	{
-		for(OvrEntry* eL = m_hashOvrs[i]; eL && eL->ver == TAG_TXVER_LOCAL; eL = eL->prev)
-		{
-			page_id_t pgidL = eL->pgidOrig;
-			if(! other->m_bfOvrs.mayContain(pgidL))
-			{
-				// a bloomfilter ensures that other->m_hashOvrs[i] list would not conflict w/ eL
-				continue;
-			}
-
-			for(OvrEntry* eO = other->m_hashOvrs[i]; eO && (eO->ver == TAG_TXVER_LOCAL || eO->ver == verWOther); eO = eO->prev)
-			{
-				if(eO->pgidOrig == pgidL)
-				{
-					// detect conflict
-					return true;
-				}
-			}
-		}
-	}
-	#else
-	const int iE = m_pgidOrigs.size();
-	const int jE = other->m_pgidOrigs.size();
-	for(int i = 0; i < iE; ++ i)
-	{
-		const page_id_t pgid = m_pgidOrigs[i];
-
-		if(! other->m_bfOvrs.mayContain(pgid))
+	OvrEntry* eConfl = m_ovrsLocal.findIf([other](OvrEntry* eL) -> bool {
+		const page_id_t pgidL = eL->pgidOrig;
+		if(! other->m_bfOvrs.mayContain(pgidL))
 		{
-			// bloom filter ensures that pgid does not conflict w/ other->m_pgidOrigs...
-
-			// skip
+			// a bloomfilter ensures that _other_ has no ovr entry for pgidL
+			return false;
 		}
-		else
-		{
-			for(int j = 0; j < jE; ++ j)
-			{
-				const page_id_t pgidO = other->m_pgidOrigs[j];
 
-				if(pgid == pgidO) return true;
-			}
-		}
-	}
-	#endif
+		return other->m_ovrsLocal.head(pgidL) != nullptr;
+	});
 
-	return false;
+	return eConfl != nullptr;
 }
 
 void
@@ -176,43 +511,30 @@ LocalOvr::filterConflict(LocalOvr* other)
 		return;
 	}
 
+	++ m_nConflictCheck;
 	if(! other->m_bfOvrs.mayContain(m_bfOvrs))
 	{
 		// a bloomfilter ensures that there are no conflict.
+		++ m_nConflictCheckBf;
 		return;
 	}
 	
-	ver_t verWOther = other->verWrite();
-	for(int i = 0; i < TPIO_NHASH; ++ i)
-	{
-		for(OvrEntry* eL = m_hashOvrs[i]; eL && eL->ver == TAG_TXVER_LOCAL;)
+	m_ovrsLocal.forEach([this, other](OvrEntry* eL) {
+		const page_id_t pgidL = eL->pgidOrig;
+		if(! other->m_bfOvrs.mayContain(pgidL))
 		{
-			page_id_t pgidL = eL->pgidOrig;
-			if(! other->m_bfOvrs.mayContain(pgidL))
-			{
-				// a bloomfilter ensures that other->m_hashOvrs[i] list would not conflict w/ eL
-				goto NEXT;	
-			}
-
-			for(OvrEntry* eO = other->m_hashOvrs[i]; eO && (eO->ver == TAG_TXVER_LOCAL || eO->ver == verWOther); eO = eO->prev)
-			{
-				if(eO->pgidOrig == pgidL)
-				{
-					// detect conflict
-
-					// remove eL from the list
-					OvrEntry* prev = eL->prev;
-					delete eL;
-					eL = prev;
+			// a bloomfilter ensures that _other_ has no ovr entry for pgidL
+			return;
+		}
 
-					continue;
-				}
-			}
+		if(other->m_ovrsLocal.head(pgidL))
+		{
+			// detect conflict
 
-			NEXT:
-			eL = eL->prev;
+			// remove local entry of pgidL (its memory is left in the arena)
+			m_ovrsLocal.erase(pgidL);
 		}
-	}
+	});
 }
 
 void
@@ -220,23 +542,21 @@ LocalOvr::dump(std::ostream& s) const
 {
 	s << "** LocalOvr Dump ***" << std::endl;
 	s << "verRead: " << m_verRead << " verWrite: " << m_verWrite << std::endl;
-	s << "mergeOngoing: " << m_mergeOngoing << " merged: " << m_merged << std::endl;
-	s << "* m_pgidOrigs dump" << std::endl;
-	for(auto it = m_pgidOrigs.begin(); it != m_pgidOrigs.end(); ++ it)
-	{
-		s << *it << std::endl;
-	}
+	s << "merge progress: " << m_nMerged << "/" << m_ovrsLocal.nslots() << " merged: " << m_merged << std::endl;
+	s << "* local ovrs dump" << std::endl;
+	m_ovrsLocal.forEach([&s](OvrEntry* e) {
+		s << *e << std::endl;
+	});
 }
 
 ActiveOvr::ActiveOvr(page_id_t pgidStartPage, ver_t verBase)
 :	m_pgidStartPage(pgidStartPage),	
 	m_verBase(verBase),
-	m_lovrVerifiedTip(NULL)
+	m_lovrVerifiedTip(NULL),
+	m_nConflictCheck(0),
+	m_nConflictCheckBf(0)
 {
-	for(int i = 0; i < TPIO_NHASH; ++ i)
-	{
-		m_hashOvrs[i] = NULL;
-	}
+	m_ovrs.attachArena(&m_arena, &m_allocstat);
 }
 
 ActiveOvr::~ActiveOvr()
@@ -251,38 +571,43 @@ ActiveOvr::~ActiveOvr()
 		lovr = prev;
 	}
 
-	for(int i = 0; i < TPIO_NHASH; ++ i)
-	{
-		for(OvrEntry* e = m_hashOvrs[i]; e;)
-		{
-			OvrEntry* prev = e->prev;
-			delete e;
-			e = prev;
-		}
-	}
+	// "OvrEntry"s are released in bulk along w/ m_arena
 }
 
-unique_ptr<LocalOvr>
-ActiveOvr::newTx()
+pair<ver_t, page_id_t>
+ActiveOvr::readPoint(ver_t verReadMax) const
 {
-	ver_t verRead = m_verBase;
-	page_id_t pgidStartPage = m_pgidStartPage;
 	for(LocalOvr* e = m_lovrVerifiedTip; e; e = e->m_prev)
 	{
 		if(! e->isMerged()) continue;
+		if(verReadMax != TXID_INVALID && e->m_verWrite > verReadMax) continue;
 
-		verRead = e->m_verWrite;
-		pgidStartPage = e->m_pgidStartPage;
-		break;
+		return make_pair(e->m_verWrite, e->m_pgidStartPage);
 	}
-	return unique_ptr<LocalOvr>(new LocalOvr(m_hashOvrs, verRead, pgidStartPage));
+	return make_pair(m_verBase, m_pgidStartPage);
+}
+
+unique_ptr<LocalOvr>
+ActiveOvr::newTx(ver_t verReadMax)
+{
+	ver_t verRead; page_id_t pgidStartPage;
+	tie(verRead, pgidStartPage) = readPoint(verReadMax);
+	return unique_ptr<LocalOvr>(new LocalOvr(&m_ovrs, &m_arena, verRead, pgidStartPage));
+}
+
+OvrSnapshot
+ActiveOvr::newSnapshot(ver_t verReadMax) const
+{
+	ver_t verRead; page_id_t pgidStartPage;
+	tie(verRead, pgidStartPage) = readPoint(verReadMax);
+	return OvrSnapshot(&m_ovrs, verRead, pgidStartPage);
 }
 
 void
 ActiveOvr::terminate()
 {
 	// 1. put terminator lovr on tip to prevent further commit
-	LocalOvr* terminator = new LocalOvr(nullptr, 0, 0);
+	LocalOvr* terminator = new LocalOvr(nullptr, nullptr, 0, 0);
 	terminator->setTerminator();
 
 	LocalOvr* currtip;
@@ -301,70 +626,53 @@ ActiveOvr::terminate()
 void
 ActiveOvr::merge(LocalOvr* lovr)
 {
-	// FIXME: really implement the concurrent merge
-	if(! PTNK_CAS(&lovr->m_mergeOngoing, false, true))
+	const ver_t verWrite = lovr->m_verWrite;
+	const OvrHash& ovrsLocal = lovr->m_ovrsLocal;
+	const size_t nslotsLocal = ovrsLocal.nslots();
+
+	// push new OvrEntries (identified by e->ver == LocalOvr::TAG_TXVER_LOCAL)
+	// to heads of aovr::m_ovrs lists
+	//
+	// [x] : OvrEntry w/ ver _x_
+	// <-  : OvrEntry::prev ptr
+	//
+	// BEFORE:                         lovr->m_ovrsLocal[pgid]
+	//                                     [L]
+	//
+	// [5]<-[6]<-[7]<=aovr::m_ovrs[pgid]
+	//
+	// AFTER:
+	//
+	// [5]<-[6]<-[7]<-[8]<=aovr::m_ovrs[pgid]
+	//                 ^
+	//                 lovr->m_ovrsLocal[pgid] (still referenced for conflict checks)
+	//
+	// Readers w/ older snapshot skip [8] as its ver is newer than their verRead.
+	// Merges are done in ver order, so the lists are kept sorted newest first.
+	//
+	// All committers waiting for _lovr_ to be merged help merging it:
+	// each takes a chunk of local slots and pushes its entries.
+	// OvrHash::push is idempotent, so a committer which finds that all chunks are taken
+	// but not all done pushes remaining entries by itself instead of waiting for others.
+	auto pushEntry = [this, verWrite](OvrEntry* e) {
+		e->ver = verWrite;
+		m_ovrs.push(e); // e->ver must be set before e is published
+	};
+
+	m_ovrs.reserve(m_ovrs.size() + ovrsLocal.size());
+	for(;;)
 	{
-		MUTEXPROF_START("wait merge");
-		// wait until merge complete
-		while(! lovr->isMerged())
-		{
-			PTNK_MEMBARRIER_COMPILER;
-		}
-		MUTEXPROF_END;
+		const size_t iBegin = __sync_fetch_and_add(&lovr->m_iMerge, MERGE_CHUNK);
+		if(iBegin >= nslotsLocal) break;
 
-		return;
+		const size_t iEnd = std::min(iBegin + MERGE_CHUNK, nslotsLocal);
+		ovrsLocal.forEachIn(iBegin, iEnd, pushEntry);
+		__sync_fetch_and_add(&lovr->m_nMerged, iEnd - iBegin);
 	}
 
-	const ver_t verWrite = lovr->m_verWrite;
-
-	// int off = rand();
-	for(int i = 0; i < TPIO_NHASH; ++ i)
-	{
-		int roti = i; //(i + off) % TPIO_NHASH;
-
-		// concat new OvrEntries (identified by e->ver == LocalOvr::TAG_TXVER_LOCAL)
-		// to aovr::m_hashOvrs[i] 
-		//
-		// [x] : OvrEntry w/ ver _x_
-		// <-  : OvrEntry::prev ptr
-		//
-		// BEFORE:
-		//
-		// m_hashOvrs[i] ss
-		// @ start of tx     laste      lovr->m_hashOvrs[i]
-		//   /----------------[L]<-[L]<-[L]
-		//  v
-		// [5]<-[6]<-[6]<-[7]<=aovr::m_hashOvrs[i] 
-		//
-		//     \------v-----/
-		//       OvrEntries committed after ss
-		// 
-		// AFTER:
-		//
-		//                    [8]<-[8]<-[8]<=aovr::m_hashOvrs[i] 
-		//                   /
-		//                  v
-		// [5]<-[6]<-[6]<-[7]
-		//
-		//                    \-----v-----/
-		//                     these OvrEntries are now owned by aovr
-
-		// find _laste_, the last entry of local ovrs and fill e->ver fields
-		OvrEntry* laste = NULL;
-		for(OvrEntry* e = lovr->m_hashOvrs[roti]; e && e->ver == LocalOvr::TAG_TXVER_LOCAL; e = e->prev)
-		{
-			laste = e;
-			e->ver = verWrite;
-		}
-
-		// append the local ovrs list to the current list
-		if(laste)
-		{
-			laste->prev = m_hashOvrs[roti];
-			PTNK_MEMBARRIER_HW; // laste->prev must be set before tail upd
-
-			m_hashOvrs[roti] = lovr->m_hashOvrs[roti];
-		}
+	if(lovr->m_nMerged < nslotsLocal)
+	{
+		ovrsLocal.forEach(pushEntry);
 	}
 
 	PTNK_MEMBARRIER_HW; // m_merged must be set after actual merge finishes
@@ -399,8 +707,6 @@ ActiveOvr::tryCommit(unique_ptr<LocalOvr>& plovr, commit_flags_t flags, ver_t ve
 {
 	LocalOvr* lovr = plovr.get();
 
-	// FIXME: optimize for case COMMIT_REPLAY (no conflict check needed)
-
 	// step 1: validate _lovr_ that it does not conflict with other txs and add _lovr_ to validated ovrs list
 	{
 		LocalOvr* lovrVerified = NULL;
@@ -426,7 +732,9 @@ ActiveOvr::tryCommit(unique_ptr<LocalOvr>& plovr, commit_flags_t flags, ver_t ve
 			PTNK_MEMBARRIER_HW; // lovr->m_prev must be set BEFORE tip ptr CAS swing below
 
 			// check conflict with txs committed after read snapshot
-			for(LocalOvr* lovrBefore = lovrPrev; lovrBefore && lovrBefore != lovrVerified; lovrBefore = lovrBefore->m_prev)
+			// (skipped for replayed txs, which are known to be committed w/o conflict)
+			LocalOvr* lovrCheckFirst = (flags != COMMIT_REPLAY) ? lovrPrev : nullptr;
+			for(LocalOvr* lovrBefore = lovrCheckFirst; lovrBefore && lovrBefore != lovrVerified; lovrBefore = lovrBefore->m_prev)
 			{
 				if(lovr->m_verRead >= lovrBefore->m_verWrite)
 				{
@@ -446,6 +754,7 @@ ActiveOvr::tryCommit(unique_ptr<LocalOvr>& plovr, commit_flags_t flags, ver_t ve
 						// lovr conflicts with lovrBefore...
 
 						// abort commit
+						addConflictStat(lovr);
 						lovr->m_prev = nullptr;
 						lovr->m_verWrite = 0;
 						return TXID_INVALID;
@@ -472,6 +781,8 @@ ActiveOvr::tryCommit(unique_ptr<LocalOvr>& plovr, commit_flags_t flags, ver_t ve
 		}
 	}
 
+	addConflictStat(lovr);
+
 	// step 2: merge _lovr_
 	//         if there are any not yet merged txs, apply that first
 	mergeUpto(lovr);
@@ -480,11 +791,22 @@ ActiveOvr::tryCommit(unique_ptr<LocalOvr>& plovr, commit_flags_t flags, ver_t ve
 	return verW;
 }
 
+void
+ActiveOvr::addConflictStat(LocalOvr* lovr)
+{
+	if(lovr->m_nConflictCheck == 0) return;
+
+	__sync_fetch_and_add(&m_nConflictCheck, lovr->m_nConflictCheck);
+	__sync_fetch_and_add(&m_nConflictCheckBf, lovr->m_nConflictCheckBf);
+	lovr->m_nConflictCheck = lovr->m_nConflictCheckBf = 0;
+}
+
 void
 ActiveOvr::dump(std::ostream& s) const
 {
 	s << "*** ActiveOvr dump" << std::endl;
 	s << "verBase: " << m_verBase << std::endl;
+	s << "arena chunks: " << m_arena.numChunks() << std::endl;
 	s << "last verified tip: " << std::endl;
 	s << *m_lovrVerifiedTip << std::endl;
 }
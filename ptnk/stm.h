@@ -2,17 +2,18 @@
 #define _ptnk_stm_h_
 
 #include <iostream>
+#include <new>
 
-#include "bitvector.h"
+#include "common.h"
 #include "types.h"
+#include "hash.h"
+#include "exceptions.h"
 
 namespace ptnk
 {
 
 typedef tx_id_t ver_t;
 
-enum { TPIO_NHASH = 128 };
-
 struct OvrEntry
 {
 	page_id_t pgidOrig;
@@ -21,6 +22,7 @@ struct OvrEntry
 
 	ver_t ver;
 
+	//! older ovr entry of the same pgidOrig
 	OvrEntry* prev;
 };
 std::ostream& operator<<(std::ostream& s, const OvrEntry& e);
@@ -32,30 +34,350 @@ enum ovr_status_t
 	OVR_LOCAL, //!< there is local override for the page
 };
 
-inline int pgidhash(page_id_t pgid)
+//! bump allocator for ovr bookkeeping memory of an ActiveOvr generation
+/*!
+ *	Memory is carved out of large chunks and is never freed individually.
+ *	All chunks are released at once when the arena is destroyed,
+ *	i.e. when the ActiveOvr generation is retired after a rebase.
+ *	Memory used by aborted txs is also reclaimed at that point.
+ *
+ *	alloc is lock-free.
+ */
+class OvrArena : noncopyable
 {
-	return pgid % TPIO_NHASH; }
+public:
+	enum { CHUNK_SIZE = 64 * 1024 };
+
+	//! allocation counters. owned by the allocating party (not thread-safe)
+	struct Stat
+	{
+		unsigned int nAlloc; //!< num allocations served
+		unsigned int nChunkAlloc; //!< num chunks malloc-ed for the allocations
+
+		Stat() : nAlloc(0), nChunkAlloc(0) { /* NOP */ }
+	};
+
+	OvrArena();
+	~OvrArena();
+
+	//! allocate 8-byte aligned _size_ bytes
+	void* alloc(size_t size, Stat* stat);
+
+	template<typename T>
+	T* allocObj(Stat* stat)
+	{
+		return new(alloc(sizeof(T), stat)) T;	
+	}
 
-class PgidBloomFilter
+	size_t numChunks() const
+	{
+		return m_nchunks;	
+	}
+
+private:
+	struct chunk_t
+	{
+		chunk_t* prev;
+		size_t size;
+		volatile size_t used;
+		char data[1];
+	};
+
+	chunk_t* volatile m_chunk;
+	volatile size_t m_nchunks;
+};
+
+//! open-addressed hash table of pgid -> list of "OvrEntry"s
+/*!
+ *	Each slot holds pgidOrig and the head of its OvrEntry list (newest first, linked by OvrEntry::prev).
+ *
+ *	All operations except erase are lock-free and may be called concurrently.
+ *	Slots are claimed by CAS, and growing the table is done cooperatively:
+ *	the slots of the old table are frozen (tagged head ptr) and migrated to the new table
+ *	by all threads which try to push to it, and the new table is published once every slot is migrated.
+ *	No thread ever waits for others to finish their part of the migration, as migrating a slot is idempotent.
+ *
+ *	Tables replaced on growth are kept until destruction, as lock-free readers may still be referencing them.
+ *	If an arena is attached, tables are allocated from it and released along with the arena.
+ */
+class OvrHash : noncopyable
 {
 public:
+	enum { NSLOTS_MIN = 16 };
+
+	OvrHash();
+	~OvrHash();
+
+	//! allocate tables from _arena_ instead of malloc
+	void attachArena(OvrArena* arena, OvrArena::Stat* stat)
+	{
+		PTNK_ASSERT(! m_tbl);
+		m_arena = arena;
+		m_arenastat = stat;
+	}
+
+	//! get head of the OvrEntry list of _pgid_
+	OvrEntry* head(page_id_t pgid) const
+	{
+		const table_t* tbl = m_tbl;
+		if(! tbl) return nullptr;
+
+		const size_t mask = tbl->nslots - 1;
+		size_t i = hashs(pgid) & mask;
+		for(size_t nprobe = 0; nprobe < tbl->nslots; ++ nprobe, i = (i + 1) & mask)
+		{
+			const slot_t& s = tbl->slots[i];
+			const page_id_t p = s.pgid;
+			if(p == pgid) return untag(s.head);
+			if(p == PGID_INVALID) return nullptr;
+		}
+		return nullptr;
+	}
+
+	//! make _e_ the new head of the list of e->pgidOrig
+	/*!
+	 *	e->prev is overwritten to point to the previous head.
+	 *
+	 *	push is idempotent: it is a no-op if _e_ or an entry w/ newer ver is already on the list head.
+	 *	This allows multiple threads to push the same entry concurrently (see ActiveOvr::merge).
+	 */
+	void push(OvrEntry* e);
+
+	//! drop the list of _pgid_ from the table (entries are left untouched)
+	/*!
+	 *	@note not thread-safe. only for tables not shared among threads
+	 */
+	void erase(page_id_t pgid);
+
+	//! ensure that _n_ pgids can be stored w/o exceeding max load factor
+	void reserve(size_t n)
+	{
+		while(PTNK_UNLIKELY(n * 2 > nslots())) grow(n);
+	}
+
+	//! num pgids which have slots
+	size_t size() const
+	{
+		const table_t* tbl = m_tbl;
+		return tbl ? tbl->count : 0;	
+	}
+
+	size_t nslots() const
+	{
+		const table_t* tbl = m_tbl;
+		return tbl ? tbl->nslots : 0;	
+	}
+
+	//! call _f_ w/ head of each list
+	template<typename F>
+	void forEach(F f) const
+	{
+		forEachIn(0, nslots(), f);
+	}
+
+	//! call _f_ w/ head of each list in slots [iBegin, iEnd)
+	template<typename F>
+	void forEachIn(size_t iBegin, size_t iEnd, F f) const
+	{
+		const table_t* tbl = m_tbl;
+		if(! tbl) return;
+
+		if(iEnd > tbl->nslots) iEnd = tbl->nslots;
+		for(size_t i = iBegin; i < iEnd; ++ i)
+		{
+			OvrEntry* e = untag(tbl->slots[i].head);
+			if(e) f(e);
+		}
+	}
+
+	//! find head of list for which _f_ returns true
+	template<typename F>
+	OvrEntry* findIf(F f) const
+	{
+		const table_t* tbl = m_tbl;
+		if(! tbl) return nullptr;
+
+		for(size_t i = 0; i < tbl->nslots; ++ i)
+		{
+			OvrEntry* e = untag(tbl->slots[i].head);
+			if(e && f(e)) return e;
+		}
+
+		return nullptr;
+	}
+
+private:
+	enum
+	{
+		TAG_FROZEN = 1, //!< tag bit on slot_t::head. The slot is being migrated to the new table.
+		MIGRATE_CHUNK = 64, //!< num slots migrated at once by a thread
+	};
+
+	static bool isFrozen(OvrEntry* e)
+	{
+		return reinterpret_cast<uintptr_t>(e) & TAG_FROZEN;
+	}
+
+	static OvrEntry* untag(OvrEntry* e)
+	{
+		return reinterpret_cast<OvrEntry*>(reinterpret_cast<uintptr_t>(e) & ~static_cast<uintptr_t>(TAG_FROZEN));
+	}
+
+	struct slot_t
+	{
+		volatile page_id_t pgid;
+		OvrEntry* volatile head;
+	};
+
+	struct table_t
+	{
+		size_t nslots;
+
+		//! num claimed slots
+		volatile size_t count;
+
+		//! table which slots are being migrated to
+		table_t* volatile next;
+
+		//! next slot to be migrated
+		volatile size_t iMigrate;
+
+		//! num slots migrated
+		volatile size_t nMigrated;
+
+		slot_t slots[1];
+	};
+
+	table_t* newTable(size_t nslots);
+	void discardTable(table_t* tbl);
+
+	//! find slot for _pgid_, or claim new one
+	/*!
+	 *	@return
+	 *		nullptr if the table is being migrated or is full
+	 */
+	slot_t* claimSlot(table_t* tbl, page_id_t pgid);
+
+	//! push _e_ to _tbl_. returns false if _tbl_ is being migrated
+	bool pushTo(table_t* tbl, OvrEntry* e);
+
+	void grow(size_t n);
+
+	//! grow _tbl_ to hold _n_ pgids, or help ongoing migration of _tbl_
+	/*!
+	 *	returns after _tbl_ is replaced w/ new table
+	 */
+	void helpGrow(table_t* tbl, size_t n);
+	void migrateSlot(table_t* tbl, size_t i, table_t* tblNew);
+
+	table_t* volatile m_tbl;
+
+	//! first table allocated (tables are linked by table_t::next from it)
+	table_t* m_tblFirst;
+
+	OvrArena* m_arena;
+	OvrArena::Stat* m_arenastat;
+};
+
+//! bloom filter of pgids overridden in a tx
+/*!
+ *	Starts with small inline storage and is rebuilt w/ larger bit vector (see resize)
+ *	as ovr entries are added, so that it keeps BITS_PER_ENTRY bits per entry.
+ *	The bit vector size is always power of 2 in words, which allows
+ *	filters of different sizes to be tested for intersection by folding the larger one.
+ */
+class PgidBloomFilter : noncopyable
+{
+public:
+	typedef uint64_t word_t;
+	enum
+	{
+		WORD_BITS = sizeof(word_t)*8,
+		NWORDS_INLINE = 2,
+		BITS_PER_ENTRY = 8,
+		NPROBES = 3,
+	};
+
 	PgidBloomFilter()
+	:	m_bv(m_bvInline), m_nwords(NWORDS_INLINE), m_bvHeap(false)
+	{
+		::memset(m_bvInline, 0, sizeof(m_bvInline));	
+	}
+
+	~PgidBloomFilter()
+	{
+		if(m_bvHeap) delete[] m_bv;
+	}
+
+	void add(page_id_t pgid)
+	{
+		uint64_t h = hashs(pgid);
+		for(int i = 0; i < NPROBES; ++ i)
+		{
+			size_t b = bitidx(h, i);
+			m_bv[b / WORD_BITS] |= ((word_t)1) << (b % WORD_BITS);
+		}
+	}
+
+	//! check if the filter need to be rebuilt to hold _nEntries_ entries
+	bool needRebuild(size_t nEntries) const
+	{
+		return nEntries * BITS_PER_ENTRY > m_nwords * WORD_BITS;
+	}
+
+	//! clear the filter and resize it for _nEntries_ entries
+	/*!
+	 *	the entries need to be re-added by the caller.
+	 *	If _arena_ is given, the bit vector is allocated from it.
+	 */
+	void resize(size_t nEntries, OvrArena* arena = nullptr, OvrArena::Stat* stat = nullptr);
+
+	bool mayContain(page_id_t pgid) const
 	{
-		::memset(m_bvBloomLocalOvrs, 0, sizeof(m_bvBloomLocalOvrs));	
+		if(PTNK_UNLIKELY(s_bypass)) return true;
+
+		uint64_t h = hashs(pgid);
+		for(int i = 0; i < NPROBES; ++ i)
+		{
+			size_t b = bitidx(h, i);
+			if(! (m_bv[b / WORD_BITS] & (((word_t)1) << (b % WORD_BITS)))) return false;
+		}
+		return true;
 	}
 
-	void add(page_id_t pgid) {}
-	bool mayContain(page_id_t pgid) { return true; }
-	bool mayContain(const PgidBloomFilter& o) { return true; }
+	//! check if the filter and _o_ may have common pgid
+	/*!
+	 *	A common pgid sets all of its NPROBES bits in both filters, so the filters can't share one
+	 *	unless at least NPROBES bits are set in both of them.
+	 */
+	bool mayContain(const PgidBloomFilter& o) const;
+
+	size_t nbits() const
+	{
+		return m_nwords * WORD_BITS;	
+	}
+
+	//! make mayContain always return true (for benchmarking conflict detection w/o bloom filter)
+	static bool s_bypass;
 
 private:
-	char m_bvBloomLocalOvrs[16];
+	size_t bitidx(uint64_t h, int i) const
+	{
+		// double hashing: h1 + i*h2
+		uint32_t h1 = static_cast<uint32_t>(h), h2 = static_cast<uint32_t>(h >> 32) | 1;
+		return (h1 + i*h2) & (nbits() - 1);
+	}
+
+	word_t* m_bv;
+	size_t m_nwords;
+	bool m_bvHeap;
+	word_t m_bvInline[NWORDS_INLINE];
 };
 
 class __attribute__ ((aligned (8))) LocalOvr
 {
 public:
-	LocalOvr(OvrEntry* hashOvrs[], ver_t verRead, page_id_t pgidStartPage);
+	LocalOvr(const OvrHash* ovrsGlobal, OvrArena* arena, ver_t verRead, page_id_t pgidStartPage);
 	~LocalOvr();
 
 	void dump(std::ostream& s) const;
@@ -75,6 +397,10 @@ public:
 		m_extra = move(extra);	
 	}
 	ExtraData* getExtra() { return m_extra.get(); }
+	unique_ptr<ExtraData> detachExtra()
+	{
+		return move(m_extra);	
+	}
 
 	page_id_t pgidStartPage() const { return m_pgidStartPage; }
 	void setPgidStartPage(page_id_t pgid) { m_pgidStartPage = pgid; }
@@ -84,14 +410,32 @@ public:
 
 	LocalOvr* prev() const { return m_prev; }
 
+	const OvrArena::Stat& allocStat() const { return m_allocstat; }
+
+	//! num global ovr entries examined in searchOvr calls
+	unsigned int nChainWalk() const { return m_nChainWalk; }
+
+	//! call _f_ w/ each OvrEntry created in this tx
+	template<typename F>
+	void forEachOvr(F f) const
+	{
+		m_ovrsLocal.forEach(f);	
+	}
+
 	bool isMerged() const { return m_merged; }
 
 private:
 	enum { TAG_TXVER_LOCAL = 0 };
 
-	Vpage_id_t m_pgidOrigs;
+	//! ovr entries created in this tx
+	OvrHash m_ovrsLocal;
+
+	//! arena of the ActiveOvr generation, where OvrEntries are allocated
+	OvrArena* m_arena;
+	OvrArena::Stat m_allocstat;
 
-	OvrEntry* m_hashOvrs[TPIO_NHASH];
+	//! ovr entries committed to ActiveOvr (filtered by m_verRead on search)
+	const OvrHash* m_ovrsGlobal;
 
 	page_id_t m_pgidStartPageOrig;
 	page_id_t m_pgidStartPage;
@@ -104,6 +448,11 @@ private:
 	//! tx ver id of this tx
 	ver_t m_verWrite;
 
+	unsigned int m_nChainWalk;
+
+	//! num conflict checks against other txs, and ones settled by filter-vs-filter test (not yet added to ActiveOvr)
+	unsigned int m_nConflictCheck, m_nConflictCheckBf;
+
 	friend class ActiveOvr;
 
 	//! check if "OvrEntry"s this owns conflict with _other_'s
@@ -117,7 +466,13 @@ private:
 	void filterConflict(LocalOvr* other);
 
 	LocalOvr* m_prev;
-	bool m_mergeOngoing;
+
+	//! next slot of m_ovrsLocal to be merged to ActiveOvr
+	volatile size_t m_iMerge;
+
+	//! num slots of m_ovrsLocal merged to ActiveOvr
+	volatile size_t m_nMerged;
+
 	bool m_merged;
 
 	unique_ptr<ExtraData> m_extra;
@@ -130,6 +485,38 @@ inline
 std::ostream& operator<<(std::ostream& s, const LocalOvr& o)
 { o.dump(s); return s; }
 
+//! read-only view of committed ovrs of ActiveOvr
+/*!
+ *	Unlike LocalOvr, this can't hold tx local ovrs and is never committed,
+ *	so creating one involves no heap alloc and no ActiveOvr bookkeeping.
+ *
+ *	The ActiveOvr must outlive the snapshot.
+ */
+class OvrSnapshot
+{
+public:
+	OvrSnapshot(const OvrHash* ovrsGlobal = NULL, ver_t verRead = TXID_INVALID, page_id_t pgidStartPage = PGID_INVALID)
+	:	m_ovrsGlobal(ovrsGlobal),
+		m_verRead(verRead),
+		m_pgidStartPage(pgidStartPage),
+		m_nChainWalk(0)
+	{ /* NOP */ }
+
+	pair<page_id_t, ovr_status_t> searchOvr(page_id_t pgid);
+
+	page_id_t pgidStartPage() const { return m_pgidStartPage; }
+	ver_t verRead() const { return m_verRead; }
+
+	//! num global ovr entries examined in searchOvr calls
+	unsigned int nChainWalk() const { return m_nChainWalk; }
+
+private:
+	const OvrHash* m_ovrsGlobal;
+	ver_t m_verRead;
+	page_id_t m_pgidStartPage;
+	unsigned int m_nChainWalk;
+};
+
 enum commit_flags_t
 {
 	COMMIT_DEFAULT = 0,
@@ -144,7 +531,17 @@ public:
 	~ActiveOvr();
 
 	//! create new read snapshot as LocalOvr obj.
-	unique_ptr<LocalOvr> newTx();
+	/*!
+	 *	@param [in] verRead
+	 *		If specified, the snapshot is taken at the latest merged tx not newer than _verRead_
+	 */
+	unique_ptr<LocalOvr> newTx(ver_t verRead = TXID_INVALID);
+
+	//! create new read-only snapshot
+	/*!
+	 *	Same as newTx, but the snapshot can't be written to.
+	 */
+	OvrSnapshot newSnapshot(ver_t verRead = TXID_INVALID) const;
 
 	//! try committing changes from _lovr_
 	/*!
@@ -163,6 +560,11 @@ public:
 	void dump(std::ostream& s) const;
 
 	// ====== accessor methods ======
+
+	const OvrArena& arena() const
+	{
+		return m_arena;	
+	}
 	
 	ver_t verBase() const
 	{
@@ -171,11 +573,44 @@ public:
 
 	LocalOvr* lovrVerifiedTip() { return m_lovrVerifiedTip; }
 
+	//! num conflict checks of committing txs against txs committed after their read snapshot
+	uint64_t nConflictCheck() const { return m_nConflictCheck; }
+
+	//! num conflict checks settled by filter-vs-filter test w/o looking up each ovr entry
+	uint64_t nConflictCheckBf() const { return m_nConflictCheckBf; }
+
+	//! call _f_ w/ the newest committed OvrEntry of each pgid
+	template<typename F>
+	void forEachOvr(F f) const
+	{
+		m_ovrs.forEach(f);
+	}
+
 private:
+	enum { MERGE_CHUNK = 64 }; //!< num local slots merged at once by a committer
+
+	//! find latest merged tx not newer than _verReadMax_
+	/*!
+	 *	@return
+	 *		pair of ver and start page of the tx
+	 */
+	pair<ver_t, page_id_t> readPoint(ver_t verReadMax) const;
+
 	void merge(LocalOvr* lovr);
 	void mergeUpto(LocalOvr* lovrTip);
 
-	OvrEntry* m_hashOvrs[TPIO_NHASH];
+	//! add conflict check counts of _lovr_ to the stat
+	void addConflictStat(LocalOvr* lovr);
+
+	//! memory for OvrEntries / tables of this generation
+	/*!
+	 *	declared before m_ovrs, so that m_ovrs is destructed first
+	 */
+	OvrArena m_arena;
+	OvrArena::Stat m_allocstat;
+
+	//! committed ovr entries
+	OvrHash m_ovrs;
 
 	page_id_t m_pgidStartPage;
 	ver_t m_verBase;
@@ -185,6 +620,9 @@ private:
 	 *	tx in this linked-list are ensured that they do not conflict each other
 	 */
 	LocalOvr* m_lovrVerifiedTip;
+
+	uint64_t m_nConflictCheck;
+	uint64_t m_nConflictCheckBf;
 };
 
 inline
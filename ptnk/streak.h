@@ -57,16 +57,23 @@ private:
 	}
 };
 
+//! writes streak data to the streak areas of the tx pages
+/*!
+ *	Data which doesn't fit is written to OverflowedStreakPages alloced after the tx pages.
+ *	They are not synced here. The caller has to commit them along w/ the tx pages (see pagesOvfl).
+ */
 template<typename it_t>
 class StreakIO
 {
 public:
 	StreakIO(const it_t& it, const it_t& itE, PageIO* pio)
-	:	m_it(it), m_itE(itE), m_offset(0), m_pgidOvfl(PGID_INVALID), m_pio(pio)
+	:	m_it(it), m_itE(itE), m_offset(0), m_pgidOvfl(PGID_INVALID), m_pio(pio), m_bytes(0)
 	{ /* NOP */ }
 
 	void write(BufferCRef buf)
 	{
+		if(! buf.empty()) m_bytes += buf.size();
+
 		while(! buf.empty() && m_it != m_itE)
 		{
 			Page pg(m_pio->readPage(*m_it));
@@ -89,7 +96,7 @@ public:
 				++m_it;
 			}
 		}
-		for(; ! buf.empty(); m_pgidOvfl = PGID_INVALID)
+		while(! buf.empty())
 		{
 			OverflowedStreakPage ospg;
 			
@@ -97,6 +104,7 @@ public:
 			{
 				ospg = m_pio->newInitPage<OverflowedStreakPage>();
 				m_pgidOvfl = ospg.pageId();
+				m_pagesOvfl.push_back(m_pgidOvfl);
 			}
 			else
 			{
@@ -104,10 +112,24 @@ public:
 			}
 
 			buf = ospg.write(buf);
-			m_pio->sync(ospg);
+
+			// data left means the page is full
+			if(! buf.empty()) m_pgidOvfl = PGID_INVALID;
 		}
 	}
 
+	//! overflowed streak pages alloced, in ascending pgid order
+	const Vpage_id_t& pagesOvfl() const
+	{
+		return m_pagesOvfl;
+	}
+
+	//! total bytes of streak data written
+	size_t bytes() const
+	{
+		return m_bytes;
+	}
+
 private:
 	it_t m_it, m_itE;
 
@@ -116,6 +138,9 @@ private:
 	page_id_t m_pgidOvfl;
 
 	PageIO* m_pio;
+
+	Vpage_id_t m_pagesOvfl;
+	size_t m_bytes;
 };
 
 } // end of namespace ptnk
@@ -1,6 +1,10 @@
 #include "tpio.h"
 #include "streak.h"
+#include "checkpoint.h"
 #include "sysutils.h"
+#include "helperthr.h"
+
+#include <unordered_map>
 
 #define TXSESSION_BATCH_SYNC
 // #define DEBUG_VERBOSE_TPIOPIO
@@ -25,6 +29,28 @@ TPIOStat::merge(const TPIOStat& o)
 	ADD(nOvr)
 	ADD(nSync)
 	ADD(nNotifyOldLink)
+	ADD(nOvrAlloc)
+	ADD(nOvrChunkAlloc)
+	ADD(nRebase)
+	ADD(nRebaseRedo)
+	ADD(nRebaseCarryOver)
+	ADD(nRebaseStall)
+	ADD(nsRebaseStall)
+	ADD(nsRebaseVisit)
+	ADD(nRebaseOldLink)
+	ADD(nOvrChainWalk)
+	ADD(nConflictResolved)
+	ADD(nConflictKey)
+	ADD(nSyncBatch)
+	ADD(nSyncBatchTx)
+	ADD(nBoundedFlush)
+	ADD(nBoundedFlushInline)
+	ADD(nEagerWriteback)
+	ADD(nEagerWritebackPages)
+	ADD(nEagerUnstampedPages)
+	ADD(nStreakTx)
+	ADD(bytesStreak)
+	ADD(nStreakOvflPages)
 
 #undef ADDEXACT
 #undef ADD
@@ -41,12 +67,30 @@ TPIOStat::dump(std::ostream& s) const
 	s << "  nOvr:\t" << nOvr << std::endl;
 	s << "  nSync:\t" << nSync << std::endl;
 	s << "  nNotifyOldLink:\t" << nNotifyOldLink << std::endl;
+	s << "  nOvrAlloc:\t" << nOvrAlloc << std::endl;
+	s << "  nOvrChunkAlloc:\t" << nOvrChunkAlloc << std::endl;
+	s << "  nRebase:\t" << nRebase << std::endl;
+	s << "  nRebaseRedo:\t" << nRebaseRedo << std::endl;
+	s << "  nRebaseCarryOver:\t" << nRebaseCarryOver << std::endl;
+	s << "  nRebaseStall:\t" << nRebaseStall << std::endl;
+	s << "  nsRebaseStall:\t" << nsRebaseStall << std::endl;
+	s << "  nsRebaseVisit:\t" << nsRebaseVisit << " (pages w/ old link: " << nRebaseOldLink << ")" << std::endl;
+	s << "  nOvrChainWalk:\t" << nOvrChainWalk << std::endl;
+	s << "  rebaseThreshold:\t" << rebaseThreshold << " (up: " << nRebaseThresholdUp << " down: " << nRebaseThresholdDown << ")" << std::endl;
+	s << "  nConflictResolved:\t" << nConflictResolved << std::endl;
+	s << "  nConflictKey:\t" << nConflictKey << std::endl;
+	s << "  nSyncBatch:\t" << nSyncBatch << " (txs: " << nSyncBatchTx << ")" << std::endl;
+	s << "  nEagerWriteback:\t" << nEagerWriteback << " (pages: " << nEagerWritebackPages << " unstamped: " << nEagerUnstampedPages << ")" << std::endl;
+	s << "  nStreakTx:\t" << nStreakTx << " (bytes/tx: " << (nStreakTx ? bytesStreak / nStreakTx : 0) << " ovfl pages: " << nStreakOvflPages << ")" << std::endl;
+	s << "  nBoundedFlush:\t" << nBoundedFlush << " (inline: " << nBoundedFlushInline << " max window: " << nsUnsyncedMax/NSEC_PER_USEC << " us, " << bytesUnsyncedMax << " bytes)" << std::endl;
 }
 
-TPIOTxSession::TPIOTxSession(TPIO* tpio, shared_ptr<ActiveOvr> aovr, unique_ptr<LocalOvr> lovr)
+TPIOTxSession::TPIOTxSession(TPIO* tpio, ActiveOvr* aovr, unique_ptr<LocalOvr> lovr)
 :	m_tpio(tpio),
-	m_aovr(move(aovr)),
-	m_lovr(move(lovr))
+	m_aovr(aovr),
+	m_lovr(move(lovr)),
+	m_pgidRunFirst(PGID_INVALID),
+	m_pgidRunLast(PGID_INVALID)
 {
 	tpio->registerTx(this);
 
@@ -61,6 +105,12 @@ TPIOTxSession::dump(std::ostream& s) const
 	s << m_stat;
 }
 
+TPIOTxSession::OvrExtra::OvrExtra()
+:	pgidFirst(PGID_INVALID)
+{
+	/* NOP */
+}
+
 TPIOTxSession::OvrExtra::~OvrExtra()
 {
 	/* NOP */
@@ -175,6 +225,49 @@ TPIOTxSession::sync(page_id_t pgid)
 #endif
 	m_pagesModified.push_back(pgid);
 	// sync to backend is delayed to after commit
+
+	const size_t pgsRun = m_tpio->eagerWritebackPages();
+	if(pgsRun > 0) trackWritebackRun(pgid, pgsRun);
+}
+
+void
+TPIOTxSession::trackWritebackRun(page_id_t pgid, size_t pgsRun)
+{
+	// write back the run up to _pgidWbLast_ w/o waiting
+	auto writeback = [this] (page_id_t pgidWbLast) {
+		backend()->writebackRange(m_pgidRunFirst, pgidWbLast);
+		m_rangesWb.push_back(make_pair(m_pgidRunFirst, pgidWbLast));
+		++ m_stat.nEagerWriteback;
+		m_stat.nEagerWritebackPages += pgidWbLast - m_pgidRunFirst + 1;
+		m_pgidRunFirst = pgidWbLast + 1;
+	};
+
+	if(m_pgidRunLast != PGID_INVALID && PGID_PARTID(pgid) == PGID_PARTID(m_pgidRunLast))
+	{
+		// pages are alloced in ascending order, so this is a page of the tx modified again
+		if(pgid <= m_pgidRunLast) return;
+
+		// small gaps (pages of other txs, or synced out of order) don't break the run
+		if(pgid - m_pgidRunLast <= pgsRun)
+		{
+			m_pgidRunLast = pgid;
+
+			// leave the most recent pgsRun pages, which are likely to be modified again
+			if(m_pgidRunLast - m_pgidRunFirst + 1 >= 2 * pgsRun)
+			{
+				writeback(m_pgidRunLast - pgsRun);
+			}
+			return;
+		}
+
+		// run broken
+		if(m_pgidRunLast - m_pgidRunFirst + 1 > pgsRun)
+		{
+			writeback(m_pgidRunLast - pgsRun);
+		}
+	}
+
+	m_pgidRunFirst = m_pgidRunLast = pgid;
 }
 
 page_id_t
@@ -204,392 +297,1244 @@ TPIOTxSession::discardOldPages(page_id_t threshold)
 }
 
 void
-TPIOTxSession::loadStreak(BufferCRef bufStreak)
+TPIOTxSession::loadStreak(BufferCRef bufStreak, bool bCompact, Vpage_id_t* pagesEager)
 {
 	if(bufStreak.empty()) return;
 
-	bufStreak.popFrontTo(&m_stat.nUniquePages, sizeof(uint64_t));
-	oldlink()->restore(bufStreak);
+	if(bCompact)
+	{
+		m_stat.nUniquePages = bufStreak.popFrontVarint();
+		oldlink()->restoreCompact(bufStreak);
+
+		if(pagesEager)
+		{
+			// runs of pages: varint (gap from the prev run end), varint (num pages)
+			page_id_t pgidNext = 0;
+			for(uint64_t nRuns = bufStreak.popFrontVarint(); nRuns > 0; -- nRuns)
+			{
+				pgidNext += bufStreak.popFrontVarint();
+				for(uint64_t len = bufStreak.popFrontVarint(); len > 0; -- len)
+				{
+					pagesEager->push_back(pgidNext ++);
+				}
+			}
+		}
+	}
+	else
+	{
+		uint64_t nUniquePages;
+		bufStreak.popFrontTo(&nUniquePages, sizeof(uint64_t));
+		m_stat.nUniquePages = nUniquePages;
+		oldlink()->restore(bufStreak);
+	}
 }
 
-//! keep track of active TPIOTxSessions
-/*!
- *	All active txs (which may issue page read) are registered to this pool.
- *	This can be used to ensure that all txs have started after certain point of time.
- *  This is currently used in discarding pages.
- */
-class TPIO::TxPool
+TPIOSnapshot::TPIOSnapshot(TPIO* tpio, ActiveOvr* aovr, ver_t verRead)
+:	m_tpio(tpio),
+	m_snap(aovr->newSnapshot(verRead)),
+	m_nRead(0)
 {
-public:
-	TxPool();
-
-	void registerTx(TPIOTxSession* tx);
-	void unregisterTx(TPIOTxSession* tx);
-	
-	void join();
+	tpio->registerTx(this);
+}
 
-private:
-	static constexpr uintptr_t ABACOUNTER_MASK	= 0xffff000000000000ULL;
-	static constexpr uintptr_t PTR_MASK			= 0x0000ffffffffffffULL;
-	static constexpr uintptr_t ABACOUNTER_SHIFT = 48;
-	static constexpr size_t NTXPOOL = 256;
-	
-	uintptr_t m_txpool[NTXPOOL];
-};
+TPIOSnapshot::~TPIOSnapshot()
+{
+	m_tpio->unregisterTx(this);
+}
 
-TPIO::TxPool::TxPool()
+pair<Page, page_id_t>
+TPIOSnapshot::newPage()
 {
-	::memset(m_txpool, 0, sizeof m_txpool); 
+	PTNK_THROW_LOGIC_ERR("newPage called in read-only tx");
 }
 
-void
-TPIO::TxPool::registerTx(TPIOTxSession* tx)
+Page
+TPIOSnapshot::readPage(page_id_t pgid)
 {
-	PTNK_ASSERT((reinterpret_cast<uintptr_t>(tx) & ABACOUNTER_MASK) == 0);
+	++ m_nRead;
 
-	for(size_t i = 0; i < NTXPOOL; ++ i)
-	{
-		uintptr_t o = m_txpool[i];
-		PTNK_MEMBARRIER_COMPILER;
-		uintptr_t c = (o & ABACOUNTER_MASK) >> ABACOUNTER_SHIFT;
-		uintptr_t p = o & PTR_MASK;
+	page_id_t pgidOvr; ovr_status_t st;
+	tie(pgidOvr, st) = m_snap.searchOvr(pgid);
 
-		uintptr_t r = ((c+1) << ABACOUNTER_SHIFT) | reinterpret_cast<uintptr_t>(tx);
+	Page pg = m_tpio->backend()->readPage(pgidOvr);
+	pg.setIsBase(st == OVR_NONE);
 
-		if(!p && PTNK_CAS(&m_txpool[i], o, r))
-		{
-			tx->embedRegIdx(i);
-			return;
-		}
-	}
+	return pg;
+}
 
-	PTNK_THROW_RUNTIME_ERR("out of session pool");
+Page
+TPIOSnapshot::modifyPage(const Page& page, mod_info_t* mod)
+{
+	PTNK_THROW_LOGIC_ERR("modifyPage called in read-only tx");
 }
 
 void
-TPIO::TxPool::unregisterTx(TPIOTxSession* tx)
+TPIOSnapshot::discardPage(page_id_t pgid, mod_info_t* mod)
 {
-	size_t i = tx->regIdx();
-
-	PTNK_ASSERT(reinterpret_cast<uintptr_t>(tx) == (m_txpool[i] & PTR_MASK));
-	m_txpool[i] &= ABACOUNTER_MASK; // clear ptr part
+	PTNK_THROW_LOGIC_ERR("discardPage called in read-only tx");
 }
 
 void
-TPIO::TxPool::join()
+TPIOSnapshot::sync(page_id_t pgid)
+{
+	PTNK_THROW_LOGIC_ERR("sync called in read-only tx");
+}
+
+page_id_t
+TPIOSnapshot::getLastPgId() const
+{
+	return m_tpio->backend()->getLastPgId();
+}
+
+RebasePolicy::RebasePolicy(unsigned int threshold)
+:	m_threshold(threshold),
+	m_nRead(0), m_nChainWalk(0), m_nCommit(0),
+	m_nAdapt(0)
+{
+	m_tsLastAdapt.reset();
+}
+
+int
+RebasePolicy::adapt()
 {
-	// take pool snapshot
-	uintptr_t poolss[NTXPOOL];
-	for(size_t i = 0; i < NTXPOOL; ++ i)
+	// take stats of the generation and reset them
+	const uint64_t nRead = __sync_fetch_and_and(&m_nRead, 0);
+	const uint64_t nChainWalk = __sync_fetch_and_and(&m_nChainWalk, 0);
+	const uint64_t nCommit = __sync_fetch_and_and(&m_nCommit, 0);
+
+	HighResTimeStamp tsNow; tsNow.reset();
+	const unsigned long nsElapsed = tsNow.elapsed_ns(m_tsLastAdapt);
+	m_tsLastAdapt = tsNow;
+
+	const double amp = nRead > 0 ? (double)nChainWalk / nRead : 0.0;
+	const double commitRate = nsElapsed > 0 ? (double)nCommit * NSEC_PER_SEC / nsElapsed : 0.0;
+
+	int ret = 0;
+	unsigned int threshold = m_threshold;
+	if(nsElapsed < INTERVAL_MIN_MS * NSEC_PER_MSEC)
 	{
-		poolss[i] = m_txpool[i];
+		// ovrs pile up too fast. rebasing this often would cost more than it saves
+		if(threshold < THRESHOLD_MAX) { threshold *= 2; ret = +1; }
 	}
-
-	for(;;)
+	else if(amp > AMP_HIGH)
 	{
-	NOTREADY:;
-		// FIXME: revert to cond wait after certain period of time
-		usleep(1);
-		for(size_t i = 0; i < NTXPOOL; ++ i)
-		{
-			uintptr_t ss = poolss[i];
-			if(ss & PTR_MASK)
-			{
-				uintptr_t curr = m_txpool[i];
-				if(ss != curr)
-				{
-					// tx in slot i has changed...
+		// reads go through ovr entries too often
+		if(threshold > THRESHOLD_MIN) { threshold /= 2; ret = -1; }
+	}
+	else if(amp < AMP_LOW)
+	{
+		// reads are not much affected by ovrs. save rebase work
+		if(threshold < THRESHOLD_MAX) { threshold *= 2; ret = +1; }
+	}
+	m_threshold = threshold;
 
-					// skip check in next iter.
-					poolss[i] = 0;	
-				}
-				else
-				{
-					// tx in slot i has not changed
-					goto NOTREADY;
-				}
-			}
-		}
+	sample_t& smpl = m_history[m_nAdapt++ % HISTORY_SIZE];
+	smpl.threshold = threshold;
+	smpl.amp = amp;
+	smpl.commitRate = commitRate;
 
-		return;	
-	}
+	return ret;
 }
 
-TPIO::TPIO(shared_ptr<PageIO> backend, ptnk_opts_t opts)
-:	m_backend(backend),
-	m_sync(opts & OAUTOSYNC),
-	m_bDuringRebase(false),
-	m_bDuringRefresh(false),
-	m_txpool(new TxPool)
+void
+RebasePolicy::dump(std::ostream& s) const
 {
-	if(m_backend->needInit())
-	{
-		m_aovr = unique_ptr<ActiveOvr>(new ActiveOvr);
-	}
-	else
+	s << "  rebase threshold history (threshold / read amp / commits per sec):" << std::endl;
+	const size_t n = std::min(m_nAdapt, static_cast<size_t>(HISTORY_SIZE));
+	for(size_t i = m_nAdapt - n; i < m_nAdapt; ++ i)
 	{
-		// need to restore state
-		restoreState();
+		const sample_t& smpl = m_history[i % HISTORY_SIZE];
+		s << "    " << smpl.threshold << "\t" << smpl.amp << "\t" << smpl.commitRate << std::endl;
 	}
 }
 
-TPIO::~TPIO()
+GroupCommit::GroupCommit(PageIO* backend, TPIOStat* stat)
+:	m_backend(backend),
+	m_stat(stat),
+	m_helper(NULL),
+	m_windowUs(WINDOW_US_DEFAULT),
+	m_batchMax(BATCH_MAX_DEFAULT),
+	m_bFlushing(false)
 {
 	/* NOP */
 }
 
-unique_ptr<TPIOTxSession>
-TPIO::newTransaction()
+GroupCommit::~GroupCommit()
 {
-	// wait while rebase is processed
-	while(m_bDuringRebase)
-	{
-		MUTEXPROF_START("waitrebase");
-		STAGEPROF_STAGE(0xFF0000);
-
-		std::unique_lock<std::mutex> g(m_mtxRebase);
-
-		PTNK_MEMBARRIER_COMPILER;
-		if(m_bDuringRebase)
-		{
-			m_condRebase.wait(g);
-		}
-		MUTEXPROF_END;
-		STAGEPROF_STAGE(0x000000);
-	}
-
-	shared_ptr<ActiveOvr> aovr;
-	{
-		std::lock_guard<std::mutex> g(m_mtxAOvr);
-		aovr = m_aovr;
-	}
-	unique_ptr<LocalOvr> lovr = aovr->newTx();
-	return unique_ptr<TPIOTxSession>(new TPIOTxSession(this, move(aovr), move(lovr)));
+	drain();
 }
 
-inline
 void
-TPIO::registerTx(TPIOTxSession* tx)
+GroupCommit::setParams(unsigned int windowUs, size_t batchMax)
 {
-	m_txpool->registerTx(tx);
+	std::lock_guard<std::mutex> g(m_mtx);
+
+	m_windowUs = windowUs;
+	m_batchMax = std::max(batchMax, (size_t)1);
 }
 
 inline
-void
-TPIO::unregisterTx(TPIOTxSession* tx)
+bool
+GroupCommit::join(const Vrange_t& ranges, shared_ptr<Batch>* batch)
 {
-	m_txpool->unregisterTx(tx);
+	if(m_batchOpen)
+	{
+		*batch = m_batchOpen;
+		(*batch)->ranges.insert((*batch)->ranges.end(), ranges.begin(), ranges.end());
+		if(++ (*batch)->nTx >= m_batchMax) m_cond.notify_all();
+
+		return false;
+	}
+	else
+	{
+		batch->reset(new Batch);
+		(*batch)->ranges = ranges;
+		(*batch)->nTx = 1;
+		m_batchOpen = *batch;
+
+		return true;
+	}
 }
 
 void
-TPIO::syncDelayed(const Vpage_id_t& pagesModified)
+GroupCommit::sync(const Vrange_t& ranges)
 {
-	if(! m_sync) return;
-
-	STAGEPROF_STAGE(0x8B008B);
-#ifdef TXSESSION_BATCH_SYNC
-	if(! pagesModified.empty())
+	shared_ptr<Batch> batch;
 	{
-		auto it = pagesModified.begin(), itE = pagesModified.end();
-		page_id_t pgidFirst = *it++;
-		page_id_t pgidLast = pgidFirst;
-		for(; it != itE; ++ it)
-		{
-			const page_id_t pgid = *it;
-			if(pgid == pgidLast) continue; // skip duplicates
+		std::unique_lock<std::mutex> g(m_mtx);
 
-			if(PTNK_LIKELY(pgid == pgidLast + 1))
-			{
-				pgidLast = pgid;
-			}
-			else
+		if(! join(ranges, &batch) && batch->bLed)
+		{
+			// wait for the leader to flush
+			while(! batch->bDone)
 			{
-				m_backend->syncRange(pgidFirst, pgidLast);
-				pgidLast = pgidFirst = pgid;
+				m_cond.wait(g);
 			}
+			if(batch->err) std::rethrow_exception(batch->err);
+
+			return;
 		}
-		m_backend->syncRange(pgidFirst, pgidLast);
-	}
-#else
-	for(page_id_t pgid: pagesModified)
-	{
-		m_backend->sync(pgid);	
 	}
-#endif
-	STAGEPROF_STAGE(0x000000);
+
+	// lead the batch by ourselves if it was started by async committer and is still waiting for helper thr.
+	// (the helper thr may be the caller itself, e.g. rebase)
+
+	lead(batch);
+	if(batch->err) std::rethrow_exception(batch->err);
 }
 
 void
-TPIO::commitTxPages(TPIOTxSession* tx, ver_t verW, bool isRebase)
+GroupCommit::syncAsync(const Vrange_t& ranges, Callback cb)
 {
-	// sort modified pages ary
-	Vpage_id_t& pagesModified = tx->m_pagesModified;
-	std::sort(pagesModified.begin(), pagesModified.end());
-
-	// write streaks
+	shared_ptr<Batch> batch;
 	{
-		StreakIO<Vpage_id_t::const_iterator> sio(pagesModified.begin(), pagesModified.end(), backend());
-		sio.write(BufferCRef(&m_stat.nUniquePages, sizeof(uint64_t)));
-		tx->oldlink()->dump(sio);
+		std::lock_guard<std::mutex> g(m_mtx);
+
+		bool bNew = join(ranges, &batch);
+		batch->callbacks.push_back(move(cb));
+		if(! bNew) return;
 	}
 
-	// fill tpio header
-	// NOTE: this assumes mmap-ed pageio impl
+	if(m_helper)
 	{
-		for(page_id_t pgid: pagesModified)
-		{
-			Page pgLast(m_backend->readPage(pgid));
+		m_helper->enq([this, batch] () { lead(batch); });
+	}
+	else
+	{
+		lead(batch);
+	}
+}
 
-			pgLast.hdr()->txid = verW;
-			pgLast.hdr()->flags = page_hdr_t::PF_VALID;
-		}
+void
+GroupCommit::drain()
+{
+	shared_ptr<Batch> batch;
+	{
+		std::unique_lock<std::mutex> g(m_mtx);
 
-		// last page of tx w/ special flag
+		batch = m_batchOpen;
+		while(m_bFlushing)
 		{
-			page_id_t pgidLast = pagesModified.back();
-			Page pgLast(m_backend->readPage(pgidLast));
-
-			page_hdr_t::flags_t flags = page_hdr_t::PF_VALID | page_hdr_t::PF_END_TX;
-			if(isRebase) flags |= page_hdr_t::PF_TX_REBASE;
-
-			pgLast.hdr()->flags = flags;
+			m_cond.wait(g);
 		}
 	}
 
-	// write pages to disk
-	syncDelayed(pagesModified);
+	// the batch may have been left w/o leader, if the helper thr was stopped before leading it
+	if(batch) lead(batch);
 }
 
-bool
-TPIO::tryCommit(TPIOTxSession* tx, commit_flags_t flags)
+void
+GroupCommit::lead(const shared_ptr<Batch>& batch)
 {
-	if(tx->m_pagesModified.empty())
+	std::vector<Callback> callbacks;
 	{
-		// no write in tx
-		return true;
-	}
+		std::unique_lock<std::mutex> g(m_mtx);
 
-	// NOTE: the below commit process separates
-	//       - transaction validation (check no conflict)
-	//       - log commit
-	//
-	// This will allow txs started just after validation to read
-	// un-committed tx writes which has not yet been written to the log.
-	// Users has to be aware of this design.
-	// Although these are likely to cause no practical problems for following reasons:
-	// - those un-committed tx are guaranteed to success commit
-	// - the later tx are ONLY allowed to be commit AFTER the dependent ead tx commit
-	//
-	// A possible solution is to block the un-committed read OR do not allow tx to be read until the commit is processed, but it would cause big degrade in performance.
-	//
-	// cf. Eljas Soisalon-soininen, Tatu Yl$(O)l(Bnen, "Partial Strictness in Two-Phase Locking"
+		if(batch->bLed)
+		{
+			// someone else took the lead
+			while(! batch->bDone)
+			{
+				m_cond.wait(g);
+			}
+			return;
+		}
+		batch->bLed = true;
 
-	// 1. try committing ovr info
-	ver_t verW;
-	{
-		MUTEXPROF_START("aovr tryCommit");
-		STAGEPROF_STAGE(0xFF00FF);
-		if((verW = tx->m_aovr->tryCommit(tx->m_lovr, flags)) == TXID_INVALID)
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(m_windowUs);
+		while(batch->nTx < m_batchMax)
 		{
-			return false;
+			if(m_bFlushing)
+			{
+				m_cond.wait(g);
+			}
+			else if(m_cond.wait_until(g, deadline) == std::cv_status::timeout)
+			{
+				if(! m_bFlushing) break;
+			}
 		}
-		STAGEPROF_STAGE(0xEE7AE9);
-		MUTEXPROF_END;
-	}
+		m_batchOpen.reset();
+		m_bFlushing = true;
 
-	// ovr info committed! now tx is guaranteed to be valid...
-	// * the later tx will read the writes caused by this tx.
-	
-	// 2. update stat data
-	m_stat.merge(tx->m_stat);
+		g.unlock();
+		try
+		{
+			flush(batch->ranges);
+		}
+		catch(...)
+		{
+			batch->err = std::current_exception();
+		}
+		g.lock();
 
-	// 3. fill pages info / write pages to disk
-	commitTxPages(tx, verW, false);
+		m_bFlushing = false;
+		batch->bDone = true;
+		m_cond.notify_all();
 
-	STAGEPROF_STAGE(0x000000);
-	return true;
+		// no tx joins the batch after m_batchOpen is reset
+		callbacks.swap(batch->callbacks);
+	}
+
+	__sync_fetch_and_add(&m_stat->nSyncBatch, 1);
+	__sync_fetch_and_add(&m_stat->nSyncBatchTx, batch->nTx);
+
+	for(Callback& cb: callbacks)
+	{
+		cb(batch->err);
+	}
 }
 
-struct PageVer
+void
+GroupCommit::flush(Vrange_t& ranges)
 {
-	page_id_t pgid;
-	tx_id_t ver;
+	if(ranges.empty()) return;
 
-	inline bool operator<(const PageVer& o) const
+	std::sort(ranges.begin(), ranges.end());
+
+	// merge overlapping / nearby ranges in the same partition
+	auto it = ranges.begin(), itE = ranges.end();
+	page_id_t pgidFirst = it->first, pgidLast = it->second;
+	for(++ it; it != itE; ++ it)
 	{
-		if(ver != o.ver)
+		if(PGID_PARTID(it->first) == PGID_PARTID(pgidLast) && it->first <= pgidLast + 1 + GAP_MAX)
 		{
-			return ver > o.ver;
+			pgidLast = std::max(pgidLast, it->second);
 		}
 		else
 		{
-			return pgid > o.pgid;	
+			m_backend->syncRange(pgidFirst, pgidLast);
+			pgidFirst = it->first; pgidLast = it->second;
 		}
 	}
-};
-typedef std::vector<PageVer> VPageVer;
-
-#define PTNK_BKWD_SCAN(pio) \
-	page_id_t pgid = pio->getLastPgId(); \
-	for(part_id_t partid = PGID_PARTID(pgid); partid != PTNK_PARTID_INVALID; -- partid) \
-	for(pgid = PGID_PARTLOCAL(partid, pio->getPartLastLocalPgId(partid)); PGID_LOCALID(pgid) != PGID_LOCALID_MASK; -- pgid)
+	m_backend->syncRange(pgidFirst, pgidLast);
+}
 
-void
-TPIO::restoreState()
+BoundedSync::BoundedSync(GroupCommit* groupcommit, TPIOStat* stat)
+:	m_groupcommit(groupcommit),
+	m_stat(stat),
+	m_intervalMs(INTERVAL_MS_DEFAULT),
+	m_bytesMax(BYTES_MAX_DEFAULT),
+	m_nTx(0),
+	m_bytes(0),
+	m_bStop(false)
+{
+	/* NOP */
+}
+
+BoundedSync::~BoundedSync()
+{
+	stop();
+	flush();
+}
+
+void
+BoundedSync::stop()
+{
+	{
+		std::lock_guard<std::mutex> g(m_mtx);
+		m_bStop = true;
+	}
+	m_cond.notify_all();
+
+	if(m_thr)
+	{
+		m_thr->join();
+		m_thr.reset();
+	}
+}
+
+void
+BoundedSync::setBound(unsigned int intervalMs, size_t bytesMax)
+{
+	std::lock_guard<std::mutex> g(m_mtx);
+
+	m_intervalMs = intervalMs;
+	m_bytesMax = std::max(bytesMax, (size_t)PTNK_PAGE_SIZE);
+	m_cond.notify_all();
+}
+
+BoundedSync::window_t
+BoundedSync::window()
+{
+	std::lock_guard<std::mutex> g(m_mtx);
+
+	window_t ret;
+	ret.nTx = m_nTx;
+	ret.bytes = m_bytes;
+	ret.nsAge = m_nTx > 0 ? ageNs(clock_t::now()) : 0;
+
+	return ret;
+}
+
+void
+BoundedSync::add(const GroupCommit::Vrange_t& ranges, GroupCommit::Callback cb)
+{
+	std::unique_lock<std::mutex> g(m_mtx);
+
+	const clock_t::time_point now = clock_t::now();
+	if(m_nTx == 0) m_tsOldest = now;
+
+	m_ranges.insert(m_ranges.end(), ranges.begin(), ranges.end());
+	for(const auto& r: ranges)
+	{
+		m_bytes += (r.second - r.first + 1) * PTNK_PAGE_SIZE;
+	}
+	if(cb) m_callbacks.push_back(move(cb));
+	++ m_nTx;
+
+	if(! m_thr && ! m_bStop)
+	{
+		m_thr.reset(new std::thread([this] () { thrmain(); }));
+	}
+
+	// enforce the bound if flusher thr didn't
+	if(m_bytes >= m_bytesMax || ageNs(now) >= m_intervalMs * NSEC_PER_MSEC)
+	{
+		flushWindow(g, true);
+	}
+	else if(m_nTx == 1 || m_bytes >= m_bytesMax/2)
+	{
+		// new deadline, or byte bound reached half
+		m_cond.notify_all();
+	}
+}
+
+void
+BoundedSync::flush()
+{
+	std::unique_lock<std::mutex> g(m_mtx);
+
+	if(m_nTx == 0) return;
+	flushWindow(g, false);
+}
+
+void
+BoundedSync::flushWindow(std::unique_lock<std::mutex>& g, bool bInline)
+{
+	GroupCommit::Vrange_t ranges; ranges.swap(m_ranges);
+	std::vector<GroupCommit::Callback> callbacks; callbacks.swap(m_callbacks);
+	const uint64_t nsAge = ageNs(clock_t::now());
+	const uint64_t bytes = m_bytes;
+	m_nTx = 0;
+	m_bytes = 0;
+
+	g.unlock();
+
+	std::exception_ptr err;
+	try
+	{
+		m_groupcommit->sync(ranges);
+	}
+	catch(...)
+	{
+		err = std::current_exception();
+	}
+
+	__sync_fetch_and_add(&m_stat->nBoundedFlush, 1);
+	if(bInline) __sync_fetch_and_add(&m_stat->nBoundedFlushInline, 1);
+	for(uint64_t cur = m_stat->nsUnsyncedMax; cur < nsAge && ! PTNK_CAS(&m_stat->nsUnsyncedMax, cur, nsAge); cur = m_stat->nsUnsyncedMax) ;
+	for(uint64_t cur = m_stat->bytesUnsyncedMax; cur < bytes && ! PTNK_CAS(&m_stat->bytesUnsyncedMax, cur, bytes); cur = m_stat->bytesUnsyncedMax) ;
+
+	for(GroupCommit::Callback& cb: callbacks)
+	{
+		cb(err);
+	}
+
+	// committers which hit the bound shouldn't return w/ their tx not durable
+	if(err && bInline) std::rethrow_exception(err);
+}
+
+void
+BoundedSync::thrmain()
+{
+	std::unique_lock<std::mutex> g(m_mtx);
+
+	while(! m_bStop)
+	{
+		if(m_nTx == 0)
+		{
+			m_cond.wait(g);
+			continue;
+		}
+
+		const clock_t::time_point deadline = m_tsOldest + std::chrono::milliseconds(m_intervalMs) / 2;
+		if(m_bytes >= m_bytesMax/2 || clock_t::now() >= deadline)
+		{
+			flushWindow(g, false);
+			g.lock();
+			continue;
+		}
+
+		m_cond.wait_until(g, deadline);
+	}
+}
+
+TPIO::TPIO(shared_ptr<PageIO> backend, ptnk_opts_t opts)
+:	m_backend(backend),
+	m_sync(opts & (OAUTOSYNC | OBOUNDEDSYNC)),
+	m_bBounded(opts & OBOUNDEDSYNC),
+	m_eagerWbPages(0),
+	m_rebaseThrs(std::min(std::max(std::thread::hardware_concurrency(), 1U), REBASE_THR_MAX)),
+	m_verCheckpoint(TXID_INVALID),
+	m_groupcommit(backend.get(), &m_stat),
+	m_boundedsync(&m_groupcommit, &m_stat),
+	m_aovr(nullptr),
+	m_bDuringRebase(false),
+	m_bDuringHandover(false),
+	m_bDuringRefresh(false)
+{
+	m_stat.rebaseThreshold = m_policy.threshold();
+
+	if(m_backend->needInit())
+	{
+		m_aovr = new ActiveOvr;
+	}
+	else
+	{
+		// need to restore state
+		restoreState();
+	}
+}
+
+TPIO::~TPIO()
+{
+	// complete async commits not yet synced.
+	// the flusher thr may be still in flushWindow, which touches m_stat and callbacks
+	m_boundedsync.stop();
+	m_boundedsync.flush();
+	m_groupcommit.drain();
+
+	// old generations are released by m_epoch
+	delete m_aovr;
+}
+
+void
+TPIO::waitHandover()
+{
+	// txs started in rebase visit phase are run on the old generation
+	if(PTNK_UNLIKELY(m_bDuringHandover))
+	{
+		MUTEXPROF_START("waitrebase");
+		STAGEPROF_STAGE(0xFF0000);
+		HighResTimeStamp tsBefore; tsBefore.reset();
+		{
+			std::unique_lock<std::mutex> g(m_mtxRebase);
+
+			PTNK_MEMBARRIER_COMPILER;
+			while(m_bDuringHandover)
+			{
+				m_condRebase.wait(g);
+			}
+		}
+		HighResTimeStamp tsAfter; tsAfter.reset();
+		__sync_fetch_and_add(&m_stat.nRebaseStall, 1);
+		__sync_fetch_and_add(&m_stat.nsRebaseStall, tsAfter.elapsed_ns(tsBefore));
+		MUTEXPROF_END;
+		STAGEPROF_STAGE(0x000000);
+	}
+}
+
+unique_ptr<TPIOTxSession>
+TPIO::newTransaction()
+{
+	waitHandover();
+
+	// enter epoch before taking snapshot, so that pages seen from it won't be reclaimed
+	EpochManager::Guard g(&m_epoch);
+
+	ActiveOvr* aovr = this->aovr();
+	unique_ptr<LocalOvr> lovr = aovr->newTx();
+	return unique_ptr<TPIOTxSession>(new TPIOTxSession(this, aovr, move(lovr)));
+}
+
+unique_ptr<TPIOSnapshot>
+TPIO::newSnapshot()
+{
+	// no need to wait for rebase handover here.
+	// the old generation is terminated only after all its committed txs are merged,
+	// so reading from it gives a consistent snapshot.
+	EpochManager::Guard g(&m_epoch);
+	return unique_ptr<TPIOSnapshot>(new TPIOSnapshot(this, this->aovr()));
+}
+
+unique_ptr<TPIOSnapshot>
+TPIO::newSnapshot(TPIOTxSession* tx)
+{
+	// _tx_ is inside m_epoch, so its generation is kept alive
+	return unique_ptr<TPIOSnapshot>(new TPIOSnapshot(this, tx->m_aovr, tx->m_lovr->verRead()));
+}
+
+inline
+void
+TPIO::registerTx(TPIOTxSession* tx)
+{
+	tx->m_epochrec = m_epoch.enter();
+}
+
+inline
+void
+TPIO::unregisterTx(TPIOTxSession* tx)
+{
+	m_epoch.leave(tx->m_epochrec);
+}
+
+inline
+void
+TPIO::registerTx(TPIOSnapshot* ss)
+{
+	ss->m_epochrec = m_epoch.enter();
+}
+
+inline
+void
+TPIO::unregisterTx(TPIOSnapshot* ss)
+{
+	m_epoch.leave(ss->m_epochrec);
+}
+
+void
+TPIO::syncDelayed(const Vpage_id_t& pagesModified, GroupCommit::Callback cbDurable)
+{
+	if(! m_sync || pagesModified.empty())
+	{
+		if(cbDurable) cbDurable(std::exception_ptr());
+		return;
+	}
+
+	STAGEPROF_STAGE(0x8B008B);
+	GroupCommit::Vrange_t ranges;
+#ifdef TXSESSION_BATCH_SYNC
+	{
+		auto it = pagesModified.begin(), itE = pagesModified.end();
+		page_id_t pgidFirst = *it++;
+		page_id_t pgidLast = pgidFirst;
+		for(; it != itE; ++ it)
+		{
+			const page_id_t pgid = *it;
+			if(pgid == pgidLast) continue; // skip duplicates
+
+			if(PTNK_LIKELY(pgid == pgidLast + 1))
+			{
+				pgidLast = pgid;
+			}
+			else
+			{
+				ranges.push_back(make_pair(pgidFirst, pgidLast));
+				pgidLast = pgidFirst = pgid;
+			}
+		}
+		ranges.push_back(make_pair(pgidFirst, pgidLast));
+	}
+#else
+	for(page_id_t pgid: pagesModified)
+	{
+		ranges.push_back(make_pair(pgid, pgid));
+	}
+#endif
+
+	if(m_bBounded)
+	{
+		// leave it to be synced within the bound
+		m_boundedsync.add(ranges, move(cbDurable));
+		STAGEPROF_STAGE(0x000000);
+		return;
+	}
+
+	// sync along w/ concurrently committing txs
+	if(cbDurable)
+	{
+		m_groupcommit.syncAsync(ranges, move(cbDurable));
+	}
+	else
+	{
+		m_groupcommit.sync(ranges);
+	}
+	STAGEPROF_STAGE(0x000000);
+}
+
+void
+TPIO::commitTxPages(TPIOTxSession* tx, ver_t verW, bool isRebase, GroupCommit::Callback cbDurable)
+{
+	// sort modified pages ary
+	// pages modified multiple times in the tx are synced multiple times. as each page
+	// holds a part of the streak, they must appear only once
+	Vpage_id_t& pagesModified = tx->m_pagesModified;
+	std::sort(pagesModified.begin(), pagesModified.end());
+	pagesModified.erase(std::unique(pagesModified.begin(), pagesModified.end()), pagesModified.end());
+
+	// pages already written back (see TPIOTxSession::trackWritebackRun) are left untouched, so that
+	// the commit doesn't dirty them again. instead, the streak lists them for restoreState.
+	// the last tx page of each partition is always stamped, as it bounds the partition on reopen (scanLastPgId).
+	// the start page needs to be stamped as well, as restoreState finds it by scan
+	Vpage_id_t pagesEager, pagesRest;
+	if(! isRebase && ! tx->m_rangesWb.empty())
+	{
+		GroupCommit::Vrange_t& ranges = tx->m_rangesWb;
+		std::sort(ranges.begin(), ranges.end());
+
+		GroupCommit::Vrange_t::const_iterator itR = ranges.begin();
+		for(Vpage_id_t::const_iterator it = pagesModified.begin(); it != pagesModified.end(); ++ it)
+		{
+			const page_id_t pgid = *it;
+			while(itR != ranges.end() && itR->second < pgid) ++ itR;
+
+			const bool bLastOfPart = (it + 1 == pagesModified.end() || PGID_PARTID(*(it + 1)) != PGID_PARTID(pgid));
+			if(itR != ranges.end() && itR->first <= pgid && ! bLastOfPart
+			&& Page(m_backend->readPage(pgid)).pageType() != PT_DB_OVERVIEW)
+			{
+				pagesEager.push_back(pgid);
+			}
+			else
+			{
+				pagesRest.push_back(pgid);
+			}
+		}
+		__sync_fetch_and_add(&m_stat.nEagerUnstampedPages, pagesEager.size());
+	}
+	Vpage_id_t& pagesStamp = pagesEager.empty() ? pagesModified : pagesRest;
+
+	// write streaks
+	// compact format: varint nUniquePages, followed by PagesOldLink::dumpCompact
+	// w/ PF_STREAK_EAGER: followed by varint nRuns, and per run of pagesEager, varint (gap from the prev run end), varint (num pages)
+	{
+		StreakIO<Vpage_id_t::const_iterator> sio(pagesStamp.begin(), pagesStamp.end(), backend());
+		char v[VARINT_SIZE_MAX];
+		sio.write(BufferCRef(v, varint_encode(v, m_stat.nUniquePages)));
+		tx->oldlink()->dumpCompact(sio);
+
+		if(! pagesEager.empty())
+		{
+			GroupCommit::Vrange_t runs;
+			for(page_id_t pgid: pagesEager)
+			{
+				if(! runs.empty() && runs.back().second + 1 == pgid)
+				{
+					runs.back().second = pgid;
+				}
+				else
+				{
+					runs.push_back(make_pair(pgid, pgid));
+				}
+			}
+
+			sio.write(BufferCRef(v, varint_encode(v, runs.size())));
+			page_id_t pgidNext = 0;
+			for(const auto& run: runs)
+			{
+				sio.write(BufferCRef(v, varint_encode(v, run.first - pgidNext)));
+				sio.write(BufferCRef(v, varint_encode(v, run.second - run.first + 1)));
+				pgidNext = run.second + 1;
+			}
+		}
+
+		__sync_fetch_and_add(&m_stat.nStreakTx, 1);
+		__sync_fetch_and_add(&m_stat.bytesStreak, sio.bytes());
+		if(! sio.pagesOvfl().empty())
+		{
+			__sync_fetch_and_add(&m_stat.nStreakOvflPages, sio.pagesOvfl().size());
+
+			// overflowed streak pages are committed as a part of the tx.
+			// they are alloced after all the tx pages, so pagesModified stays sorted
+			if(! pagesEager.empty()) pagesStamp.insert(pagesStamp.end(), sio.pagesOvfl().begin(), sio.pagesOvfl().end());
+			pagesModified.insert(pagesModified.end(), sio.pagesOvfl().begin(), sio.pagesOvfl().end());
+		}
+	}
+
+	// fill tpio header
+	// NOTE: this assumes mmap-ed pageio impl
+	{
+		page_hdr_t::flags_t flags = page_hdr_t::PF_VALID | page_hdr_t::PF_STREAK_COMPACT;
+		if(! pagesEager.empty()) flags |= page_hdr_t::PF_STREAK_EAGER;
+
+		for(page_id_t pgid: pagesStamp)
+		{
+			Page pgLast(m_backend->readPage(pgid));
+
+			pgLast.hdr()->txid = verW;
+			pgLast.hdr()->flags = flags;
+		}
+
+		// last page of tx w/ special flag
+		{
+			page_id_t pgidLast = pagesStamp.back();
+			Page pgLast(m_backend->readPage(pgidLast));
+
+			flags |= page_hdr_t::PF_END_TX;
+			if(isRebase) flags |= page_hdr_t::PF_TX_REBASE;
+
+			pgLast.hdr()->flags = flags;
+		}
+	}
+
+	// write pages to disk. eager pages were written back w/o a barrier, so they are synced as well
+	syncDelayed(pagesModified, move(cbDurable));
+}
+
+bool
+TPIO::tryCommit(TPIOTxSession* tx, commit_flags_t flags, GroupCommit::Callback cbDurable)
+{
+	if(tx->m_pagesModified.empty())
+	{
+		// no write in tx
+		if(cbDurable) cbDurable(std::exception_ptr());
+		return true;
+	}
+
+	// NOTE: the below commit process separates
+	//       - transaction validation (check no conflict)
+	//       - log commit
+	//
+	// This will allow txs started just after validation to read
+	// un-committed tx writes which has not yet been written to the log.
+	// Users has to be aware of this design.
+	// Although these are likely to cause no practical problems for following reasons:
+	// - those un-committed tx are guaranteed to success commit
+	// - the later tx are ONLY allowed to be commit AFTER the dependent ead tx commit
+	//
+	// A possible solution is to block the un-committed read OR do not allow tx to be read until the commit is processed, but it would cause big degrade in performance.
+	//
+	// cf. Eljas Soisalon-soininen, Tatu Yl$(O)l(Bnen, "Partial Strictness in Two-Phase Locking"
+
+	// 1. try committing ovr info
+	ver_t verW;
+	{
+		const OvrArena::Stat& allocstat = tx->m_lovr->allocStat();
+		tx->m_stat.nOvrAlloc = allocstat.nAlloc;
+		tx->m_stat.nOvrChunkAlloc = allocstat.nChunkAlloc;
+
+		tx->m_stat.nOvrChainWalk = tx->m_lovr->nChainWalk();
+
+		// memo for rebase. see RebaseTPIOTxSession::canCarryOver
+		reinterpret_cast<TPIOTxSession::OvrExtra*>(tx->m_lovr->getExtra())->pgidFirst =
+			*std::min_element(tx->m_pagesModified.begin(), tx->m_pagesModified.end());
+
+		MUTEXPROF_START("aovr tryCommit");
+		STAGEPROF_STAGE(0xFF00FF);
+		if((verW = tx->m_aovr->tryCommit(tx->m_lovr, flags)) == TXID_INVALID)
+		{
+			return false;
+		}
+		STAGEPROF_STAGE(0xEE7AE9);
+		MUTEXPROF_END;
+	}
+
+	// ovr info committed! now tx is guaranteed to be valid...
+	// * the later tx will read the writes caused by this tx.
+	
+	// 2. update stat data
+	m_stat.merge(tx->m_stat);
+	m_policy.notifyCommit();
+
+	// 3. fill pages info / write pages to disk
+	commitTxPages(tx, verW, false, move(cbDurable));
+
+	STAGEPROF_STAGE(0x000000);
+	return true;
+}
+
+struct PageVer
+{
+	page_id_t pgid;
+	tx_id_t ver;
+
+	inline bool operator<(const PageVer& o) const
+	{
+		if(ver != o.ver)
+		{
+			return ver > o.ver;
+		}
+		else
+		{
+			return pgid > o.pgid;	
+		}
+	}
+};
+typedef std::vector<PageVer> VPageVer;
+
+namespace
+{
+
+//! header of a committed page found in the log scan of TPIO::restoreState
+struct ScannedPage
+{
+	page_id_t pgid;
+	tx_id_t ver;
+	page_hdr_t::flags_t flags;
+	page_type_t type;
+};
+typedef std::vector<ScannedPage> VScannedPage;
+
+enum
+{
+	//! num pages of the first chunk scanned. doubled for each chunk, so that short log tails are scanned cheaply
+	SCAN_CHUNK_MIN = 64,
+	SCAN_CHUNK_MAX = 16 * 1024,
+
+	//! chunks are split among threads only if each thread can take this many pages
+	SCAN_PGS_PER_THR_MIN = 2 * 1024,
+	SCAN_THR_MAX = 8,
+};
+
+void
+scanPages(PageIO* pio, page_id_t pgidFirst, page_id_t pgidLast, VScannedPage* pages)
+{
+	for(page_id_t pgid = pgidFirst; pgid <= pgidLast; ++ pgid)
+	{
+		Page pg(pio->readPage(pgid));
+
+		// skip invalid page
+		if(! pg.isCommitted()) continue;
+
+		pages->push_back((ScannedPage){pgid, pg.hdr()->txid, pg.hdr()->flags, pg.pageType()});
+	}
+}
+
+//! read headers of pages pgidFirst <= pgid <= pgidLast (in one partition)
+/*!
+ *	The pages are read forward, which is friendly to kernel readahead,
+ *	and large chunks are split among threads.
+ *
+ *	@param [out] pages committed pages in ascending pgid order
+ */
+void
+scanChunk(PageIO* pio, page_id_t pgidFirst, page_id_t pgidLast, VScannedPage* pages)
+{
+	pages->clear();
+
+	const size_t pgs = pgidLast - pgidFirst + 1;
+	const size_t nthr = std::min<size_t>(
+		std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1U), SCAN_THR_MAX),
+		std::max<size_t>(pgs / SCAN_PGS_PER_THR_MIN, 1));
+	if(nthr == 1)
+	{
+		scanPages(pio, pgidFirst, pgidLast, pages);
+		return;
+	}
+
+	std::vector<VScannedPage> parts(nthr);
+	std::vector<std::thread> thrs;
+	const size_t pgsPerThr = (pgs + nthr - 1) / nthr;
+	for(size_t i = 1; i < nthr; ++ i)
+	{
+		const page_id_t pgidThrFirst = pgidFirst + i * pgsPerThr;
+		const page_id_t pgidThrLast = std::min<page_id_t>(pgidThrFirst + pgsPerThr - 1, pgidLast);
+		thrs.push_back(std::thread(scanPages, pio, pgidThrFirst, pgidThrLast, &parts[i]));
+	}
+	scanPages(pio, pgidFirst, pgidFirst + pgsPerThr - 1, pages);
+	for(std::thread& t: thrs) t.join();
+
+	for(size_t i = 1; i < nthr; ++ i)
+	{
+		pages->insert(pages->end(), parts[i].begin(), parts[i].end());
+	}
+}
+
+} // end of anonymous namespace
+
+struct TPIO::checkpoint_t
+{
+	ver_t ver; //!< ver of latest tx reflected in the checkpoint
+	ver_t verBase;
+	page_id_t pgidStartPage;
+	uint64_t nUniquePages;
+
+	//! newest ovr of each page (pgidOrig, pgidOvr)
+	std::vector<pair<page_id_t, page_id_t> > ovrs;
+
+	//! pages w/ old links of the txs reflected in the checkpoint
+	PagesOldLink oldlink;
+};
+
+namespace
+{
+
+const uint64_t CHECKPOINT_MAGIC = 0x74706b636b6e7470ULL;
+
+//! adapts std::string to PagesOldLink::dump
+struct StrWriter
+{
+	std::string* str;
+
+	void write(BufferCRef buf)
+	{
+		str->append(buf.get(), buf.size());
+	}
+
+	template<typename T>
+	void writeVal(const T& v)
+	{
+		write(BufferCRef(&v, sizeof(T)));
+	}
+};
+
+} // end of anonymous namespace
+
+void
+TPIO::checkpoint()
+{
+	ActiveOvr* aovr = this->aovr();
+	const OvrSnapshot snap = aovr->newSnapshot();
+	if(snap.verRead() == m_verCheckpoint || snap.verRead() == aovr->verBase()) return;
+
+	// tx pages referred by the checkpoint must be durable before it
+	m_boundedsync.flush();
+	m_groupcommit.drain();
+
+	// serialize
+	std::string bytes;
+	StrWriter w = {&bytes};
+	w.writeVal(CHECKPOINT_MAGIC);
+	w.writeVal(snap.verRead());
+	w.writeVal(aovr->verBase());
+	w.writeVal(snap.pgidStartPage());
+	w.writeVal((uint64_t)m_stat.nUniquePages);
+
+	const size_t offNOvrs = bytes.size();
+	uint64_t nOvrs = 0;
+	w.writeVal(nOvrs);
+	aovr->forEachOvr([&w, &nOvrs] (OvrEntry* e) {
+		// discarded pages leave no trace in the log
+		for(; e; e = e->prev)
+		{
+			if(e->pgidOvr == PGID_INVALID) continue;
+
+			w.writeVal(e->pgidOrig);
+			w.writeVal(e->pgidOvr);
+			++ nOvrs;
+			break;
+		}
+	});
+	bytes.replace(offNOvrs, sizeof(uint64_t), reinterpret_cast<const char*>(&nOvrs), sizeof(uint64_t));
+
+	std::vector<const PagesOldLink*> oldlinks;
+	for(LocalOvr* o = aovr->lovrVerifiedTip(); o; o = o->prev())
+	{
+		if(! o->isMerged()) continue;
+
+		const TPIOTxSession::OvrExtra* extra = reinterpret_cast<TPIOTxSession::OvrExtra*>(o->getExtra());
+		if(! extra) continue; // rebase marker
+		oldlinks.push_back(&extra->oldlink);
+	}
+	PagesOldLink oldlink;
+	oldlink.merge(oldlinks);
+	oldlink.dump(w);
+
+	// write pages
+	BufferCRef buf(bytes.data(), bytes.size());
+	page_id_t pgidFirst = PGID_INVALID, pgidLast = PGID_INVALID;
+	OvrCheckpointPage pg;
+	while(! buf.empty())
+	{
+		pg = m_backend->newInitPage<OvrCheckpointPage>();
+		pg.pgidPrev() = pgidLast;
+		buf = pg.write(buf);
+
+		pg.hdr()->txid = snap.verRead();
+		pg.hdr()->flags = page_hdr_t::PF_VALID;
+
+		if(pgidFirst == PGID_INVALID) pgidFirst = pg.pageId();
+		pgidLast = pg.pageId();
+	}
+
+	// the last page is marked only after the rest are durable, so that a torn checkpoint is never loaded
+	if(m_sync) m_backend->syncRange(pgidFirst, pgidLast);
+	pg.hdr()->flags = page_hdr_t::PF_VALID | page_hdr_t::PF_END_TX;
+	if(m_sync) m_backend->syncRange(pgidLast, pgidLast);
+
+	m_verCheckpoint = snap.verRead();
+}
+
+bool
+TPIO::loadCheckpoint(page_id_t pgidEnd, checkpoint_t* ckpt)
+{
+	const ver_t ver = m_backend->readPage(pgidEnd).hdr()->txid;
+
+	// collect the chain of pages
+	std::vector<page_id_t> pgids;
+	for(page_id_t pgid = pgidEnd; pgid != PGID_INVALID; )
+	{
+		Page pg(m_backend->readPage(pgid));
+		if(! pg.isCommitted() || pg.pageType() != PT_OVRCHECKPOINT || pg.hdr()->txid != ver) return false;
+		pgids.push_back(pgid);
+
+		const page_id_t pgidPrev = OvrCheckpointPage(pg).pgidPrev();
+		if(pgidPrev != PGID_INVALID && pgidPrev >= pgid) return false;
+		pgid = pgidPrev;
+	}
+
+	Buffer bytes; bytes.reset();
+	for(auto it = pgids.rbegin(); it != pgids.rend(); ++ it)
+	{
+		bytes.append(OvrCheckpointPage(m_backend->readPage(*it)).read());
+	}
+
+	BufferCRef buf = bytes.rref();
+	uint64_t magic;
+	buf.popFrontTo(&magic, sizeof(uint64_t));
+	if(magic != CHECKPOINT_MAGIC) return false;
+
+	buf.popFrontTo(&ckpt->ver, sizeof(ver_t));
+	if(ckpt->ver != ver) return false;
+	buf.popFrontTo(&ckpt->verBase, sizeof(ver_t));
+	buf.popFrontTo(&ckpt->pgidStartPage, sizeof(page_id_t));
+	buf.popFrontTo(&ckpt->nUniquePages, sizeof(uint64_t));
+
+	uint64_t nOvrs;
+	buf.popFrontTo(&nOvrs, sizeof(uint64_t));
+	ckpt->ovrs.resize(nOvrs);
+	for(auto& ovr: ckpt->ovrs)
+	{
+		buf.popFrontTo(&ovr.first, sizeof(page_id_t));
+		buf.popFrontTo(&ovr.second, sizeof(page_id_t));
+	}
+
+	ckpt->oldlink.restore(buf);
+
+	return true;
+}
+
+void
+TPIO::restoreState()
 {
 	page_id_t pgidStartPage = PGID_INVALID;
-	// find last rebase tx and restore ovrs table	
+	// find last rebase tx (or checkpoint) and restore ovrs table	
 
-	// 1. scan the log backwards until rebase tx AND start page is found
+	// 1. scan the log backwards until rebase tx AND start page is found, or checkpoint is found
+	//    (chunks of the log are read forward, see scanChunk)
 	// remember the pages found in the process -> pagevers
 #ifdef DEBUG_VERBOSE_RESTORESTATE
 	printf("restore phase1 start\n");
 #endif
 	ver_t verBase = 1;
+	bool bRebaseFound = false;
+	unique_ptr<checkpoint_t> ckpt;
 	VPageVer pagevers;
-	PTNK_BKWD_SCAN(m_backend)
+	VScannedPage chunk;
+	size_t pgsChunk = SCAN_CHUNK_MIN;
+	for(part_id_t partid = PGID_PARTID(m_backend->getLastPgId()); partid != PTNK_PARTID_INVALID; -- partid)
 	{
-		Page pg(m_backend->readPage(pgid));
+		const local_pgid_t localLast = m_backend->getPartLastLocalPgId(partid);
+		if(PGID_LOCALID(localLast) == PGID_LOCALID_MASK) continue; // no page in the partition
 
-		page_hdr_t::flags_t flags = pg.hdr()->flags;
-		tx_id_t ver = pg.hdr()->txid;
+		// scan the partition in chunks from its tail, each chunk read forward
+		for(local_pgid_t localEnd = localLast + 1; localEnd > 0; )
+		{
+			const local_pgid_t localBegin = localEnd > pgsChunk ? localEnd - pgsChunk : 0;
+			pgsChunk = std::min<size_t>(pgsChunk * 2, SCAN_CHUNK_MAX);
 
-		// skip invalid page
-		if(! pg.isCommitted()) continue;
+			// let the next chunk be read in while scanning this one
+			if(localBegin > 0)
+			{
+				const local_pgid_t localNext = localBegin > pgsChunk ? localBegin - pgsChunk : 0;
+				m_backend->prefetchRange(PGID_PARTLOCAL(partid, localNext), PGID_PARTLOCAL(partid, localBegin - 1));
+			}
+
+			scanChunk(m_backend.get(), PGID_PARTLOCAL(partid, localBegin), PGID_PARTLOCAL(partid, localEnd - 1), &chunk);
+			localEnd = localBegin;
+
+			for(VScannedPage::const_reverse_iterator itC = chunk.rbegin(); itC != chunk.rend(); ++ itC)
+			{
+				const page_id_t pgid = itC->pgid;
+				const page_hdr_t::flags_t flags = itC->flags;
+				const tx_id_t ver = itC->ver;
 
 #ifdef DEBUG_VERBOSE_RESTORESTATE
-		std::cout << "ver: " << ver << " scan valid pg: " << pgid2str(pgid) << std::endl;
+				std::cout << "ver: " << ver << " scan valid pg: " << pgid2str(pgid) << std::endl;
 #endif
 
-		if(pgidStartPage == PGID_INVALID && pg.pageType() == PT_DB_OVERVIEW)
-		{
-			// start page found.
-			pgidStartPage = pgid;
+				if(itC->type == PT_OVRCHECKPOINT)
+				{
+					// checkpoints older than the last rebase are obsolete
+					if(bRebaseFound || !(flags & page_hdr_t::PF_END_TX)) continue;
+
+					ckpt.reset(new checkpoint_t);
+					if(! loadCheckpoint(pgid, ckpt.get()))
+					{
+						ckpt.reset();
+						continue;
+					}
+
+					// checkpoint found. the log before it needn't be replayed
+					verBase = ckpt->verBase;
+					if(pgidStartPage == PGID_INVALID) pgidStartPage = ckpt->pgidStartPage;
+#ifdef DEBUG_VERBOSE_RESTORESTATE
+					std::cout << "- checkpoint ver: " << ckpt->ver << " ovrs: " << ckpt->ovrs.size() << std::endl;
+#endif
+					goto SCANDONE;
+				}
+
+				if(pgidStartPage == PGID_INVALID && itC->type == PT_DB_OVERVIEW)
+				{
+					// start page found.
+					pgidStartPage = pgid;
 
 #ifdef DEBUG_VERBOSE_RESTORESTATE
-		    std::cout << "- " << pgid2str(pgidStartPage) << " as startpg" << std::endl;
+					std::cout << "- " << pgid2str(pgidStartPage) << " as startpg" << std::endl;
 #endif
-		}
+				}
 
-		if((flags & page_hdr_t::PF_END_TX) && (flags & page_hdr_t::PF_TX_REBASE))
-		{
-			// rebase tx found.
-			verBase = ver;
+				if((flags & page_hdr_t::PF_END_TX) && (flags & page_hdr_t::PF_TX_REBASE))
+				{
+					// rebase tx found.
+					verBase = ver;
+					bRebaseFound = true;
 
-			// FIXME: This code assumes that no concurrent tx cross rebase tx pages
-			//        However, this may not be the case in future.
+					// FIXME: This code assumes that no concurrent tx cross rebase tx pages
+					//        However, this may not be the case in future.
 
 #ifdef DEBUG_VERBOSE_RESTORESTATE
-		    std::cout << "- as rebase tx" << std::endl;
+					std::cout << "- as rebase tx" << std::endl;
 #endif
-		}
-		
-		pagevers.push_back((PageVer){pgid, ver});
+				}
 
-		if(ver < verBase && pgidStartPage != PGID_INVALID)
-		{
-			// all the scanning jobs done. quit back scan
-			goto SCANDONE;
+				pagevers.push_back((PageVer){pgid, ver});
+
+				if(ver < verBase && pgidStartPage != PGID_INVALID)
+				{
+					// all the scanning jobs done. quit back scan
+					goto SCANDONE;
+				}
+			}
 		}
 	}
 	SCANDONE:;
@@ -607,17 +1552,59 @@ TPIO::restoreState()
 	// 3. for each pages found in the scan, sorted by its version,
 	//    add ovr entries and handle streak data per tx
 	{
-		std::lock_guard<std::mutex> g(m_mtxAOvr);
-		m_aovr = shared_ptr<ActiveOvr>(new ActiveOvr(pgidStartPage, verBase));
+		PTNK_ASSERT(! m_aovr);
+		m_aovr = new ActiveOvr(pgidStartPage, verBase);
 	}
 	unique_ptr<TPIOTxSession> tx = newTransaction();
-	tx_id_t verCurrent = verBase;
+
+	// txs up to _verStart_ are already reflected
+	ver_t verStart = verBase;
+	if(ckpt)
+	{
+		// replay checkpoint as a tx
+		for(const auto& ovr: ckpt->ovrs)
+		{
+			tx->addOvr(ovr.first, ovr.second);
+		}
+		tx->oldlink()->merge(ckpt->oldlink);
+		if(ckpt->ver != verBase)
+		{
+			PTNK_CHECK(ckpt->ver == m_aovr->tryCommit(tx->m_lovr, COMMIT_REPLAY, ckpt->ver));
+		}
+
+		tx = newTransaction();
+		tx->m_stat.nUniquePages = ckpt->nUniquePages;
+		verStart = ckpt->ver;
+	}
+
+	tx_id_t verCurrent = verStart;
 	Buffer bufStreak; bufStreak.reset();
+	bool bStreakCompact = false; // streaks written before PF_STREAK_COMPACT was introduced are in raw format
+	bool bStreakEager = false;
+
+	// restore the streak of the current tx, and add ovr entries for its pages written back before commit, which the scan skips
+	auto loadTxStreak = [&] () {
+		Vpage_id_t pagesEager;
+		tx->loadStreak(bufStreak.rref(), bStreakCompact, bStreakEager ? &pagesEager : nullptr);
+		if(verCurrent <= verBase) return;
+
+		for(page_id_t pgid: pagesEager)
+		{
+			page_id_t orig = Page(m_backend->readPage(pgid)).pageOvrTgt();
+			if(orig != PGID_INVALID)
+			{
+#ifdef DEBUG_VERBOSE_RESTORESTATE
+				printf("- add ovr entry %d -> %d (eager)\n", orig, pgid);
+#endif
+				tx->addOvr(orig, pgid);
+			}
+		}
+	};
 
 	VPageVer::const_reverse_iterator it = pagevers.rbegin(), itE = pagevers.rend();
 	for(; it != itE; ++ it)
 	{
-		if(it->ver < verBase) continue;
+		if(it->ver < verStart) continue;
 
 		if(it->ver != verCurrent)
 		{
@@ -627,11 +1614,11 @@ TPIO::restoreState()
 #endif
 			// commit current tx
 			// -- streak
-			tx->loadStreak(bufStreak.rref());
+			loadTxStreak();
 			bufStreak.reset();
 
 			// -- ovr entries
-			if(verCurrent != verBase)
+			if(verCurrent != verStart)
 			{
 				PTNK_CHECK(verCurrent == m_aovr->tryCommit(tx->m_lovr, COMMIT_REPLAY, verCurrent));
 			}
@@ -660,6 +1647,8 @@ TPIO::restoreState()
 		}
 
 		// -- page streaks
+		bStreakCompact = pg.hdr()->flags & page_hdr_t::PF_STREAK_COMPACT;
+		bStreakEager = pg.hdr()->flags & page_hdr_t::PF_STREAK_EAGER;
 		if(pg.pageType() != PT_OVFLSTREAK)
 		{
 			BufferCRef pgstreak(pg.streak(), Page::STREAK_SIZE);
@@ -675,19 +1664,39 @@ TPIO::restoreState()
 #ifdef DEBUG_VERBOSE_RESTORESTATE
 	printf("replay tx %d (last one)\n", verCurrent);
 #endif
-	tx->loadStreak(bufStreak.rref());
+	loadTxStreak();
 	m_stat.nUniquePages = tx->m_stat.nUniquePages; // FIXME
-	if(verCurrent != verBase)
+	if(verCurrent != verStart)
 	{
 		PTNK_CHECK(verCurrent == m_aovr->tryCommit(tx->m_lovr, COMMIT_REPLAY, verCurrent));
 	}
+	m_verCheckpoint = verCurrent;
 }
 
-TPIO::RebaseTPIOTxSession::RebaseTPIOTxSession(TPIO* tpio, shared_ptr<ActiveOvr> aovr, unique_ptr<LocalOvr> lovr, PagesOldLink* oldlink)
-:	TPIOTxSession(tpio, move(aovr), move(lovr)),
-	m_oldlinkRebase(oldlink)
+TPIO::RebaseTPIOTxSession::RebaseTPIOTxSession(TPIO* tpio, ActiveOvr* aovr, unique_ptr<LocalOvr> lovr)
+:	TPIOTxSession(tpio, aovr, move(lovr)),
+	m_pgidStartSnapshot(pgidStartPage()),
+	m_pgidLastSnapshot(tpio->backend()->getLastPgId())
 {
-	/* NOP */
+	// ready list of pages w/ old link in the snapshot
+	MUTEXPROF_START("rebase:pol");
+	const ver_t verSnapshot = m_lovr->verRead();
+	std::vector<const PagesOldLink*> oldlinks;
+	for(LocalOvr* o = aovr->lovrVerifiedTip(); o; o = o->prev())
+	{
+		if(! o->isMerged()) continue; // skip terminator
+		if(o->verWrite() > verSnapshot) continue; // committed after snapshot
+
+		const OvrExtra* extra = reinterpret_cast<OvrExtra*>(o->getExtra());
+		if(! extra) continue; // rebase marker
+		oldlinks.push_back(&extra->oldlink);
+	}
+	m_oldlinkRebase.merge(oldlinks);
+	m_visited.assign(m_oldlinkRebase.size(), 0);
+	MUTEXPROF_END;
+#ifdef VERBOSE_REBASE
+	std::cerr << m_oldlinkRebase << std::endl;
+#endif
 }
 
 TPIO::RebaseTPIOTxSession::~RebaseTPIOTxSession()
@@ -698,16 +1707,23 @@ TPIO::RebaseTPIOTxSession::~RebaseTPIOTxSession()
 page_id_t
 TPIO::RebaseTPIOTxSession::rebaseForceVisit(page_id_t pgid)
 {
-	m_visited.insert(pgid);
-	
+	const size_t idx = m_oldlinkRebase.indexOf(pgid);
+	if(idx != PagesOldLink::NPOS) m_visited[idx] = 1;
+
+	return doVisit(pgid, this);
+}
+
+page_id_t
+TPIO::RebaseTPIOTxSession::doVisit(page_id_t pgid, PageIO* pio)
+{
 #ifdef VERBOSE_REBASE
 	std::cout << "rebase visit pgid: " << pgid << std::endl;
 #endif
 
-	Page pg(readPage(pgid));
+	Page pg(pio->readPage(pgid));
 
 	mod_info_t mod;
-	pg.updateLinks(&mod, this);
+	pg.updateLinks(&mod, pio);
 	
 	return mod.isValid() ? mod.idOvr : pgid;
 }
@@ -715,19 +1731,304 @@ TPIO::RebaseTPIOTxSession::rebaseForceVisit(page_id_t pgid)
 page_id_t
 TPIO::RebaseTPIOTxSession::rebaseVisit(page_id_t pgid)
 {
-	if(! m_oldlinkRebase->contains(pgid))
+	const size_t idx = m_oldlinkRebase.indexOf(pgid);
+	if(idx == PagesOldLink::NPOS)
 	{
 		// no need to visit
 		return pgid;
 	}
 
-	if(m_visited.find(pgid) != m_visited.end())
+	if(! claimVisit(idx))
 	{
 		// already visited
 		return pgid;
 	}
 
-	return rebaseForceVisit(pgid);
+	return doVisit(pgid, this);
+}
+
+namespace
+{
+
+enum
+{
+	//! snapshots w/ less pages w/ old links are rebased on single thr
+	REBASE_PGS_PAR_MIN = 64,
+
+	//! num subtrees to fan out per thr, so that uneven subtrees are balanced among thrs
+	REBASE_SUBTREES_PER_THR = 4,
+
+	//! max depth from the start page to look for subtrees to fan out
+	REBASE_FANOUT_DEPTH_MAX = 4,
+};
+
+} // end of anonymous namespace
+
+//! lists links of a page w/o modifying it
+class TPIO::RebaseTPIOTxSession::LinkCollector : public PageIO
+{
+public:
+	explicit LinkCollector(const PagesOldLink* oldlink)
+	:	m_oldlink(oldlink)
+	{ /* NOP */ }
+
+	//! links to pages w/ old links
+	Vpage_id_t links;
+
+	// ====== implements PageIO interface ======
+	pair<Page, page_id_t> newPage()
+	{
+		PTNK_THROW_LOGIC_ERR("newPage called on LinkCollector");
+	}
+
+	Page readPage(page_id_t pgid)
+	{
+		PTNK_THROW_LOGIC_ERR("readPage called on LinkCollector");
+	}
+
+	Page modifyPage(const Page& page, mod_info_t* mod)
+	{
+		// let the page be updated on scratch
+		::memcpy(m_scratch, page.getRaw(), PTNK_PAGE_SIZE);
+		mod->reset();
+
+		return Page(m_scratch, true);
+	}
+
+	void sync(page_id_t pgid)
+	{
+		/* NOP */
+	}
+
+	page_id_t getLastPgId() const
+	{
+		PTNK_THROW_LOGIC_ERR("getLastPgId called on LinkCollector");
+	}
+
+	page_id_t updateLink(page_id_t pgidOld)
+	{
+		if(m_oldlink->contains(pgidOld)) links.push_back(pgidOld);
+
+		return pgidOld;
+	}
+
+private:
+	const PagesOldLink* m_oldlink;
+
+	//! Page keeps its flags in the low bits of the ptr
+	char m_scratch[PTNK_PAGE_SIZE] __attribute__ ((aligned (16)));
+};
+
+//! rebases subtrees on a thr of RebaseTPIOTxSession::visitParallel
+/*!
+ *	Pages are read through own snapshot, and ovrs / pages modified are kept local
+ *	until they are joined into the rebase tx by RebaseTPIOTxSession::visitParallel.
+ */
+class TPIO::RebaseTPIOTxSession::Worker : public PageIO
+{
+public:
+	explicit Worker(RebaseTPIOTxSession* tx)
+	:	m_tx(tx),
+		m_snap(tx->m_aovr->newSnapshot(tx->m_lovr->verRead()))
+	{ /* NOP */ }
+
+	//! rebase subtree of _pgid_
+	page_id_t visit(page_id_t pgid)
+	{
+		const size_t idx = m_tx->m_oldlinkRebase.indexOf(pgid);
+		if(idx == PagesOldLink::NPOS || ! m_tx->claimVisit(idx)) return pgid;
+
+		return m_tx->doVisit(pgid, this);
+	}
+
+	// ====== implements PageIO interface ======
+	pair<Page, page_id_t> newPage()
+	{
+		++ m_stat.nUniquePages;
+
+		return m_tx->backend()->newPage();
+	}
+
+	Page readPage(page_id_t pgid)
+	{
+		++ m_stat.nRead;
+
+		auto it = m_ovrsLocal.find(pgid);
+		if(it != m_ovrsLocal.end())
+		{
+			// modified by this worker. pg is mutable
+			Page pg(m_tx->backend()->readPage(it->second));
+			pg.setIsBase(false);
+			pg.setMutable();
+
+			++ m_stat.nReadOvr;
+			++ m_stat.nReadOvrLocal;
+			return pg;
+		}
+
+		page_id_t pgidOvr; ovr_status_t st;
+		tie(pgidOvr, st) = m_snap.searchOvr(pgid);
+
+		Page pg(m_tx->backend()->readPage(pgidOvr));
+		pg.setIsBase(st == OVR_NONE);
+		if(st != OVR_NONE) ++ m_stat.nReadOvr;
+
+		return pg;
+	}
+
+	Page modifyPage(const Page& page, mod_info_t* mod)
+	{
+		++ m_stat.nModifyPage;
+
+		if(page.isMutable())
+		{
+			mod->reset();
+			return page;
+		}
+
+		++ m_stat.nOvr;
+
+		mod->idOrig = page.pageOrigId();
+
+		Page ovr;
+		tie(ovr, mod->idOvr) = newPage();
+		ovr.makePageOvr(page, mod->idOvr);
+
+		m_ovrsLocal[mod->idOrig] = mod->idOvr;
+		ovrs.push_back(make_pair(mod->idOrig, mod->idOvr));
+
+		return ovr;
+	}
+
+	void sync(page_id_t pgid)
+	{
+		++ m_stat.nSync;
+
+		pagesModified.push_back(pgid);
+	}
+
+	page_id_t getLastPgId() const
+	{
+		return m_tx->backend()->getLastPgId();
+	}
+
+	void notifyPageWOldLink(page_id_t pgid)
+	{
+		++ m_stat.nNotifyOldLink;
+
+		oldlink.push_back(pgid);
+	}
+
+	page_id_t updateLink(page_id_t idOld)
+	{
+		page_id_t idR = visit(idOld);
+		if(idR != idOld) return idR;
+
+		auto it = m_ovrsLocal.find(idOld);
+		if(it != m_ovrsLocal.end()) return it->second;
+
+		page_id_t idO; ovr_status_t st;
+		tie(idO, st) = m_snap.searchOvr(idOld);
+		if(st == OVR_GLOBAL) resolved.push_back(idOld);
+
+		return idO;
+	}
+
+	// ====== results joined into the rebase tx ======
+	std::vector<pair<page_id_t, page_id_t> > ovrs;
+	Vpage_id_t pagesModified;
+	Vpage_id_t oldlink;
+	Vpage_id_t resolved;
+	std::exception_ptr e;
+
+	const TPIOStat& stat() const
+	{
+		return m_stat;
+	}
+
+private:
+	RebaseTPIOTxSession* m_tx;
+	OvrSnapshot m_snap;
+	std::unordered_map<page_id_t, page_id_t> m_ovrsLocal;
+	TPIOStat m_stat;
+};
+
+void
+TPIO::RebaseTPIOTxSession::visitParallel(size_t nthr)
+{
+	// 1. find subtrees to fan out: expand pages w/ old links from the start page level by level.
+	//    pages expanded are left to the serial visit, which links them to the rebased subtrees
+	Vpage_id_t subtrees(1, pgidStartPage());
+	for(int depth = 0; depth < REBASE_FANOUT_DEPTH_MAX; ++ depth)
+	{
+		LinkCollector lc(&m_oldlinkRebase);
+		for(page_id_t pgid: subtrees)
+		{
+			Page pg(readPage(pgid));
+			mod_info_t mod;
+			pg.updateLinks(&mod, &lc);
+		}
+		if(lc.links.empty()) break;
+
+		subtrees.swap(lc.links);
+		if(subtrees.size() >= nthr * REBASE_SUBTREES_PER_THR) break;
+	}
+	if(subtrees.size() == 1 && subtrees.front() == pgidStartPage()) return; // nothing to fan out
+	nthr = std::min(nthr, subtrees.size());
+
+	// 2. rebase the subtrees. thrs take subtrees one by one
+	std::vector<unique_ptr<Worker> > workers;
+	for(size_t i = 0; i < nthr; ++ i) workers.push_back(unique_ptr<Worker>(new Worker(this)));
+
+	volatile size_t iNext = 0;
+	auto run = [&subtrees, &iNext] (Worker* w) {
+		try
+		{
+			for(;;)
+			{
+				const size_t i = __sync_fetch_and_add(&iNext, 1);
+				if(i >= subtrees.size()) break;
+
+				w->visit(subtrees[i]);
+			}
+		}
+		catch(...)
+		{
+			w->e = std::current_exception();
+		}
+	};
+	std::vector<std::thread> thrs;
+	for(size_t i = 1; i < nthr; ++ i)
+	{
+		thrs.push_back(std::thread(run, workers[i].get()));
+	}
+	run(workers[0].get());
+	for(std::thread& t: thrs) t.join();
+
+	// 3. join results into the rebase tx
+	for(const unique_ptr<Worker>& w: workers)
+	{
+		if(w->e) std::rethrow_exception(w->e);
+
+		for(const auto& ovr: w->ovrs) addOvr(ovr.first, ovr.second);
+		m_pagesModified.insert(m_pagesModified.end(), w->pagesModified.begin(), w->pagesModified.end());
+		oldlink()->addRange(w->oldlink.begin(), w->oldlink.end());
+		m_resolved.insert(w->resolved.begin(), w->resolved.end());
+		m_stat.merge(w->stat());
+	}
+}
+
+void
+TPIO::RebaseTPIOTxSession::visitAll()
+{
+	MUTEXPROF_START("rebase:visit");
+	const size_t nthr = m_tpio->rebaseThreads();
+	if(nthr > 1 && m_oldlinkRebase.size() >= REBASE_PGS_PAR_MIN)
+	{
+		visitParallel(nthr);
+	}
+	setPgidStartPage(rebaseForceVisit(pgidStartPage()));
+	MUTEXPROF_END;
 }
 
 page_id_t
@@ -742,78 +2043,179 @@ TPIO::RebaseTPIOTxSession::updateLink(page_id_t idOld)
 		return idR;
 	}
 
-	page_id_t idO = m_lovr->searchOvr(idOld).first;
+	page_id_t idO; ovr_status_t st;
+	tie(idO, st) = m_lovr->searchOvr(idOld);
+	if(st == OVR_GLOBAL)
+	{
+		// the link now points to the ovr page of the snapshot.
+		// later ovrs of _idOld_ won't be visible from the rebased pages
+		m_resolved.insert(idOld);
+	}
 #ifdef VERBOSE_REBASE
 	std::cout << "updateLink: " << pgid2str(idOld) << " -> " << pgid2str(idO) << std::endl;	
 #endif
 	return idO;
 }
 
+bool
+TPIO::RebaseTPIOTxSession::canCarryOver(const LocalOvr* lovr) const
+{
+	// rebased start page does not reflect the tx
+	if(lovr->pgidStartPage() != m_pgidStartSnapshot) return false;
+
+	// tx pages are placed before the rebase tx in the log,
+	// so restoreState would stop scanning before reaching them
+	const OvrExtra* extra = reinterpret_cast<const OvrExtra*>(const_cast<LocalOvr*>(lovr)->getExtra());
+	if(extra && extra->pgidFirst != PGID_INVALID && extra->pgidFirst <= m_pgidLastSnapshot) return false;
+
+	// tx overrides pages which are also overridden by rebase tx, or which links are already resolved by rebase tx
+	bool bConflict = false;
+	lovr->forEachOvr([this, &bConflict](OvrEntry* e) {
+		if(bConflict) return;
+
+		const page_id_t pgid = e->pgidOrig;
+		if(m_lovr->searchOvr(pgid).second == OVR_LOCAL || m_resolved.count(pgid))
+		{
+			bConflict = true;
+		}
+	});
+
+	return ! bConflict;
+}
+
+page_id_t
+TPIO::RebaseTPIOTxSession::rebasedId(page_id_t pgid) const
+{
+	return m_lovr->searchOvr(pgid).first;
+}
+
+bool
+TPIO::carryOver(ActiveOvr* aovrOld, ActiveOvr* aovrNew, RebaseTPIOTxSession* tx)
+{
+	// 1. list txs committed after the snapshot (older one first)
+	std::vector<LocalOvr*> lovrsDelta;
+	for(LocalOvr* o = aovrOld->lovrVerifiedTip(); o; o = o->prev())
+	{
+		if(! o->isMerged()) continue; // skip terminator
+		if(o->verWrite() <= tx->m_lovr->verRead()) break; // reached snapshot
+
+		if(! tx->canCarryOver(o)) return false;
+		lovrsDelta.push_back(o);
+	}
+	std::reverse(lovrsDelta.begin(), lovrsDelta.end());
+
+	// 2. replay the txs on new generation
+	unsigned int nOvr = 0;
+	for(LocalOvr* o: lovrsDelta)
+	{
+		unique_ptr<LocalOvr> lovr = aovrNew->newTx();
+		o->forEachOvr([&lovr, &nOvr](OvrEntry* e) {
+			lovr->addOvr(e->pgidOrig, e->pgidOvr);
+			++ nOvr;
+		});
+
+		// pages w/ old links may have been rewritten by the rebase
+		unique_ptr<TPIOTxSession::OvrExtra> extra(new TPIOTxSession::OvrExtra);
+		if(TPIOTxSession::OvrExtra* extraOld = reinterpret_cast<TPIOTxSession::OvrExtra*>(o->getExtra()))
+		{
+			Vpage_id_t rebased;
+			rebased.reserve(extraOld->oldlink.size());
+			for(page_id_t pgid: extraOld->oldlink)
+			{
+				rebased.push_back(tx->rebasedId(pgid));
+			}
+			extra->oldlink.addRange(rebased.begin(), rebased.end());
+			extra->pgidFirst = extraOld->pgidFirst;
+		}
+		lovr->attachExtra(move(extra));
+
+		PTNK_CHECK(aovrNew->tryCommit(lovr, COMMIT_REPLAY, o->verWrite()) == o->verWrite());
+	}
+
+	m_stat.nOvr = nOvr;
+	m_stat.nRebaseCarryOver += lovrsDelta.size();
+	return true;
+}
+
 void
 TPIO::rebase(bool force)
 {
 	if(m_bDuringRebase) return; // already during rebase
 
-	if(!force && m_stat.nOvr < REBASE_THRESHOLD) return; // num ovrs below threshold
+	if(!force && !m_policy.needRebase(m_stat.nOvr)) return; // num ovrs below threshold
 
 	if(! PTNK_CAS(&m_bDuringRebase, false, true)) return;
 
+	switch(m_policy.adapt())
+	{
+	case +1: ++ m_stat.nRebaseThresholdUp; break;
+	case -1: ++ m_stat.nRebaseThresholdDown; break;
+	}
+	m_stat.rebaseThreshold = m_policy.threshold();
+
 #ifdef VERBOSE_REBASE
 	printf("rebase start\n");
 	std::cout << *this;
 #endif
 	STAGEPROF_STAGE(0x0000FF);
+	++ m_stat.nRebase;
 
-	// 1. refuse further tx to commit
-	m_aovr->terminate(); // put terminator to lovr linked-list and do merge
-	
-	// 2. ready list of pages old link
-	PagesOldLink pol;
-	{
-		MUTEXPROF_START("rebase:pol");
-		for(LocalOvr* o = m_aovr->lovrVerifiedTip(); o; o = o->prev())
-		{
-			if(! o->isMerged()) continue; // skip terminator
-
-			const PagesOldLink& opol = reinterpret_cast<TPIOTxSession::OvrExtra*>(o->getExtra())->oldlink;
-			pol.merge(opol);
-		}
-		MUTEXPROF_END;
-	}
-#ifdef VERBOSE_REBASE
-	std::cerr << pol << std::endl;
-#endif
+	// rebase is the only one replacing m_aovr, so _aovr_ stays valid until it is retired in 6.
+	ActiveOvr* aovr = this->aovr();
 
-	// 3. create rebsae tx. and start visit from root
+	// 1. take snapshot to be rebased
+	//    An empty tx is committed to reserve ver for the rebase tx,
+	//    so that txs committed during the rebase are given newer vers and are replayed after the rebase tx in restoreState
 	ver_t verBase;
-	unique_ptr<RebaseTPIOTxSession> tx;
 	{
-		shared_ptr<ActiveOvr> aovr = m_aovr;
-		unique_ptr<LocalOvr> lovr(aovr->newTx());
-		verBase = lovr->verRead() + 1;
-		// ver_t verB2 = m_aovr->lovrVerifiedTip()->prev()->verWrite() + 1;
-		// PTNK_CHECK(verBase == verB2);
-		tx.reset(new RebaseTPIOTxSession(this, move(aovr), move(lovr), &pol));
+		unique_ptr<LocalOvr> lovrMarker(aovr->newTx());
+		verBase = aovr->tryCommit(lovrMarker);
+		PTNK_CHECK(verBase != TXID_INVALID);
 	}
-	
+	HighResTimeStamp tsVisitBegin; tsVisitBegin.reset();
+	unique_ptr<RebaseTPIOTxSession> tx(new RebaseTPIOTxSession(this, aovr, aovr->newTx(verBase)));
+
+	// 2. rebase the snapshot. Other txs continue to run / commit on the old generation meanwhile
+	tx->visitAll();
 	{
-		MUTEXPROF_START("rebase:visit");
-		tx->setPgidStartPage(tx->rebaseForceVisit(tx->pgidStartPage()));
-		MUTEXPROF_END;
+		HighResTimeStamp tsVisitEnd; tsVisitEnd.reset();
+		m_stat.nsRebaseVisit += tsVisitEnd.elapsed_ns(tsVisitBegin);
+		m_stat.nRebaseOldLink += tx->numOldLink();
 	}
-
 #ifdef VERBOSE_REBASE
 	std::cerr << *tx << std::endl;
 #endif
-	
-	// 4. trash old aovr and start accepting new tx
-	m_stat.nOvr = 0; // clear num ovr.
-	// FIXME FIXME: shared_ptr can't be assigned atomically (refcnt / ptr)
-	m_aovr = shared_ptr<ActiveOvr>(new ActiveOvr(tx->pgidStartPage(), verBase));
 
+	// 3. hand over to new generation
+	//    new txs are held from here, as old generation no longer accepts commits
+	m_bDuringHandover = true;
 	PTNK_MEMBARRIER_COMPILER;
+	aovr->terminate(); // put terminator to lovr linked-list and do merge
 
-	m_bDuringRebase = false;
+	unique_ptr<ActiveOvr> aovrNew(new ActiveOvr(tx->pgidStartPage(), verBase));
+	if(! carryOver(aovr, aovrNew.get(), tx.get()))
+	{
+		// some txs committed during rebase were based on pages the rebase tx has updated.
+		// redo rebase on the terminated generation
+		++ m_stat.nRebaseRedo;
+
+		unique_ptr<LocalOvr> lovr(aovr->newTx());
+		verBase = lovr->verRead() + 1;
+		tx.reset(new RebaseTPIOTxSession(this, aovr, move(lovr)));
+		tx->visitAll();
+
+		aovrNew.reset(new ActiveOvr(tx->pgidStartPage(), verBase));
+		m_stat.nOvr = 0; // clear num ovr.
+	}
+
+	// 4. publish new aovr and start accepting new tx
+	//    old aovr is retired. it is destructed (off the tx path, if helper thr is attached)
+	//    once txs started on it are done
+	publishAOvr(aovrNew.release());
+	{
+		std::lock_guard<std::mutex> g(m_mtxRebase);
+		m_bDuringHandover = false;
+	}
 	m_condRebase.notify_all();
 
 	// 5. commit rebase tx. pages
@@ -824,9 +2226,25 @@ TPIO::rebase(bool force)
 	std::cout << *this;
 #endif
 
+	PTNK_MEMBARRIER_COMPILER;
+	m_bDuringRebase = false;
+
 	STAGEPROF_STAGE(0x000000);
 }
 
+void
+TPIO::publishAOvr(ActiveOvr* aovrNew)
+{
+	ActiveOvr* aovrOld = m_aovr;
+
+	// aovrNew must be fully constructed before it is seen by other thrs
+	PTNK_MEMBARRIER_HW;
+	m_aovr = aovrNew;
+	PTNK_MEMBARRIER_HW;
+
+	m_epoch.retire([aovrOld] () { delete aovrOld; });
+}
+
 void
 TPIO::refreshOldPages(page_id_t threshold, size_t pgsPerTx)
 {
@@ -903,10 +2321,24 @@ TPIO::refreshOldPages(page_id_t threshold, size_t pgsPerTx)
 	rebase(/* force = */ true);
 }
 
+void
+TPIO::notifyTxEnd(TPIOTxSession* tx)
+{
+	// chain walk count is moved to tx->m_stat on commit, as lovr is handed to ActiveOvr
+	const unsigned int nChainWalk = tx->m_lovr ? tx->m_lovr->nChainWalk() : tx->m_stat.nOvrChainWalk;
+	m_policy.notifyTxEnd(tx->m_stat.nRead, nChainWalk);
+}
+
+void
+TPIO::notifyTxEnd(TPIOSnapshot* ss)
+{
+	m_policy.notifyTxEnd(ss->nRead(), ss->nChainWalk());
+}
+
 void
 TPIO::join()
 {
-	m_txpool->join();
+	m_epoch.synchronize();
 }
 
 void
@@ -914,6 +2346,8 @@ TPIO::dump(std::ostream& s) const
 {
 	s << "** TPIO dump **" << std::endl;
 	s << m_stat;
+	s << "  aovr arena chunks:\t" << m_aovr->arena().numChunks() << std::endl;
+	m_policy.dump(s);
 	m_backend->dumpStat(); // FIXME!
 }
 
@@ -4,8 +4,13 @@
 #include "pageio.h"
 #include "stm.h"
 #include "pol.h"
+#include "sysutils.h"
+#include "epoch.h"
 
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 
 // Transactional PageIO impl. using stm.h
 
@@ -27,6 +32,42 @@ struct TPIOStat
 
 	unsigned int nNotifyOldLink;
 
+	unsigned int nOvrAlloc; //!< num ovr bookkeeping allocs (served by OvrArena)
+	unsigned int nOvrChunkAlloc; //!< num OvrArena chunk mallocs
+
+	unsigned int nRebase; //!< num rebases done
+	unsigned int nRebaseRedo; //!< num rebases redone w/ new tx held, as txs committed during rebase conflicted
+	unsigned int nRebaseCarryOver; //!< num txs committed during rebase and carried over to the rebased generation
+	unsigned int nRebaseStall; //!< num newTransaction calls stalled by rebase
+	uint64_t nsRebaseStall; //!< total time newTransaction calls stalled by rebase [ns]
+	uint64_t nsRebaseVisit; //!< total time rebases spent collecting pages w/ old links and visiting them [ns]
+	uint64_t nRebaseOldLink; //!< total num pages w/ old links collected by rebases
+
+	unsigned int nOvrChainWalk; //!< num global ovr entries examined on page reads
+
+	unsigned int rebaseThreshold; //!< current num ovrs which trigger rebase (see RebasePolicy)
+	unsigned int nRebaseThresholdUp; //!< num times rebase threshold was raised
+	unsigned int nRebaseThresholdDown; //!< num times rebase threshold was lowered
+
+	unsigned int nConflictResolved; //!< num txs committed by replaying key ops after page level conflict
+	unsigned int nConflictKey; //!< num txs aborted on key level conflict
+
+	unsigned int nSyncBatch; //!< num group commit batches flushed
+	unsigned int nSyncBatchTx; //!< num txs synced in group commit batches
+
+	unsigned int nBoundedFlush; //!< num OBOUNDEDSYNC windows flushed
+	unsigned int nBoundedFlushInline; //!< num OBOUNDEDSYNC windows flushed by committers as they hit the bound
+	uint64_t nsUnsyncedMax; //!< max age of OBOUNDEDSYNC window at flush [ns]
+	uint64_t bytesUnsyncedMax; //!< max size of OBOUNDEDSYNC window at flush [bytes]
+
+	unsigned int nEagerWriteback; //!< num writebacks started before commit
+	unsigned int nEagerWritebackPages; //!< num pages written back before commit
+	unsigned int nEagerUnstampedPages; //!< num tx pages written back before commit and left untouched by it
+
+	unsigned int nStreakTx; //!< num txs which wrote streaks
+	uint64_t bytesStreak; //!< total bytes of streaks written
+	unsigned int nStreakOvflPages; //!< num pages alloced for streaks not fit in the tx pages
+
 	TPIOStat() :
 		nUniquePages(0),
 		nRead(0),
@@ -35,7 +76,34 @@ struct TPIOStat
 		nModifyPage(0),
 		nOvr(0),
 		nSync(0),
-		nNotifyOldLink(0)
+		nNotifyOldLink(0),
+		nOvrAlloc(0),
+		nOvrChunkAlloc(0),
+		nRebase(0),
+		nRebaseRedo(0),
+		nRebaseCarryOver(0),
+		nRebaseStall(0),
+		nsRebaseStall(0),
+		nsRebaseVisit(0),
+		nRebaseOldLink(0),
+		nOvrChainWalk(0),
+		rebaseThreshold(0),
+		nRebaseThresholdUp(0),
+		nRebaseThresholdDown(0),
+		nConflictResolved(0),
+		nConflictKey(0),
+		nSyncBatch(0),
+		nSyncBatchTx(0),
+		nBoundedFlush(0),
+		nBoundedFlushInline(0),
+		nsUnsyncedMax(0),
+		bytesUnsyncedMax(0),
+		nEagerWriteback(0),
+		nEagerWritebackPages(0),
+		nEagerUnstampedPages(0),
+		nStreakTx(0),
+		bytesStreak(0),
+		nStreakOvflPages(0)
 	{ /* NOP */ }
 
 	void merge(const TPIOStat& o);
@@ -47,6 +115,203 @@ std::ostream& operator<<(std::ostream& s, const TPIOStat& o)
 
 class TPIO;
 
+//! coalesces durability syncs of concurrently committing txs
+/*!
+ *	The first committer to arrive becomes the leader of a batch.
+ *	The leader waits for the previous batch's flush to finish and for the window to pass
+ *	(or the batch to fill up), while later committers join its batch.
+ *	It then syncs page ranges of all txs in the batch w/ as few syncRange calls as possible
+ *	and wakes them up.
+ *
+ *	Even w/ zero window, committers arriving during a flush are synced together by the next one.
+ *
+ *	Async committers (syncAsync) join batches the same way, but don't wait.
+ *	A batch started by an async committer is led on the helper thr, if attached,
+ *	or by the first sync committer joining it, whichever comes first.
+ */
+class GroupCommit
+{
+public:
+	enum
+	{
+		WINDOW_US_DEFAULT = 0,
+		BATCH_MAX_DEFAULT = 64,
+
+		//! ranges separated by gap up to this num of pages are synced in one call
+		GAP_MAX = 8,
+	};
+
+	typedef std::vector<pair<page_id_t, page_id_t> > Vrange_t;
+
+	//! called when synced. _err_ is set if the sync failed
+	typedef std::function<void (std::exception_ptr err)> Callback;
+
+	GroupCommit(PageIO* backend, TPIOStat* stat);
+
+	//! flushes batches still open
+	~GroupCommit();
+
+	//! sync _ranges_ along w/ other txs in the same batch
+	/*!
+	 *	Returns after _ranges_ are durable.
+	 */
+	void sync(const Vrange_t& ranges);
+
+	//! sync _ranges_ along w/ other txs in the same batch, and call _cb_ when done
+	/*!
+	 *	Returns w/o waiting for the sync if helper thr is attached.
+	 *	_cb_ is called on the thr which flushed the batch (possibly before this returns).
+	 */
+	void syncAsync(const Vrange_t& ranges, Callback cb);
+
+	//! flush the open batch, if any, and wait for flush in progress
+	void drain();
+
+	void attachHelper(Helper* helper)
+	{
+		m_helper = helper;
+	}
+
+	void setParams(unsigned int windowUs, size_t batchMax);
+
+	unsigned int windowUs() const { return m_windowUs; }
+	size_t batchMax() const { return m_batchMax; }
+
+private:
+	struct Batch
+	{
+		Batch() : nTx(0), bLed(false), bDone(false) { /* NOP */ }
+
+		Vrange_t ranges;
+		size_t nTx;
+		bool bLed;
+		bool bDone;
+		std::exception_ptr err;
+
+		//! callbacks of async committers
+		std::vector<Callback> callbacks;
+	};
+
+	//! join the open batch, or start new one
+	/*!
+	 *	@return
+	 *		true if new batch was started (the caller has to get it led)
+	 *	@note m_mtx must be held
+	 */
+	bool join(const Vrange_t& ranges, shared_ptr<Batch>* batch);
+
+	//! wait for the batch to fill up, flush it and complete its txs
+	/*!
+	 *	If another thr is already leading _batch_, just wait for it to be done.
+	 */
+	void lead(const shared_ptr<Batch>& batch);
+
+	void flush(Vrange_t& ranges);
+
+	PageIO* m_backend;
+	TPIOStat* m_stat;
+	Helper* m_helper;
+
+	unsigned int m_windowUs;
+	size_t m_batchMax;
+
+	std::mutex m_mtx;
+	std::condition_variable m_cond;
+
+	//! batch accepting new txs
+	shared_ptr<Batch> m_batchOpen;
+
+	//! true while a leader is syncing its batch
+	bool m_bFlushing;
+};
+
+//! bounds the loss window of OBOUNDEDSYNC commits
+/*!
+ *	Commits return w/o waiting for sync. Page ranges of committed txs are accumulated,
+ *	and synced together before the oldest of them gets older than the interval
+ *	or their total size exceeds the byte limit.
+ *
+ *	A dedicated flusher thr, started on the first add, flushes the window at half of the bounds,
+ *	so the bound holds even if no more tx commits and committers usually don't wait.
+ *	A committer which finds the window at the bound (flusher thr still syncing the previous window)
+ *	flushes it by itself before returning.
+ */
+class BoundedSync
+{
+public:
+	enum
+	{
+		INTERVAL_MS_DEFAULT = 100,
+		BYTES_MAX_DEFAULT = 8 * 1024 * 1024,
+	};
+
+	BoundedSync(GroupCommit* groupcommit, TPIOStat* stat);
+
+	//! stops the flusher thr and flushes the window
+	~BoundedSync();
+
+	//! add _ranges_ of committed tx to the window. _cb_ (if any) is called once they are synced
+	void add(const GroupCommit::Vrange_t& ranges, GroupCommit::Callback cb);
+
+	//! flush the window now
+	void flush();
+
+	//! stop the flusher thr and wait for the flush in progress, if any
+	/*!
+	 *	Windows added afterwards are flushed only by flush() or at the bound.
+	 */
+	void stop();
+
+	void setBound(unsigned int intervalMs, size_t bytesMax);
+
+	unsigned int intervalMs() const { return m_intervalMs; }
+	size_t bytesMax() const { return m_bytesMax; }
+
+	//! committed but not yet synced txs
+	struct window_t
+	{
+		size_t nTx;
+		size_t bytes;
+		uint64_t nsAge; //!< time since the oldest tx in the window committed [ns]
+	};
+	window_t window();
+
+private:
+	typedef std::chrono::steady_clock clock_t;
+
+	uint64_t ageNs(clock_t::time_point now) const
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_tsOldest).count();
+	}
+
+	//! take the window and sync it
+	/*!
+	 *	@note m_mtx must be held by _g_. it is released while syncing
+	 */
+	void flushWindow(std::unique_lock<std::mutex>& g, bool bInline);
+
+	//! flusher thr main. flushes the window at half of the bounds
+	void thrmain();
+
+	GroupCommit* m_groupcommit;
+	TPIOStat* m_stat;
+
+	unsigned int m_intervalMs;
+	size_t m_bytesMax;
+
+	std::mutex m_mtx;
+	std::condition_variable m_cond;
+
+	GroupCommit::Vrange_t m_ranges;
+	std::vector<GroupCommit::Callback> m_callbacks;
+	size_t m_nTx;
+	size_t m_bytes;
+	clock_t::time_point m_tsOldest;
+
+	unique_ptr<std::thread> m_thr;
+	bool m_bStop;
+};
+
 class TPIOTxSession : public PageIO
 {
 public:
@@ -56,6 +321,9 @@ public:
 
 	bool tryCommit();
 
+	//! try committing the tx w/o waiting for its pages to be synced. see TPIO::tryCommit
+	bool tryCommitAsync(GroupCommit::Callback cbDurable);
+
 	const TPIOStat& stat() const
 	{
 		return m_stat;	
@@ -91,7 +359,7 @@ public:
 
 protected:
 	friend class TPIO; // give access to c-tor
-	TPIOTxSession(TPIO* tpio, shared_ptr<ActiveOvr> aovr, unique_ptr<LocalOvr> lovr);
+	TPIOTxSession(TPIO* tpio, ActiveOvr* aovr, unique_ptr<LocalOvr> lovr);
 
 	PageIO* backend() const;
 
@@ -105,45 +373,189 @@ protected:
 		m_lovr->addOvr(pgidOrig, pgidOvr);
 	}
 
-	void loadStreak(BufferCRef bufStreak);
+	//! restore streak data written by TPIO::commitTxPages
+	/*!
+	 *	@param bCompact true if the streak is in compact format (page_hdr_t::PF_STREAK_COMPACT)
+	 *	@param pagesEager if non-null, the tx pages written back before commit are read into (page_hdr_t::PF_STREAK_EAGER)
+	 */
+	void loadStreak(BufferCRef bufStreak, bool bCompact, Vpage_id_t* pagesEager = nullptr);
+
+	//! extend the run of tx pages by _pgid_, and start writeback of its older part
+	void trackWritebackRun(page_id_t pgid, size_t pgsRun);
 
 	struct OvrExtra : public LocalOvr::ExtraData
 	{
+		OvrExtra();
 		~OvrExtra();
 
 		PagesOldLink oldlink;
+
+		//! smallest pgid written to the log by the tx
+		page_id_t pgidFirst;
 	};
 
 private:
 	TPIO* m_tpio;
-	shared_ptr<ActiveOvr> m_aovr;
+
+	//! generation the tx runs on. kept alive as the tx is inside TPIO::m_epoch
+	ActiveOvr* m_aovr;
+
 	unique_ptr<LocalOvr> m_lovr;
 	PagesOldLink* m_oldlink;
 	Vpage_id_t m_pagesModified;
 	TPIOStat m_stat;
 
-	// for TPIO::TxPool
+	//! contiguous run of tx pages not yet written back (see TPIO::setEagerWriteback)
+	page_id_t m_pgidRunFirst, m_pgidRunLast;
+
+	//! ranges already written back. tx pages inside them are not stamped at commit
+	GroupCommit::Vrange_t m_rangesWb;
+
+	EpochManager::Record* m_epochrec;
+};
+inline
+std::ostream& operator<<(std::ostream& s, const TPIOTxSession& o)
+{ o.dump(s); return s; }
+
+//! read-only tx session
+/*!
+ *	Reads pages in a snapshot of committed txs, like TPIOTxSession does,
+ *	but skips all the bookkeeping needed for writes (LocalOvr, old links, modified pages, stat).
+ *	Any write to the session results in an exception.
+ */
+class TPIOSnapshot : public PageIO
+{
 public:
-	void embedRegIdx(size_t regtxidx)
+	~TPIOSnapshot();
+
+	unsigned int nRead() const
 	{
-		m_regtxidx = regtxidx;	
+		return m_nRead;	
 	}
 
-	size_t regIdx() const
+	unsigned int nChainWalk() const
+	{
+		return m_snap.nChainWalk();	
+	}
+
+	// ====== implements PageIO interface ======
+	pair<Page, page_id_t> newPage();
+
+	Page readPage(page_id_t page); 
+	Page modifyPage(const Page& page, mod_info_t* mod);
+	void discardPage(page_id_t pgid, mod_info_t* mod);
+
+	void sync(page_id_t pgid);
+
+	page_id_t getLastPgId() const;
+
+	// ====== start page accessor ======
+
+	page_id_t pgidStartPage() const
 	{
-		return m_regtxidx;	
+		return m_snap.pgidStartPage();	
 	}
 
 private:
-	size_t m_regtxidx;
+	friend class TPIO; // give access to c-tor
+	TPIOSnapshot(TPIO* tpio, ActiveOvr* aovr, ver_t verRead = TXID_INVALID);
+
+	TPIO* m_tpio;
+
+	//! ovr entries referred by m_snap are kept alive as the tx is inside TPIO::m_epoch
+	OvrSnapshot m_snap;
+	unsigned int m_nRead;
+
+	EpochManager::Record* m_epochrec;
 };
-inline
-std::ostream& operator<<(std::ostream& s, const TPIOTxSession& o)
-{ o.dump(s); return s; }
 
-constexpr unsigned int REBASE_THRESHOLD = TPIO_NHASH * 8;
+constexpr unsigned int REBASE_THRESHOLD = 1024;
+
+//! max default num thrs of rebase traversal (see TPIO::setRebaseThreads)
+constexpr unsigned int REBASE_THR_MAX = 8;
 constexpr size_t REFRESH_PGS_PER_TX_DEFAULT = 128;
 
+//! decides when to rebase
+/*!
+ *	Rebase folds ovr entries back into base pages.
+ *	Frequent rebases keep page reads cheap, as fewer reads go through ovr entries,
+ *	while infrequent rebases save the rebase work, which mostly matters for write-heavy workloads.
+ *
+ *	The num of ovrs which triggers rebase is adjusted each time rebase starts,
+ *	using the read amplification (global ovr entries examined per page read in searchOvr)
+ *	and the commit rate of the generation being rebased.
+ */
+class RebasePolicy
+{
+public:
+	enum
+	{
+		THRESHOLD_MIN = 128,
+		THRESHOLD_MAX = 64 * 1024,
+
+		//! min interval of rebases [ms]. Threshold is raised if ovrs piled up faster than this.
+		INTERVAL_MIN_MS = 50,
+
+		HISTORY_SIZE = 16,
+	};
+
+	//! threshold is lowered if read amplification goes beyond this
+	static constexpr double AMP_HIGH = 0.5;
+
+	//! threshold is raised if read amplification is below this
+	static constexpr double AMP_LOW = 0.1;
+
+	RebasePolicy(unsigned int threshold = REBASE_THRESHOLD);
+
+	void notifyTxEnd(unsigned int nRead, unsigned int nChainWalk)
+	{
+		__sync_fetch_and_add(&m_nRead, nRead);
+		__sync_fetch_and_add(&m_nChainWalk, nChainWalk);
+	}
+
+	void notifyCommit()
+	{
+		__sync_fetch_and_add(&m_nCommit, 1);
+	}
+
+	bool needRebase(unsigned int nOvr) const
+	{
+		return nOvr >= m_threshold;
+	}
+
+	unsigned int threshold() const
+	{
+		return m_threshold;	
+	}
+
+	//! update threshold from the stats collected since last call
+	/*!
+	 *	@return
+	 *		+1 if threshold was raised, -1 if lowered, 0 if unchanged
+	 *	@note not thread-safe. called from rebase
+	 */
+	int adapt();
+
+	void dump(std::ostream& s) const;
+
+private:
+	volatile unsigned int m_threshold;
+
+	volatile uint64_t m_nRead;
+	volatile uint64_t m_nChainWalk;
+	volatile uint64_t m_nCommit;
+	HighResTimeStamp m_tsLastAdapt;
+
+	struct sample_t
+	{
+		unsigned int threshold; //!< threshold chosen
+		double amp; //!< read amplification of the generation
+		double commitRate; //!< commits per sec of the generation
+	};
+	sample_t m_history[HISTORY_SIZE];
+	size_t m_nAdapt;
+};
+
 class TPIO
 {
 public:
@@ -155,12 +567,144 @@ public:
 
 	unique_ptr<TPIOTxSession> newTransaction();
 
-	bool tryCommit(TPIOTxSession* tx, commit_flags_t flags = COMMIT_DEFAULT);
+	//! start read-only tx
+	unique_ptr<TPIOSnapshot> newSnapshot();
+
+	//! start read-only tx on the same snapshot as _tx_
+	/*!
+	 *	@note _tx_ must be alive while the returned obj is used
+	 */
+	unique_ptr<TPIOSnapshot> newSnapshot(TPIOTxSession* tx);
+
+	//! try committing _tx_
+	/*!
+	 *	@param [in] cbDurable
+	 *		If specified, returns w/o waiting for the tx pages to be synced, and _cbDurable_ is called once they are.
+	 *		Called only if the commit succeeded.
+	 */
+	bool tryCommit(TPIOTxSession* tx, commit_flags_t flags = COMMIT_DEFAULT, GroupCommit::Callback cbDurable = nullptr);
 
 	void rebase(bool force);
+
+	//! check if rebase(false) would be done
+	bool needRebase() const
+	{
+		return !m_bDuringRebase && m_policy.needRebase(m_stat.nOvr);
+	}
+
+	//! notify end of user tx _tx_ to collect read stats
+	void notifyTxEnd(TPIOTxSession* tx);
+	void notifyTxEnd(TPIOSnapshot* ss);
+
+	//! true if rebase has been done after _tx_ started
+	bool isRebasedSince(TPIOTxSession* tx) const
+	{
+		return tx->m_aovr != aovr();
+	}
+
+	//! notify result of key level conflict resolution of a tx which failed to commit
+	void notifyConflict(bool resolved)
+	{
+		__sync_fetch_and_add(resolved ? &m_stat.nConflictResolved : &m_stat.nConflictKey, 1);
+	}
+
 	void refreshOldPages(page_id_t threshold, size_t pgsPerTx = REFRESH_PGS_PER_TX_DEFAULT);
+
+	//! tune group commit of OAUTOSYNC syncs
+	/*!
+	 *	@param [in] windowUs
+	 *		max time [us] a batch waits for more txs to join
+	 *	@param [in] batchMax
+	 *		batch is flushed w/o waiting for the window when this num of txs joined
+	 */
+	void setGroupCommit(unsigned int windowUs, size_t batchMax)
+	{
+		m_groupcommit.setParams(windowUs, batchMax);
+	}
+
+	//! start writeback of tx pages before commit
+	/*!
+	 *	When a tx has written more than _pgsRun_ contiguous pages, writeback of the older ones is started w/o waiting,
+	 *	so that commit of large tx only waits for the remaining tail.
+	 *	The most recent _pgsRun_ pages are left, as they are likely to be modified again by the tx.
+	 *
+	 *	@param [in] pgsRun
+	 *		0 disables eager writeback (default)
+	 */
+	void setEagerWriteback(size_t pgsRun)
+	{
+		m_eagerWbPages = pgsRun;
+	}
+
+	size_t eagerWritebackPages() const
+	{
+		return m_sync ? m_eagerWbPages : 0;
+	}
+
+	//! set num thrs rebase traverses the snapshot with
+	/*!
+	 *	Subtrees w/ old links below the start page are rebased in parallel, then joined into the rebase tx.
+	 *
+	 *	@param [in] nthr
+	 *		1 rebases on the calling thr only. defaults to num cores (up to REBASE_THR_MAX)
+	 */
+	void setRebaseThreads(unsigned int nthr)
+	{
+		m_rebaseThrs = std::max(nthr, 1U);
+	}
+
+	unsigned int rebaseThreads() const
+	{
+		return m_rebaseThrs;
+	}
+
+	//! tune loss bound of OBOUNDEDSYNC commits
+	/*!
+	 *	@param [in] intervalMs
+	 *		committed txs are synced within this time [ms]
+	 *	@param [in] bytesMax
+	 *		committed txs are synced before their pages exceed this size [bytes]
+	 */
+	void setSyncBound(unsigned int intervalMs, size_t bytesMax)
+	{
+		m_boundedsync.setBound(intervalMs, bytesMax);
+	}
+
+	//! current window of committed but unsynced txs in OBOUNDEDSYNC mode
+	BoundedSync::window_t unsyncedWindow()
+	{
+		return m_boundedsync.window();
+	}
+
+	//! run _cb_ after all txs started before this call are done
+	/*!
+	 *	_cb_ is run asynchronously (on the helper thr, if attached)
+	 */
+	void retire(EpochManager::Callback cb)
+	{
+		m_epoch.retire(std::move(cb));
+	}
+
+	//! wait for all txs started before this call to be done
 	void join();
 
+	//! write checkpoint of the ovr table to the log
+	/*!
+	 *	restoreState loads the checkpoint instead of replaying the log written before it.
+	 *	Async commits are synced before the checkpoint is written.
+	 *	No-op if no tx has committed since the last checkpoint, rebase, or restore.
+	 *
+	 *	@note no tx / rebase may run concurrently. (called on close)
+	 */
+	void checkpoint();
+
+	//! run retire callbacks on _helper_
+	void attachHelper(Helper* helper)
+	{
+		m_epoch.attachHelper(helper);
+		m_groupcommit.attachHelper(helper);
+	}
+
 	PageIO* backend()
 	{
 		return m_backend.get();	
@@ -175,46 +719,142 @@ private:
 	class RebaseTPIOTxSession : public TPIOTxSession
 	{
 	public:
-		RebaseTPIOTxSession(TPIO* tpio, shared_ptr<ActiveOvr> aovr, unique_ptr<LocalOvr> lovr, PagesOldLink* oldlink);
+		//! start rebase of snapshot _lovr_
+		RebaseTPIOTxSession(TPIO* tpio, ActiveOvr* aovr, unique_ptr<LocalOvr> lovr);
 		~RebaseTPIOTxSession();
 
 		page_id_t updateLink(page_id_t idOld);
 		page_id_t rebaseForceVisit(page_id_t pgid);
 
+		//! visit pages w/ old links from the start page
+		void visitAll();
+
+		//! check if _lovr_, committed after the snapshot, can be replayed on top of the rebased pages
+		bool canCarryOver(const LocalOvr* lovr) const;
+
+		//! get id of the page in the rebased generation which corresponds to _pgid_ in the snapshot
+		page_id_t rebasedId(page_id_t pgid) const;
+
+		//! num pages w/ old links in the snapshot
+		size_t numOldLink() const
+		{
+			return m_oldlinkRebase.size();
+		}
+
 	private:
+		class Worker;
+		class LinkCollector;
+
 		page_id_t rebaseVisit(page_id_t pgid);
 
-		Spage_id_t m_visited;
-		const PagesOldLink* m_oldlinkRebase;
+		//! rewrite links of _pgid_ through _pio_ (this tx or a Worker)
+		page_id_t doVisit(page_id_t pgid, PageIO* pio);
+
+		//! mark page at _idx_ of m_oldlinkRebase visited. false if it already was
+		bool claimVisit(size_t idx)
+		{
+			return PTNK_CAS(&m_visited[idx], 0, 1);
+		}
+
+		//! visit independent subtrees below the start page on _nthr_ thrs
+		void visitParallel(size_t nthr);
+
+		//! visited flags of pages in m_oldlinkRebase, indexed by PagesOldLink::indexOf
+		std::vector<char> m_visited;
+
+		//! pages w/ old links in the snapshot
+		PagesOldLink m_oldlinkRebase;
+
+		//! orig pgids of links which were updated to ovr pages of the snapshot
+		Spage_id_t m_resolved;
+
+		page_id_t m_pgidStartSnapshot;
+
+		//! last pgid allocated when the snapshot was taken
+		page_id_t m_pgidLastSnapshot;
 	};
 
-	void syncDelayed(const Vpage_id_t& pagesModified);
-	void commitTxPages(TPIOTxSession* tx, ver_t verW, bool isRebase);
+	//! wait while rebase is handing over to new generation
+	void waitHandover();
+
+	//! get current generation
+	/*!
+	 *	@note caller must be inside m_epoch, until it is done w/ the returned obj
+	 */
+	ActiveOvr* aovr() const
+	{
+		PTNK_MEMBARRIER_COMPILER;
+		return m_aovr;
+	}
+
+	//! publish _aovrNew_ as current generation and retire the old one
+	void publishAOvr(ActiveOvr* aovrNew);
+
+	//! replay txs committed to _aovrOld_ after _tx_'s snapshot on _aovrNew_
+	/*!
+	 *	@return
+	 *		false if any of the txs can't be carried over. _aovrNew_ is left untouched in the case.
+	 */
+	bool carryOver(ActiveOvr* aovrOld, ActiveOvr* aovrNew, RebaseTPIOTxSession* tx);
+
+	void syncDelayed(const Vpage_id_t& pagesModified, GroupCommit::Callback cbDurable = nullptr);
+	void commitTxPages(TPIOTxSession* tx, ver_t verW, bool isRebase, GroupCommit::Callback cbDurable = nullptr);
 
 	void restoreState();
 
+	//! load checkpoint ending at _pgidEnd_ into _ckpt_
+	/*!
+	 *	@return
+	 *		false if the checkpoint is broken
+	 */
+	struct checkpoint_t;
+	bool loadCheckpoint(page_id_t pgidEnd, checkpoint_t* ckpt);
+
 	shared_ptr<PageIO> m_backend;
 	bool m_sync;
 
-	std::mutex m_mtxAOvr;
-	shared_ptr<ActiveOvr> m_aovr;
+	//! true if OBOUNDEDSYNC
+	bool m_bBounded;
+
+	//! see setEagerWriteback
+	size_t m_eagerWbPages;
+
+	//! see setRebaseThreads
+	unsigned int m_rebaseThrs;
+
+	//! ver of latest tx reflected in the log checkpoint, rebase tx, or restored state
+	ver_t m_verCheckpoint;
 
+	//! outlives m_groupcommit / m_boundedsync, which update it
 	TPIOStat m_stat;
 
-	//! true if rebase is being done (further tx are cancelled)
+	GroupCommit m_groupcommit;
+	BoundedSync m_boundedsync;
+
+	//! current generation (RCU-style: replaced by publishAOvr, old one is reclaimed by m_epoch)
+	ActiveOvr* volatile m_aovr;
+
+	RebasePolicy m_policy;
+
+	//! true if rebase is being done
 	bool m_bDuringRebase;
 
+	//! true if rebase is handing over to the new generation (new txs are held)
+	bool m_bDuringHandover;
+
 	//! true if refresh is being done
 	bool m_bDuringRefresh;
 
 	std::mutex m_mtxRebase;
 	std::condition_variable m_condRebase;
 
-	class TxPool;
-	unique_ptr<TxPool> m_txpool;
+	//! tracks active txs for reclaiming pages / ActiveOvr generations
+	EpochManager m_epoch;
 public:
 	void registerTx(TPIOTxSession* tx);
 	void unregisterTx(TPIOTxSession* tx);
+	void registerTx(TPIOSnapshot* ss);
+	void unregisterTx(TPIOSnapshot* ss);
 };
 inline
 std::ostream& operator<<(std::ostream& s, const TPIO& o)
@@ -227,6 +867,13 @@ TPIOTxSession::tryCommit()
 	return m_tpio->tryCommit(this);	
 }
 
+inline
+bool
+TPIOTxSession::tryCommitAsync(GroupCommit::Callback cbDurable)
+{
+	return m_tpio->tryCommit(this, COMMIT_DEFAULT, move(cbDurable));
+}
+
 inline
 PageIO*
 TPIOTxSession::backend() const
@@ -82,6 +82,14 @@ enum
 	 */
 	P_(OHELPERTHREAD) = 1 << 5,
 
+	/*! commits return w/o sync, and committed txs are synced in background within a bound */
+	/*!
+	 *	Txs committed in the last 100ms / 8MB (by default) may be lost on crash,
+	 *	but db is kept consistent. Takes precedence over OAUTOSYNC.
+	 *	@sa DB::setSyncBound
+	 */
+	P_(OBOUNDEDSYNC) = 1 << 6,
+
 	P_(ODEFAULT) = P_(OWRITER) | P_(OCREATE) | P_(OAUTOSYNC) | P_(OPARTITIONED) | P_(OHELPERTHREAD),
 };
 
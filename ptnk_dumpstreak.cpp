@@ -11,6 +11,7 @@ int main(int argc, char* argv[])
 
 		tx_id_t txid = atoi(argv[2]);
 		Buffer bufStreakReal; bufStreakReal.reset();
+		bool bCompact = false;
 
 		page_id_t pgidE = pio.getLastPgId();
 		for(page_id_t pgid = 0; pgid <= pgidE; ++ pgid)
@@ -18,6 +19,7 @@ int main(int argc, char* argv[])
 			Page pg(pio.readPage(pgid));
 			if(pg.isCommitted() && pg.hdr()->txid == txid)
 			{
+				bCompact = pg.hdr()->flags & page_hdr_t::PF_STREAK_COMPACT;
 				if(pg.pageType() != PT_OVFLSTREAK)
 				{
 					BufferCRef pgstreak(pg.streak(), Page::STREAK_SIZE);
@@ -33,14 +35,35 @@ int main(int argc, char* argv[])
 		}
 
 		BufferCRef bufStreak = bufStreakReal.rref();
-		size_t count = *(size_t*)bufStreak.popFront(sizeof(size_t));
+		std::cout << "streak bytes " << bufStreak.size() << (bCompact ? " (compact)" : "") << std::endl;
+		if(bufStreak.empty()) return 0;
+
+		uint64_t nUniquePages;
+		if(bCompact)
+		{
+			nUniquePages = bufStreak.popFrontVarint();
+		}
+		else
+		{
+			bufStreak.popFrontTo(&nUniquePages, sizeof(uint64_t));
+		}
+		std::cout << "unique pages " << nUniquePages << std::endl;
+
+		size_t count = bCompact ? bufStreak.popFrontVarint() : *(size_t*)bufStreak.popFront(sizeof(size_t));
 		// std::cout << "buf streak " << bufStreak.rref().hexdump() << std::endl;
 		std::cout << "streak pol count " << count << std::endl;
 
+		page_id_t pgid = 0;
 		for(size_t i = 0; i < count; ++ i)
 		{
-			page_id_t pgid;
-			bufStreak.popFrontTo(&pgid, sizeof(page_id_t));
+			if(bCompact)
+			{
+				pgid += bufStreak.popFrontVarint();
+			}
+			else
+			{
+				bufStreak.popFrontTo(&pgid, sizeof(page_id_t));
+			}
 			std::cout << "pgid: " << pgid2str(pgid) << std::endl;
 		}
 	}
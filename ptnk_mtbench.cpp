@@ -1,8 +1,15 @@
 #include "bench_tmpl.h"
 #include "ptnk/sysutils.h"
+#include "ptnk/stm.h"
+#include "ptnk/tpio.h"
+#include "ptnk/btree.h"
+#include "ptnk/pageiomem.h"
+#include "ptnk/overview.h"
 #include "ptnk.h"
 
 #include <thread>
+#include <algorithm>
+#include <sys/stat.h>
 
 using namespace ptnk;
 
@@ -58,6 +65,789 @@ struct put_ary_db
 	}
 };
 
+struct validate_ary
+{
+	ActiveOvr& aovr;
+	const int* ary;
+	size_t count;
+	unsigned long* elapsed;
+
+	validate_ary(ActiveOvr& aovr_, const int* ary_, size_t count_, unsigned long* elapsed_)
+	:	aovr(aovr_), ary(ary_), count(count_), elapsed(elapsed_)
+	{ /* NOP */ }
+
+	void operator()()
+	{
+		HighResTimeStamp tsBefore, tsAfter;
+		for(size_t i = 0; i + NUM_W_PER_TX <= count; i += NUM_W_PER_TX)
+		{
+			unique_ptr<LocalOvr> lovr(aovr.newTx());
+			for(int j = 0; j < NUM_W_PER_TX; ++ j)
+			{
+				page_id_t pgid = ary[i+j];
+				lovr->addOvr(pgid, pgid + NUM_KEYS);
+			}
+
+			tsBefore.reset();
+			aovr.tryCommit(lovr);
+			tsAfter.reset();
+			*elapsed += tsAfter.elapsed_ns(tsBefore);
+		}
+	}
+};
+
+//! measure ActiveOvr::tryCommit validation time per commit
+void
+run_bench_validation(bool useBloomFilter)
+{
+	PgidBloomFilter::s_bypass = !useBloomFilter;
+
+	const int NUM_KEYS_PER_TH = NUM_KEYS / NUM_THREADS;
+	std::vector<unsigned long> elapsed(NUM_THREADS, 0);
+	uint64_t nCheck, nCheckBf;
+	{
+		ActiveOvr aovr;
+
+		typedef unique_ptr<std::thread> Pthread;
+		std::vector<Pthread> tg;
+		for(int i = 0; i < NUM_THREADS; ++ i)
+		{
+			tg.push_back(Pthread(new std::thread(validate_ary(aovr, &keys[NUM_KEYS_PER_TH * i], NUM_KEYS_PER_TH, &elapsed[i]))));
+		}
+		for(auto& t: tg) t->join();
+
+		nCheck = aovr.nConflictCheck();
+		nCheckBf = aovr.nConflictCheckBf();
+	}
+
+	unsigned long total = 0;
+	for(unsigned long e: elapsed) total += e;
+	const int numCommits = NUM_THREADS * (NUM_KEYS_PER_TH / NUM_W_PER_TX);
+
+	std::cout << "# validation (bloom filter " << (useBloomFilter ? "on" : "off") << "): "
+		<< (numCommits > 0 ? total / numCommits : 0) << " ns/commit (" << numCommits << " commits w/ " << NUM_W_PER_TX << " ovrs)" << std::endl;
+	if(useBloomFilter)
+	{
+		std::cout << "# validation: filter-vs-filter test settled " << nCheckBf << " of " << nCheck << " conflict checks" << std::endl;
+	}
+
+	PgidBloomFilter::s_bypass = false;
+}
+
+//! measure ActiveOvr::tryCommit throughput w/ 1 - 64 committer thrs
+void
+run_bench_merge_scaling()
+{
+	for(int numthr = 1; numthr <= 64; numthr *= 2)
+	{
+		const int NUM_KEYS_PER_TH = NUM_KEYS / numthr;
+		std::vector<unsigned long> elapsed(numthr, 0);
+
+		HighResTimeStamp tsBefore, tsAfter;
+		tsBefore.reset();
+		{
+			ActiveOvr aovr;
+
+			typedef unique_ptr<std::thread> Pthread;
+			std::vector<Pthread> tg;
+			for(int i = 0; i < numthr; ++ i)
+			{
+				tg.push_back(Pthread(new std::thread(validate_ary(aovr, &keys[NUM_KEYS_PER_TH * i], NUM_KEYS_PER_TH, &elapsed[i]))));
+			}
+			for(auto& t: tg) t->join();
+		}
+		tsAfter.reset();
+
+		unsigned long total = 0;
+		for(unsigned long e: elapsed) total += e;
+		const int numCommits = numthr * (NUM_KEYS_PER_TH / NUM_W_PER_TX);
+		const unsigned long wall = tsAfter.elapsed_ns(tsBefore);
+
+		std::cout << "# commit scaling: " << numthr << " thrs: "
+			<< (wall > 0 ? (unsigned long)numCommits * NSEC_PER_SEC / wall : 0) << " commits/s, "
+			<< (numCommits > 0 ? total / numCommits : 0) << " ns/commit" << std::endl;
+	}
+}
+
+//! measure begin + get + end cost of a point read in DB::Snapshot and in DB::Tx
+void
+run_bench_point_read(DB& db)
+{
+	const int NUM_READS = NUM_KEYS;
+	Buffer v;
+
+	HighResTimeStamp tsBefore, tsAfter;
+	tsBefore.reset();
+	for(int i = 0; i < NUM_READS; ++ i)
+	{
+		unique_ptr<DB::Tx> tx(db.newTransaction());
+		tx->get(BufferCRef(&keys[i], 4), &v);
+	}
+	tsAfter.reset();
+	const unsigned long nsTx = tsAfter.elapsed_ns(tsBefore);
+
+	tsBefore.reset();
+	for(int i = 0; i < NUM_READS; ++ i)
+	{
+		unique_ptr<DB::Snapshot> ss(db.newSnapshot());
+		ss->get(BufferCRef(&keys[i], 4), &v);
+	}
+	tsAfter.reset();
+	const unsigned long nsSnapshot = tsAfter.elapsed_ns(tsBefore);
+
+	std::cout << "# point read (begin + get + end): Tx " << nsTx / NUM_READS << " ns, Snapshot " << nsSnapshot / NUM_READS << " ns" << std::endl;
+}
+
+//! measure tx begin + end throughput w/ 1 - 64 thrs
+void
+run_bench_begin_scaling(DB& db)
+{
+	const int NUM_BEGINS = 100000;
+
+	for(int numthr = 1; numthr <= 64; numthr *= 2)
+	{
+		const int NUM_BEGINS_PER_TH = NUM_BEGINS / numthr;
+
+		HighResTimeStamp tsBefore, tsAfter;
+		tsBefore.reset();
+		{
+			typedef unique_ptr<std::thread> Pthread;
+			std::vector<Pthread> tg;
+			for(int i = 0; i < numthr; ++ i)
+			{
+				tg.push_back(Pthread(new std::thread([&db, NUM_BEGINS_PER_TH] () {
+					for(int j = 0; j < NUM_BEGINS_PER_TH; ++ j)
+					{
+						unique_ptr<DB::Tx> tx(db.newTransaction());
+					}
+				})));
+			}
+			for(auto& t: tg) t->join();
+		}
+		tsAfter.reset();
+
+		const unsigned long numBegins = (unsigned long)numthr * NUM_BEGINS_PER_TH;
+		const unsigned long wall = tsAfter.elapsed_ns(tsBefore);
+		std::cout << "# begin tx scaling: " << numthr << " thrs: "
+			<< (wall > 0 ? numBegins * NSEC_PER_SEC / wall : 0) << " begins/s" << std::endl;
+	}
+}
+
+//! measure commit latency / throughput of OAUTOSYNC txs w/ various group commit windows
+void
+run_bench_group_commit()
+{
+	const int NUM_COMMITS = 20000;
+	const int NUM_THRS = 16;
+	const int NUM_COMMITS_PER_TH = NUM_COMMITS / NUM_THRS;
+	// batchMax 1 disables grouping (each tx syncs by itself)
+	const pair<unsigned int, size_t> params[] = {
+		make_pair(0, 1),
+		make_pair(0, GroupCommit::BATCH_MAX_DEFAULT),
+		make_pair(50, GroupCommit::BATCH_MAX_DEFAULT),
+		make_pair(200, GroupCommit::BATCH_MAX_DEFAULT),
+		make_pair(1000, GroupCommit::BATCH_MAX_DEFAULT),
+	};
+
+	for(const auto& param: params)
+	{
+		const unsigned int windowUs = param.first;
+		const size_t batchMax = param.second;
+
+		DB db(dbfile, OWRITER | OCREATE | OTRUNCATE | OPARTITIONED | OAUTOSYNC);
+		db.setGroupCommit(windowUs, batchMax);
+
+		volatile uint64_t nsCommitTotal = 0;
+
+		HighResTimeStamp tsBefore, tsAfter;
+		tsBefore.reset();
+		{
+			typedef unique_ptr<std::thread> Pthread;
+			std::vector<Pthread> tg;
+			for(int i = 0; i < NUM_THRS; ++ i)
+			{
+				tg.push_back(Pthread(new std::thread([&db, &nsCommitTotal, i, NUM_COMMITS_PER_TH] () {
+					for(int j = 0; j < NUM_COMMITS_PER_TH; ++ j)
+					{
+						int k = i * NUM_COMMITS_PER_TH + j;
+						for(;;)
+						{
+							unique_ptr<DB::Tx> tx(db.newTransaction());
+							tx->put(BufferCRef(&k, 4), BufferCRef(&k, 4));
+
+							HighResTimeStamp tsC; tsC.reset();
+							bool bCommitted = tx->tryCommit();
+							HighResTimeStamp tsCEnd; tsCEnd.reset();
+							__sync_fetch_and_add(&nsCommitTotal, tsCEnd.elapsed_ns(tsC));
+
+							if(bCommitted) break;
+						}
+					}
+				})));
+			}
+			for(auto& t: tg) t->join();
+		}
+		tsAfter.reset();
+
+		const unsigned long numCommits = (unsigned long)NUM_THRS * NUM_COMMITS_PER_TH;
+		const unsigned long wall = tsAfter.elapsed_ns(tsBefore);
+		const TPIOStat& st = db.tpio_()->stat();
+		std::cout << "# group commit: window " << windowUs << " us, batch max " << batchMax << ": "
+			<< (wall > 0 ? numCommits * NSEC_PER_SEC / wall : 0) << " commits/s, "
+			<< nsCommitTotal / numCommits / 1000 << " us/commit, "
+			<< (st.nSyncBatch > 0 ? (double)st.nSyncBatchTx / st.nSyncBatch : 0) << " txs/sync" << std::endl;
+	}
+}
+
+//! compare commit latency of tryCommit and tryCommitAsync w/ OAUTOSYNC
+void
+run_bench_commit_async()
+{
+	const int NUM_COMMITS = 5000;
+
+	for(int async = 0; async <= 1; ++ async)
+	{
+		DB db(dbfile, OWRITER | OCREATE | OTRUNCATE | OPARTITIONED | OAUTOSYNC | OHELPERTHREAD);
+
+		std::vector<std::shared_future<void> > durables;
+		durables.reserve(NUM_COMMITS);
+
+		HighResTimeStamp tsBefore, tsCommitted, tsDurable;
+		tsBefore.reset();
+		for(int k = 0; k < NUM_COMMITS; ++ k)
+		{
+			for(;;)
+			{
+				unique_ptr<DB::Tx> tx(db.newTransaction());
+				tx->put(BufferCRef(&k, 4), BufferCRef(&k, 4));
+
+				// txs may fail over rebase done on helper thr
+				if(async)
+				{
+					std::shared_future<void> durable;
+					if(! tx->tryCommitAsync(&durable)) continue;
+					durables.push_back(durable);
+				}
+				else
+				{
+					if(! tx->tryCommit()) continue;
+				}
+				break;
+			}
+		}
+		tsCommitted.reset();
+		for(auto& durable: durables) durable.get();
+		tsDurable.reset();
+
+		std::cout << "# commit " << (async ? "async" : "sync") << ": "
+			<< tsCommitted.elapsed_ns(tsBefore) / NUM_COMMITS / 1000 << " us/commit returned, "
+			<< tsDurable.elapsed_ns(tsBefore) / 1000 << " us until all durable" << std::endl;
+	}
+}
+
+//! measure commit latency of large OAUTOSYNC tx w/ and w/o eager writeback
+void
+run_bench_eager_writeback()
+{
+	const int NUM_PUTS = 50000;
+	const size_t pgsRuns[] = {0, 16, 64};
+
+	char value[200]; ::memset(value, 'v', sizeof(value));
+	for(size_t pgsRun: pgsRuns)
+	{
+		DB db(dbfile, OWRITER | OCREATE | OTRUNCATE | OPARTITIONED | OAUTOSYNC);
+		db.setEagerWriteback(pgsRun);
+
+		HighResTimeStamp tsBefore, tsCommit, tsAfter;
+		tsBefore.reset();
+		{
+			unique_ptr<DB::Tx> tx(db.newTransaction());
+			for(int k = 0; k < NUM_PUTS; ++ k)
+			{
+				tx->put(BufferCRef(&k, 4), BufferCRef(value, sizeof(value)));
+			}
+
+			tsCommit.reset();
+			if(! tx->tryCommit())
+			{
+				std::cout << "# eager writeback: commit failed" << std::endl;
+			}
+		}
+		tsAfter.reset();
+
+		const TPIOStat& st = db.tpio_()->stat();
+		std::cout << "# eager writeback: run " << pgsRun << " pages: "
+			<< tsAfter.elapsed_ns(tsCommit) / 1000 << " us commit, "
+			<< tsAfter.elapsed_ns(tsBefore) / 1000 << " us total, "
+			<< st.nEagerWritebackPages << " pages written back before commit, "
+			<< st.nEagerUnstampedPages << " of them left clean by commit" << std::endl;
+	}
+}
+
+//! compare commit throughput of OAUTOSYNC, OBOUNDEDSYNC and no sync txs
+void
+run_bench_bounded_sync()
+{
+	const int NUM_COMMITS = 5000;
+	const pair<const char*, ptnk_opts_t> modes[] = {
+		make_pair("autosync", (ptnk_opts_t)OAUTOSYNC),
+		make_pair("bounded", (ptnk_opts_t)OBOUNDEDSYNC),
+		make_pair("nosync", (ptnk_opts_t)0),
+	};
+
+	for(const auto& mode: modes)
+	{
+		DB db(dbfile, OWRITER | OCREATE | OTRUNCATE | OPARTITIONED | OHELPERTHREAD | mode.second);
+
+		size_t bytesUnsyncedMax = 0;
+		HighResTimeStamp tsBefore, tsAfter;
+		tsBefore.reset();
+		for(int k = 0; k < NUM_COMMITS; ++ k)
+		{
+			for(;;)
+			{
+				unique_ptr<DB::Tx> tx(db.newTransaction());
+				tx->put(BufferCRef(&k, 4), BufferCRef(&k, 4));
+
+				// txs may fail over rebase done on helper thr
+				if(tx->tryCommit()) break;
+			}
+			bytesUnsyncedMax = std::max(bytesUnsyncedMax, db.tpio_()->unsyncedWindow().bytes);
+		}
+		tsAfter.reset();
+
+		const unsigned long wall = tsAfter.elapsed_ns(tsBefore);
+		const TPIOStat& st = db.tpio_()->stat();
+		std::cout << "# commit " << mode.first << ": "
+			<< (wall > 0 ? (unsigned long)NUM_COMMITS * NSEC_PER_SEC / wall : 0) << " commits/s, "
+			<< st.nBoundedFlush << " bounded flushes (inline: " << st.nBoundedFlushInline << "), "
+			<< "max unsynced window: " << st.nsUnsyncedMax / 1000 << " us, " << bytesUnsyncedMax << " bytes" << std::endl;
+	}
+}
+
+//! measure reopen time w/ and w/o ovr checkpoint written on close
+void
+run_bench_startup()
+{
+	const int numTxs[] = {1000, 10000, 50000};
+
+	for(int numTx: numTxs)
+	{
+		for(bool bCheckpoint: {false, true})
+		{
+			{
+				DB db(dbfile, OWRITER | OCREATE | OTRUNCATE | OPARTITIONED);
+				for(int k = 0; k < numTx; ++ k)
+				{
+					db.put_k32u(k, BufferCRef(&k, 4));
+				}
+				db.setCheckpointOnClose(bCheckpoint);
+			}
+
+			HighResTimeStamp tsBefore, tsAfter;
+			tsBefore.reset();
+			{
+				DB db(dbfile, OWRITER | OPARTITIONED);
+				tsAfter.reset();
+				db.setCheckpointOnClose(false);
+			}
+
+			std::cout << "# startup " << numTx << " txs " << (bCheckpoint ? "w/" : "w/o") << " checkpoint: "
+				<< tsAfter.elapsed_ns(tsBefore) / 1000 << " us" << std::endl;
+		}
+	}
+}
+
+//! measure time to restore state from the log (no checkpoint) after large txs
+void
+run_bench_recovery()
+{
+	const int NUM_PUTS_PER_TX = 20000;
+	const int numTxs[] = {4, 16, 64};
+
+	char value[400]; ::memset(value, 'v', sizeof(value));
+	for(int numTx: numTxs)
+	{
+		{
+			DB db(dbfile, OWRITER | OCREATE | OTRUNCATE | OPARTITIONED);
+			int k = 0;
+			for(int i = 0; i < numTx; ++ i)
+			{
+				unique_ptr<DB::Tx> tx(db.newTransaction());
+				for(int j = 0; j < NUM_PUTS_PER_TX; ++ j, ++ k)
+				{
+					tx->put_k32u(k, BufferCRef(value, sizeof(value)));
+				}
+				tx->tryCommit();
+			}
+			db.setCheckpointOnClose(false);
+
+			const TPIOStat& st = db.tpio_()->stat();
+			std::cout << "# streak " << numTx << " txs: " << (st.nStreakTx ? st.bytesStreak / st.nStreakTx : 0) << " bytes/tx, "
+				<< st.nStreakOvflPages << " ovfl pages" << std::endl;
+		}
+
+		HighResTimeStamp tsBefore, tsAfter;
+		tsBefore.reset();
+		{
+			DB db(dbfile, OWRITER | OPARTITIONED);
+			tsAfter.reset();
+			db.setCheckpointOnClose(false);
+		}
+
+		std::cout << "# recovery " << numTx << " txs x " << NUM_PUTS_PER_TX << " puts: "
+			<< tsAfter.elapsed_ns(tsBefore) / 1000 << " us" << std::endl;
+	}
+}
+
+//! measure rebase bookkeeping of pages w/ old links
+void
+run_bench_rebase()
+{
+	// 1. PagesOldLink ops done by rebase on large sets: merging per-tx sets, then probing w/ visit tracking
+	{
+		const int NUM_TXS_POL = 2000, NUM_PGS_PER_TX = 32, NUM_PROBES = 1000000;
+		const page_id_t PGID_RANGE = 4000000;
+
+		std::vector<PagesOldLink> pols(NUM_TXS_POL);
+		for(auto& pol: pols)
+		{
+			for(int i = 0; i < NUM_PGS_PER_TX; ++ i) pol.add(rand() % PGID_RANGE);
+		}
+		std::vector<const PagesOldLink*> polptrs;
+		for(const auto& pol: pols) polptrs.push_back(&pol);
+
+		HighResTimeStamp tsBegin, tsMerged, tsEnd;
+		tsBegin.reset();
+		PagesOldLink merged;
+		merged.merge(polptrs);
+		tsMerged.reset();
+
+		std::vector<bool> visited(merged.size(), false);
+		int nVisit = 0;
+		for(int i = 0; i < NUM_PROBES; ++ i)
+		{
+			const size_t idx = merged.indexOf(rand() % PGID_RANGE);
+			if(idx == PagesOldLink::NPOS || visited[idx]) continue;
+
+			visited[idx] = true;
+			++ nVisit;
+		}
+		tsEnd.reset();
+
+		std::cout << "# rebase pol: " << merged.size() << " pgs merge " << tsMerged.elapsed_ns(tsBegin) / 1000 << " us, "
+			<< NUM_PROBES << " probes " << tsEnd.elapsed_ns(tsMerged) / 1000 << " us (" << nVisit << " visits)" << std::endl;
+	}
+
+	// 2. rebases triggered by small txs of scattered updates
+	{
+		const int NUM_KEYS_REBASE = 1000000, NUM_TXS_REBASE = 100000, NUM_PUTS_PER_TX = 4;
+
+		char value[100]; ::memset(value, 'v', sizeof(value));
+		DB db(dbfile, OWRITER | OCREATE | OTRUNCATE | OPARTITIONED);
+		{
+			unique_ptr<DB::Tx> tx(db.newTransaction());
+			for(int k = 0; k < NUM_KEYS_REBASE; ++ k)
+			{
+				tx->put_k32u(k, BufferCRef(value, sizeof(value)));
+			}
+			tx->tryCommit();
+		}
+		db.rebase(true);
+
+		const TPIOStat stBefore = db.tpio_()->stat();
+		for(int i = 0; i < NUM_TXS_REBASE; ++ i)
+		{
+			unique_ptr<DB::Tx> tx(db.newTransaction());
+			for(int j = 0; j < NUM_PUTS_PER_TX; ++ j)
+			{
+				tx->put_k32u(rand() % NUM_KEYS_REBASE, BufferCRef(value, sizeof(value)));
+			}
+			tx->tryCommit();
+		}
+		const TPIOStat& st = db.tpio_()->stat();
+		const unsigned int nRebase = st.nRebase - stBefore.nRebase;
+
+		std::cout << "# rebase visit: " << nRebase << " rebases, "
+			<< (nRebase ? (st.nsRebaseVisit - stBefore.nsRebaseVisit) / nRebase / 1000 : 0) << " us/rebase, "
+			<< (nRebase ? (st.nRebaseOldLink - stBefore.nRebaseOldLink) / nRebase : 0) << " pgs w/ old link/rebase" << std::endl;
+	}
+
+	// 3. rebase wall time vs num thrs, on the same snapshot of wide trees in many tables
+	{
+		const int NUM_TABLES = 16, NUM_KEYS_PER_TABLE = 20000, NUM_INSERTS = 20000;
+		const unsigned int numThrs[] = {1, 2, 4, 8};
+
+		char key[128]; ::memset(key, 'k', sizeof(key));
+		char value[64]; ::memset(value, 'v', sizeof(value));
+		std::vector<unique_ptr<TableOffCache> > tables;
+		for(int t = 0; t < NUM_TABLES; ++ t)
+		{
+			char name[16]; sprintf(name, "table%d", t);
+			tables.push_back(unique_ptr<TableOffCache>(new TableOffCache(BufferCRef(name, ::strlen(name)))));
+		}
+
+		for(unsigned int nthr: numThrs)
+		{
+			DB db(dbfile, OWRITER | OCREATE | OTRUNCATE | OPARTITIONED);
+			db.setRebaseThreads(nthr);
+			{
+				unique_ptr<DB::Tx> tx(db.newTransaction());
+				for(int t = 0; t < NUM_TABLES; ++ t)
+				{
+					tx->tableCreate(tables[t]->getTableId());
+					for(uint32_t k = 0; k < (uint32_t)NUM_KEYS_PER_TABLE; ++ k)
+					{
+						*reinterpret_cast<uint32_t*>(key) = PTNK_BSWAP32(k << 8);
+						tx->put(tables[t].get(), BufferCRef(key, sizeof(key)), BufferCRef(value, sizeof(value)));
+					}
+				}
+				tx->tryCommit();
+			}
+			db.rebase(true);
+
+			// same inserts for each num thrs. the tx may trigger rebase on commit
+			const TPIOStat stBefore = db.tpio_()->stat();
+			srand(0);
+			{
+				unique_ptr<DB::Tx> tx(db.newTransaction());
+				for(int i = 0; i < NUM_INSERTS; ++ i)
+				{
+					*reinterpret_cast<uint32_t*>(key) = PTNK_BSWAP32(rand() % (NUM_KEYS_PER_TABLE << 8));
+					tx->put(tables[rand() % NUM_TABLES].get(), BufferCRef(key, sizeof(key)), BufferCRef(value, sizeof(value)));
+				}
+				tx->tryCommit();
+			}
+
+			db.rebase(true);
+			const TPIOStat& st = db.tpio_()->stat();
+
+			std::cout << "# rebase " << nthr << " thrs: " << (st.nsRebaseVisit - stBefore.nsRebaseVisit) / 1000 << " us, "
+				<< (st.nRebaseOldLink - stBefore.nRebaseOldLink) << " pgs w/ old link" << std::endl;
+		}
+	}
+}
+
+//! measure btree_get on cold pages (random keys over a large table) and on warm pages (small hot key set)
+void
+run_bench_btree_get()
+{
+	const int NUM_KEYS_GET = 1000000, NUM_GETS = 1000000, NUM_KEYS_HOT = 64, NUM_PUTS_PER_TX = 100000;
+
+	char value[16]; ::memset(value, 'v', sizeof(value));
+	for(bool bPrefixed: {false, true})
+	{
+		// prefixed keys share first bytes, so leaf fingerprints can't tell them apart
+		auto mkkey = [bPrefixed](char* buf, uint32_t k) -> BufferCRef {
+			k *= 2654435761U; // scatter
+			if(bPrefixed)
+			{
+				sprintf(buf, "user%012u", k);
+				return BufferCRef(buf, 16);
+			}
+			else
+			{
+				*reinterpret_cast<uint32_t*>(buf) = PTNK_BSWAP32(k);
+				return BufferCRef(buf, 4);
+			}
+		};
+
+		DB db(dbfile, OWRITER | OCREATE | OTRUNCATE | OPARTITIONED);
+		char key[32];
+		for(int k = 0; k < NUM_KEYS_GET; k += NUM_PUTS_PER_TX)
+		{
+			unique_ptr<DB::Tx> tx(db.newTransaction());
+			for(int j = k; j < k + NUM_PUTS_PER_TX; ++ j)
+			{
+				tx->put(mkkey(key, j), BufferCRef(value, sizeof(value)));
+			}
+			tx->tryCommit();
+		}
+		db.rebase(true);
+
+		std::vector<uint32_t> ksCold(NUM_GETS), ksWarm(NUM_GETS);
+		for(int i = 0; i < NUM_GETS; ++ i)
+		{
+			ksCold[i] = rand() % NUM_KEYS_GET;
+			ksWarm[i] = ksCold[i % NUM_KEYS_HOT];
+		}
+
+		unique_ptr<DB::Snapshot> ss(db.newSnapshot());
+		char buf[sizeof(value)];
+		unsigned long ns[2];
+		for(int iW = 0; iW < 2; ++ iW)
+		{
+			const std::vector<uint32_t>& ks = iW ? ksWarm : ksCold;
+
+			HighResTimeStamp tsBefore, tsAfter;
+			tsBefore.reset();
+			for(int i = 0; i < NUM_GETS; ++ i)
+			{
+				ss->get(mkkey(key, ks[i]), BufferRef(buf, sizeof(buf)));
+			}
+			tsAfter.reset();
+			ns[iW] = tsAfter.elapsed_ns(tsBefore);
+		}
+
+		std::cout << "# btree_get " << (bPrefixed ? "prefixed 16B" : "4B") << " keys: cold " << ns[0] / NUM_GETS << " ns/get, warm "
+			<< ns[1] / NUM_GETS << " ns/get" << std::endl;
+	}
+}
+
+void
+run_bench_btree_shape()
+{
+	const int NUM_KEYS_SHAPE = 500000, NUM_TENANTS = 16, NUM_USERS = 1000;
+
+	// composite keys: a few long shared prefixes, distinct tails
+	std::vector<uint32_t> ks(NUM_KEYS_SHAPE);
+	for(int i = 0; i < NUM_KEYS_SHAPE; ++ i) ks[i] = i;
+	std::random_shuffle(ks.begin(), ks.end());
+	auto mkkey = [](char* buf, uint32_t k) -> BufferCRef {
+		int len = sprintf(buf, "tenant%04u/user%08u/event%010u", k % NUM_TENANTS, (k / NUM_TENANTS) % NUM_USERS, k);
+		return BufferCRef(buf, len);
+	};
+
+	unique_ptr<PageIO> pio(new PageIOMem);
+	page_id_t idRoot = btree_init(pio.get());
+
+	char key[64], value[16]; ::memset(value, 'v', sizeof(value));
+	HighResTimeStamp tsBefore, tsAfter;
+	tsBefore.reset();
+	for(uint32_t k: ks)
+	{
+		idRoot = btree_put(idRoot, mkkey(key, k), BufferCRef(value, sizeof(value)), PUT_INSERT, pio.get());
+	}
+	tsAfter.reset();
+	unsigned long nsPut = tsAfter.elapsed_ns(tsBefore);
+
+	tsBefore.reset();
+	for(uint32_t k: ks)
+	{
+		btree_get(idRoot, mkkey(key, k), BufferRef(value, sizeof(value)), pio.get());
+	}
+	tsAfter.reset();
+	unsigned long nsGet = tsAfter.elapsed_ns(tsBefore);
+
+	btree_stat_t stat;
+	btree_stat(idRoot, &stat, pio.get());
+	std::cout << "# btree_shape composite keys: height " << stat.height << ", nodes " << stat.numNodes << ", leaves " << stat.numLeaves
+		<< ", free in leaves " << stat.sizeFreeLeaves / stat.numLeaves << " B/leaf, "
+		<< nsPut / NUM_KEYS_SHAPE << " ns/put, " << nsGet / NUM_KEYS_SHAPE << " ns/get" << std::endl;
+}
+
+//! measure sequential key ingest (e.g. timestamp keys) and the resulting db size
+void
+run_bench_append()
+{
+	const int NUM_TXS_APPEND = 200, NUM_PUTS_PER_TX = 5000;
+
+	DB db(dbfile, OWRITER | OCREATE | OTRUNCATE | OPARTITIONED);
+
+	char value[16]; ::memset(value, 'v', sizeof(value));
+	HighResTimeStamp tsBefore, tsAfter;
+	tsBefore.reset();
+	uint32_t k = 0;
+	for(int i = 0; i < NUM_TXS_APPEND; ++ i)
+	{
+		unique_ptr<DB::Tx> tx(db.newTransaction());
+		for(int j = 0; j < NUM_PUTS_PER_TX; ++ j, ++ k)
+		{
+			tx->put_k32u(k, BufferCRef(value, sizeof(value)));
+		}
+		tx->tryCommit();
+	}
+	tsAfter.reset();
+	const unsigned long nsPut = tsAfter.elapsed_ns(tsBefore);
+
+	db.rebase(true);
+
+	btree_stat_t stat;
+	{
+		unique_ptr<DB::Tx> tx(db.newTransaction());
+		OverviewPage pgOvv(tx->pio()->readPage(tx->pio()->pgidStartPage()));
+		btree_stat(pgOvv.getDefaultTableRoot(), &stat, tx->pio());
+	}
+
+	size_t sizeFiles = 0;
+	for(int partid = 0; ; ++ partid)
+	{
+		char filename[1024]; sprintf(filename, "%s.%03x.ptnk", dbfile, partid);
+		struct stat st;
+		if(::stat(filename, &st) != 0) break;
+		sizeFiles += st.st_size;
+	}
+
+	std::cout << "# append " << NUM_TXS_APPEND << " txs x " << NUM_PUTS_PER_TX << " puts: "
+		<< nsPut / (NUM_TXS_APPEND * NUM_PUTS_PER_TX) << " ns/put, height " << stat.height << ", nodes " << stat.numNodes
+		<< ", leaves " << stat.numLeaves << ", free in leaves " << stat.sizeFreeLeaves / stat.numLeaves << " B/leaf, db files "
+		<< sizeFiles / 1024 << " KB" << std::endl;
+}
+
+//! compare initial table load: put loop (random / sorted order) vs bulk load
+void
+run_bench_bulkload()
+{
+	const int NUM_KEYS_LOAD = 1000000, NUM_PUTS_PER_TX = 1000;
+
+	struct ary_src : public btree_bulkload_src_t
+	{
+		int i;
+		char key[9];
+
+		ary_src() : i(0) { /* NOP */ }
+
+		bool next(BufferCRef* k, BufferCRef* v)
+		{
+			if(i >= NUM_KEYS_LOAD) return false;
+
+			*k = BufferCRef(key, sprintf(key, "%08u", i));
+			*v = BufferCRef(&i, sizeof(int));
+			++ i;
+			return true;
+		}
+	};
+
+	std::vector<int> ks(NUM_KEYS_LOAD);
+	for(int i = 0; i < NUM_KEYS_LOAD; ++ i) ks[i] = i;
+
+	for(int mode = 0; mode < 3; ++ mode)
+	{
+		if(mode == 0) std::random_shuffle(ks.begin(), ks.end());
+		if(mode == 1) std::sort(ks.begin(), ks.end());
+
+		DB db(dbfile, OWRITER | OCREATE | OTRUNCATE | OPARTITIONED);
+
+		HighResTimeStamp tsBefore, tsAfter;
+		tsBefore.reset();
+		if(mode < 2)
+		{
+			for(int i = 0; i < NUM_KEYS_LOAD; i += NUM_PUTS_PER_TX)
+			{
+				unique_ptr<DB::Tx> tx(db.newTransaction());
+				for(int j = i; j < i + NUM_PUTS_PER_TX; ++ j)
+				{
+					char buf[9]; sprintf(buf, "%08u", ks[j]);
+					tx->put(BufferCRef(buf, 8), BufferCRef(&ks[j], sizeof(int)));
+				}
+				tx->tryCommit();
+			}
+		}
+		else
+		{
+			unique_ptr<DB::Tx> tx(db.newTransaction());
+			ary_src src;
+			tx->bulkLoad(&src);
+			tx->tryCommit();
+		}
+		tsAfter.reset();
+
+		static const char* MODE_NAMES[] = {"put loop (random order)", "put loop (sorted)", "bulkLoad"};
+		std::cout << "# load " << NUM_KEYS_LOAD << " keys by " << MODE_NAMES[mode] << ": "
+			<< tsAfter.elapsed_ns(tsBefore) / 1000000 << " ms" << std::endl;
+	}
+}
+
 void
 run_bench()
 {
@@ -74,6 +864,8 @@ run_bench()
 		// DB db;
 		// b.cp("db init");
 		b.start();
+		HighResTimeStamp tsBefore, tsAfter;
+		tsBefore.reset();
 
 		typedef unique_ptr<std::thread> Pthread;
 		std::vector<Pthread> tg;
@@ -83,8 +875,35 @@ run_bench()
 		}
 		for(auto& t: tg) t->join();
 
+		tsAfter.reset();
 		b.cp("tx done");
+		const unsigned long nsTx = tsAfter.elapsed_ns(tsBefore);
+
+		const TPIOStat& st = db.tpio_()->stat();
+		std::cout << "# rebase: " << st.nRebase << " (redo: " << st.nRebaseRedo << ", txs carried over: " << st.nRebaseCarryOver << ")" << std::endl;
+		std::cout << "# rebase stall: " << st.nsRebaseStall / 1000 << " us total in " << st.nRebaseStall << " newTransaction calls" << std::endl;
+		std::cout << "# rebase threshold: " << st.rebaseThreshold << " (raised " << st.nRebaseThresholdUp << " times, lowered " << st.nRebaseThresholdDown << " times)" << std::endl;
+
+		std::cout << "# conflict resolved: " << st.nConflictResolved << " ("
+			<< (nsTx > 0 ? (unsigned long)st.nConflictResolved * NSEC_PER_SEC / nsTx : 0) << " aborts avoided/s), key level conflict: " << st.nConflictKey << std::endl;
+
+		if(NUM_KEYS > 0) run_bench_point_read(db);
+		run_bench_begin_scaling(db);
 	}
+	if(do_sync)
+	{
+		run_bench_group_commit();
+		run_bench_commit_async();
+		run_bench_bounded_sync();
+		run_bench_eager_writeback();
+	}
+	run_bench_startup();
+	run_bench_recovery();
+	run_bench_rebase();
+	run_bench_btree_get();
+	run_bench_btree_shape();
+	run_bench_append();
+	run_bench_bulkload();
 	b.end();
 	b.dump();
 
@@ -92,5 +911,12 @@ run_bench()
 	std::cout << "# confl: " << g_confl << std::endl;
 	std::cout << "# keys: " << NUM_KEYS << std::endl;
 
+	if(NUM_W_PER_TX > 0)
+	{
+		run_bench_validation(true);
+		run_bench_validation(false);
+		run_bench_merge_scaling();
+	}
+
 	stageprof_dump();
 }
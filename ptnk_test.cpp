@@ -15,6 +15,8 @@
 #include "ptnk/sysutils.h"
 
 #include <iostream>
+#include <sstream>
+#include <map>
 #include <functional>
 
 #include <stdio.h>
@@ -842,17 +844,21 @@ TEST(ptnk, leaf_corrupt)
 	unique_ptr<PageIO> pio(new PageIOMem);
 	Leaf l(pio->newInitPage<Leaf>());
 
+	// fill the leaf up (kv fingerprint takes 4 bytes more per record)
+	const int iE = PTNK_LEAF_FINGERPRINT ? 1168 : 1197;
+
 	btree_split_t split;
-	for(int i = 1014; i < 1197; ++ i)
+	for(int i = 1014; i < iE; ++ i)
 	{
 		char key[8]; sprintf(key, "%d", i);
 		char val[16]; sprintf(val, "initial_%d", i);
 
 		l.insert(cstr2ref(key), cstr2ref(val), &split, NULL, pio.get());
+		EXPECT_FALSE(split.isValid());
 	}
 
 	Buffer k, v;
-	for(int i = 1014; i < 1197; ++ i)
+	for(int i = 1014; i < iE; ++ i)
 	{
 		char key[8]; sprintf(key, "%d", i);
 		char val[16]; sprintf(val, "initial_%d", i);
@@ -872,6 +878,179 @@ TEST(ptnk, leaf_corrupt)
 	// l.dump(NULL);
 }
 
+TEST(ptnk, leaf_fingerprint)
+{
+	unique_ptr<PageIO> pio(new PageIOMem);
+	Leaf l(pio->newInitPage<Leaf>());
+	bool bOvr = false;
+	btree_split_t split;
+
+	// keys sharing fingerprints need full key comparison
+	const char* keys[] = {"abcd", "", "abc", "abce", "zz", "ab", "abcdzzzz", "abd", "abcc", "a", "abcdaaaa", "b"};
+	const int NUM_KEYS = sizeof(keys)/sizeof(keys[0]);
+	for(int i = 0; i < NUM_KEYS; ++ i)
+	{
+		l.insert(cstr2ref(keys[i]), cstr2ref(keys[i]), &split, &bOvr, pio.get());
+		EXPECT_FALSE(split.isValid());
+	}
+	l.insert(BufferCRef::NULL_VAL, cstr2ref("null"), &split, &bOvr, pio.get());
+	l.insert(cstr2ref("abce"), cstr2ref("abce_2"), &split, &bOvr, pio.get());
+
+	Buffer tmp;
+	for(int i = 0; i < NUM_KEYS; ++ i)
+	{
+		tmp.setValsize(l.get(cstr2ref(keys[i]), tmp.wref())); tmp.makeNullTerm();
+		EXPECT_STREQ(keys[i], tmp.get());
+	}
+	tmp.setValsize(l.get(BufferCRef::NULL_VAL, tmp.wref())); tmp.makeNullTerm();
+	EXPECT_STREQ("null", tmp.get());
+
+	const char* keysMissing[] = {"abcb", "abcf", "abcda", "aa", "c", "zzz"};
+	for(const char* key: keysMissing)
+	{
+		EXPECT_EQ(-1, l.get(cstr2ref(key), tmp.wref())) << key;
+	}
+
+	// value-only record follows its key
+	btree_cursor_t cur; cur.leaf = l;
+	query_t q = {cstr2ref("abce"), MATCH_EXACT};
+	l.query(&cur, q);
+	Buffer k, v;
+	l.cursorGet(k.wref(), k.pvalsize(), v.wref(), v.pvalsize(), cur);
+	v.makeNullTerm(); EXPECT_STREQ("abce", v.get());
+	++ cur.idx;
+	l.cursorGet(k.wref(), k.pvalsize(), v.wref(), v.pvalsize(), cur);
+	v.makeNullTerm(); EXPECT_STREQ("abce_2", v.get());
+}
+
+TEST(ptnk, leaf_fingerprint_long_keys)
+{
+	unique_ptr<PageIO> pio(new PageIOMem);
+	Leaf l(pio->newInitPage<Leaf>());
+	bool bOvr = false;
+	btree_split_t split;
+
+	// keys of size >= 254 share the saturated size bucket of the fingerprint
+	const std::string keys[] = {std::string(300, 'z'), std::string(400, 'a'), std::string(500, 'm'), std::string(254, 'b')};
+	for(const std::string& key: keys)
+	{
+		l.insert(BufferCRef(key.data(), key.size()), cstr2ref("v"), &split, &bOvr, pio.get());
+		ASSERT_FALSE(split.isValid());
+	}
+
+	// records are ordered by size first
+	const size_t sizesOrdered[] = {254, 300, 400, 500};
+	btree_cursor_t cur; cur.leaf = l;
+	Buffer k(1024), v;
+	for(cur.idx = 0; cur.idx < l.numKVs(); ++ cur.idx)
+	{
+		l.cursorGet(k.wref(), k.pvalsize(), v.wref(), v.pvalsize(), cur);
+		EXPECT_EQ(static_cast<ssize_t>(sizesOrdered[cur.idx]), k.valsize());
+	}
+
+	Buffer tmp;
+	for(const std::string& key: keys)
+	{
+		EXPECT_EQ(1, l.get(BufferCRef(key.data(), key.size()), tmp.wref())) << key.size();
+	}
+
+	// through btree, long keys of various sizes spread over leaves
+	page_id_t idRoot = btree_init(pio.get());
+	const int COUNT = 200;
+	char key[512];
+	for(int i = 0; i < COUNT; ++ i)
+	{
+		const int sz = 260 + (i * 37) % 200;
+		::memset(key, 'a' + i % 26, sz); sprintf(key, "%03d", i); key[3] = '-';
+		idRoot = btree_put(idRoot, BufferCRef(key, sz), BufferCRef(&i, sizeof(i)), PUT_INSERT, pio.get());
+	}
+	for(int i = 0; i < COUNT; ++ i)
+	{
+		const int sz = 260 + (i * 37) % 200;
+		::memset(key, 'a' + i % 26, sz); sprintf(key, "%03d", i); key[3] = '-';
+		int got = -1;
+		EXPECT_EQ(static_cast<ssize_t>(sizeof(int)), btree_get(idRoot, BufferCRef(key, sz), BufferRef(&got, sizeof(got)), pio.get())) << i;
+		EXPECT_EQ(i, got);
+	}
+}
+
+TEST(ptnk, leaf_prefix)
+{
+	unique_ptr<PageIO> pio(new PageIOMem);
+	Leaf l(pio->newInitPage<Leaf>());
+	bool bOvr = false;
+	btree_split_t split;
+
+	// fill a leaf w/ composite keys until it splits (descending, so that it splits in halves)
+	char key[64], val[16];
+	int nKeys;
+	for(nKeys = 0; ; ++ nKeys)
+	{
+		sprintf(key, "tenant0001/user%08d/item", 99999 - nKeys);
+		sprintf(val, "%d", nKeys);
+		l.insert(cstr2ref(key), cstr2ref(val), &split, &bOvr, pio.get());
+		if(split.isValid()) break;
+	}
+	++ nKeys;
+	ASSERT_EQ(1U, split.numSplit);
+
+	// both halves elide the common prefix
+	Leaf l2(pio->readPage(split.split[0].pgid));
+
+	// parent gets the shortest separator, zero-filled
+	{
+		const BufferCRef sep = split.split[0].key;
+		Buffer kf; l2.keyFirst(&kf);
+		EXPECT_LE(bufcmp(sep, kf.rref()), 0);
+		EXPECT_NE(0, bufcmp(sep, kf.rref()));
+		EXPECT_EQ(0, sep.get()[sep.size() - 1]);
+
+		btree_cursor_t cur; cur.leaf = l; cur.idx = l.numKVs() - 1;
+		Buffer kl, v; l.cursorGet(kl.wref(), kl.pvalsize(), v.wref(), v.pvalsize(), cur);
+		EXPECT_LT(bufcmp(kl.rref(), sep), 0);
+	}
+	for(const Leaf& lp: {l, l2})
+	{
+		EXPECT_GE(lp.prefix().size(), (ssize_t)::strlen("tenant0001/user0009"));
+		EXPECT_EQ(0, ::memcmp(lp.prefix().get(), "tenant0001/user0009", ::strlen("tenant0001/user0009")));
+	}
+
+	// key breaking the prefix repacks the leaf
+	const ssize_t sizeFreeOld = l2.sizeFree();
+	l2.insert(cstr2ref("tenant0001/user"), cstr2ref("short"), &split, &bOvr, pio.get());
+	EXPECT_FALSE(split.isValid());
+	EXPECT_LT(l2.sizeFree(), sizeFreeOld);
+	EXPECT_STREQ("tenant0001/user", std::string(l2.prefix().get(), l2.prefix().size()).c_str());
+	l2.insert(BufferCRef::NULL_VAL, cstr2ref("null"), &split, &bOvr, pio.get());
+	EXPECT_FALSE(split.isValid());
+	EXPECT_EQ(0, l2.prefix().size());
+
+	Buffer tmp;
+	for(int i = 0; i < nKeys; ++ i)
+	{
+		sprintf(key, "tenant0001/user%08d/item", 99999 - i);
+		sprintf(val, "%d", i);
+
+		ssize_t sz = l.get(cstr2ref(key), tmp.wref());
+		if(sz < 0) sz = l2.get(cstr2ref(key), tmp.wref());
+		tmp.setValsize(sz); tmp.makeNullTerm();
+		EXPECT_STREQ(val, tmp.get()) << key;
+	}
+
+	// cursor restores full keys
+	Buffer k, v;
+	btree_cursor_t cur; cur.leaf = l2; cur.idx = l2.numKVs() - 1;
+	l2.cursorGet(k.wref(), k.pvalsize(), v.wref(), v.pvalsize(), cur);
+	k.makeNullTerm();
+	sprintf(key, "tenant0001/user%08d/item", 99999);
+	EXPECT_STREQ(key, k.get());
+	tmp.setValsize(l2.get(cstr2ref("tenant0001/user"), tmp.wref())); tmp.makeNullTerm();
+	EXPECT_STREQ("short", tmp.get());
+	tmp.setValsize(l2.get(BufferCRef::NULL_VAL, tmp.wref())); tmp.makeNullTerm();
+	EXPECT_STREQ("null", tmp.get());
+	EXPECT_EQ(-1, l2.get(cstr2ref("tenant0001/usex"), tmp.wref()));
+}
+
 TEST(ptnk, leaf_dupkey_simple)
 {
 	unique_ptr<PageIO> pio(new PageIOMem);
@@ -2180,6 +2359,66 @@ TEST(ptnk, btree_cursor_get_first)
 	EXPECT_STREQ("fuga", value.get());
 }
 
+TEST(ptnk, btree_prefix)
+{
+	unique_ptr<PageIO> pio(new PageIOMem);
+	
+	page_id_t idRoot = btree_init(pio.get());
+
+	const int NUM_KVS = 30000;
+	char key[64], val[16];
+	for(int i = 0; i < NUM_KVS; ++ i)
+	{
+		int j = (i * 7919) % NUM_KVS;
+		sprintf(key, "tenant%04d/user%08d/item%06d", j % 7, j / 7, j);
+		sprintf(val, "%d", j);
+		idRoot = btree_put(idRoot, cstr2ref(key), cstr2ref(val), PUT_INSERT, pio.get());
+	}
+	// keys sharing no prefix w/ their neighbors
+	idRoot = btree_put(idRoot, cstr2ref("tenant0003"), cstr2ref("t3"), PUT_INSERT, pio.get());
+	idRoot = btree_put(idRoot, cstr2ref("tenant0003/user"), cstr2ref("t3u"), PUT_INSERT, pio.get());
+	idRoot = btree_put(idRoot, cstr2ref("a"), cstr2ref("a"), PUT_INSERT, pio.get());
+
+	Buffer value;
+	for(int j = 0; j < NUM_KVS; ++ j)
+	{
+		sprintf(key, "tenant%04d/user%08d/item%06d", j % 7, j / 7, j);
+		sprintf(val, "%d", j);
+
+		value.setValsize(btree_get(idRoot, cstr2ref(key), value.wref(), pio.get()));
+		value.makeNullTerm();
+		EXPECT_STREQ(val, value.get());
+	}
+	value.setValsize(btree_get(idRoot, cstr2ref("tenant0003/user"), value.wref(), pio.get()));
+	value.makeNullTerm();
+	EXPECT_STREQ("t3u", value.get());
+	EXPECT_EQ(-1, btree_get(idRoot, cstr2ref("tenant0003/"), value.wref(), pio.get()));
+
+	// keys come back in order
+	btree_cursor_wrap cur;
+	btree_cursor_front(cur.get(), idRoot, pio.get());
+	Buffer k, kPrev, v;
+	int count = 0;
+	do
+	{
+		btree_cursor_get(k.wref(), k.pvalsize(), v.wref(), v.pvalsize(), cur.get(), pio.get());
+		if(count > 0)
+		{
+			EXPECT_LT(bufcmp(kPrev.rref(), k.rref()), 0);
+		}
+		kPrev = k.rref();
+		++ count;
+	}
+	while(btree_cursor_next(cur.get(), pio.get()));
+	EXPECT_EQ(NUM_KVS + 3, count);
+
+	btree_stat_t stat;
+	btree_stat(idRoot, &stat, pio.get());
+	EXPECT_GE(stat.height, 2);
+	EXPECT_EQ(0U, stat.numDupKeyTrees);
+	EXPECT_GT(stat.numLeaves, stat.numNodes);
+}
+
 TEST(ptnk, btree_cursor_nextprev)
 {
 	unique_ptr<PageIO> pio(new PageIOMem);
@@ -2545,6 +2784,260 @@ TEST(ptnk, btree_nonexact_query)
 	}
 }
 
+TEST(ptnk, btree_separator_query)
+{
+	unique_ptr<PageIO> pio(new PageIOMem);
+
+	page_id_t idRoot = btree_init(pio.get());
+
+	// large values so that separators between most of the keys are in nodes
+	const int COUNT = 2000;
+	char key[16], val[256]; ::memset(val, '=', sizeof(val));
+	for(int i = 0; i < COUNT; ++ i)
+	{
+		sprintf(key, "k%07d", i*10);
+		sprintf(val, "%08d", i); val[8] = '=';
+		idRoot = btree_put(idRoot, cstr2ref(key), BufferCRef(val, sizeof(val)), PUT_INSERT, pio.get());
+	}
+
+	btree_cursor_wrap cur;
+	Buffer k, v;
+	auto query = [&](const char* qkey, query_type_t type) -> int {
+		query_t q = {cstr2ref(qkey), type};
+		btree_query(cur.get(), idRoot, q, pio.get());
+		if(! btree_cursor_valid(cur.get())) return -1;
+
+		btree_cursor_get(k.wref(), k.pvalsize(), v.wref(), v.pvalsize(), cur.get(), pio.get());
+		k.makeNullTerm();
+		return atoi(k.get() + 1);
+	};
+	for(int i = 0; i < COUNT; ++ i)
+	{
+		// keys between the records (and the leaves)
+		sprintf(key, "k%07d", i*10 + 5);
+		EXPECT_EQ(i*10, query(key, MATCH_OR_PREV)) << key;
+		EXPECT_EQ(i < COUNT-1 ? (i+1)*10 : -1, query(key, MATCH_OR_NEXT)) << key;
+
+		sprintf(key, "k%07d", i*10);
+		EXPECT_EQ(i*10, query(key, MATCH_EXACT)) << key;
+		EXPECT_EQ(i > 0 ? (i-1)*10 : -1, query(key, BEFORE)) << key;
+		EXPECT_EQ(i < COUNT-1 ? (i+1)*10 : -1, query(key, AFTER)) << key;
+	}
+}
+
+TEST(ptnk, btree_append_hint)
+{
+	unique_ptr<PageIO> pio(new PageIOMem);
+
+	page_id_t idRoot = btree_init(pio.get()), idRootRef = btree_init(pio.get());
+	btree_append_hint_t hint;
+
+	// mostly appends, w/ some keys going into the middle of the tree
+	const int COUNT = 30000;
+	char key[16], val[32];
+	int numKeys = 0;
+	for(int i = 0; i < COUNT; ++ i)
+	{
+		sprintf(key, "k%07d", i*2);
+		sprintf(val, "v%07d", i*2);
+		idRoot = btree_put(idRoot, cstr2ref(key), cstr2ref(val), PUT_INSERT, pio.get(), &hint);
+		idRootRef = btree_put(idRootRef, cstr2ref(key), cstr2ref(val), PUT_INSERT, pio.get());
+		++ numKeys;
+
+		if(i % 97 == 1)
+		{
+			sprintf(key, "k%07d", (i/2)*2 + 1);
+			sprintf(val, "v%07d", (i/2)*2 + 1);
+			idRoot = btree_put(idRoot, cstr2ref(key), cstr2ref(val), PUT_INSERT, pio.get(), &hint);
+			idRootRef = btree_put(idRootRef, cstr2ref(key), cstr2ref(val), PUT_INSERT, pio.get());
+			++ numKeys;
+		}
+	}
+
+	// hint must not change the tree
+	btree_stat_t stat, statRef;
+	btree_stat(idRoot, &stat, pio.get());
+	btree_stat(idRootRef, &statRef, pio.get());
+	EXPECT_EQ(statRef.height, stat.height);
+	EXPECT_EQ(statRef.numNodes, stat.numNodes);
+	EXPECT_EQ(statRef.numLeaves, stat.numLeaves);
+
+	// appended leaves are kept full
+	EXPECT_GT(stat.numLeaves * PTNK_BODY_SIZE / 10, stat.sizeFreeLeaves);
+
+	btree_cursor_wrap cur;
+	btree_cursor_front(cur.get(), idRoot, pio.get());
+	Buffer k, v;
+	int prev = -1, n = 0;
+	for(; btree_cursor_valid(cur.get()); btree_cursor_next(cur.get(), pio.get()), ++ n)
+	{
+		btree_cursor_get(k.wref(), k.pvalsize(), v.wref(), v.pvalsize(), cur.get(), pio.get());
+		k.makeNullTerm(); v.makeNullTerm();
+		int ik = atoi(k.get() + 1);
+		EXPECT_LT(prev, ik);
+		EXPECT_EQ(ik, atoi(v.get() + 1));
+		prev = ik;
+	}
+	EXPECT_EQ(numKeys, n);
+}
+
+//! sorted kv records w/ shared key prefixes and variable sized values
+struct t_bulkload_src : public btree_bulkload_src_t
+{
+	int i, count;
+	char key[32], value[64];
+
+	t_bulkload_src(int count_)
+	:	i(0), count(count_)
+	{ /* NOP */ }
+
+	static BufferCRef mkkey(char* buf, int i)
+	{
+		return BufferCRef(buf, sprintf(buf, "tenant%02d/user%08d", i / 10000, i));
+	}
+
+	bool next(BufferCRef* k, BufferCRef* v)
+	{
+		if(i >= count) return false;
+
+		*k = mkkey(key, i);
+		::memset(value, '=', sizeof(value)); sprintf(value, "%d", i); value[::strlen(value)] = '=';
+		*v = BufferCRef(value, 8 + i % 40);
+
+		++ i;
+		return true;
+	}
+};
+
+//! sorted kv records, large ones as large as btree_put accepts
+/*!
+ *	keys of the latter half and values of every 3rd record are large
+ */
+struct t_bulkload_large_src : public btree_bulkload_src_t
+{
+	int i, count;
+	char key[Page::BODY_SIZE], value[Page::BODY_SIZE];
+
+	t_bulkload_large_src(int count_)
+	:	i(0), count(count_)
+	{ /* NOP */ }
+
+	static ssize_t szValue(int i)
+	{
+		return i % 3 == 0 ? Page::BODY_SIZE/2 - 1 : 16;
+	}
+
+	BufferCRef mkkey(char* buf, int i) const
+	{
+		// keys are ordered by their size first
+		const size_t sz = i < count/2 ? 16 : Page::BODY_SIZE/2 - 1;
+		::memset(buf, 'k', sz); sprintf(buf, "large%04d", i); buf[9] = 'k';
+		return BufferCRef(buf, sz);
+	}
+
+	bool next(BufferCRef* k, BufferCRef* v)
+	{
+		if(i >= count) return false;
+
+		*k = mkkey(key, i);
+		::memset(value, 'v', szValue(i)); value[szValue(i) - 1] = '0' + i % 10;
+		*v = BufferCRef(value, szValue(i));
+
+		++ i;
+		return true;
+	}
+};
+
+TEST(ptnk, btree_bulkload)
+{
+	unique_ptr<PageIO> pio(new PageIOMem);
+
+	const int COUNT = 50000;
+	t_bulkload_src src(COUNT);
+	page_id_t idRoot = btree_bulkload(&src, pio.get());
+
+	btree_stat_t stat;
+	btree_stat(idRoot, &stat, pio.get());
+	EXPECT_GT(stat.numLeaves * PTNK_BODY_SIZE / 20, stat.sizeFreeLeaves);
+
+	char key[32]; Buffer v;
+	for(int i = 0; i < COUNT; ++ i)
+	{
+		v.setValsize(btree_get(idRoot, t_bulkload_src::mkkey(key, i), v.wref(), pio.get()));
+		ASSERT_EQ(8 + i % 40, v.valsize()) << key;
+		v.makeNullTerm();
+		ASSERT_EQ(i, atoi(v.get()));
+	}
+
+	// the tree can be modified as usual
+	for(int i = 0; i < COUNT; i += 7)
+	{
+		sprintf(key, "tenant%02d/user%08dx", i / 10000, i);
+		idRoot = btree_put(idRoot, cstr2ref(key), cstr2ref("added"), PUT_INSERT, pio.get());
+	}
+	btree_cursor_wrap cur;
+	btree_cursor_front(cur.get(), idRoot, pio.get());
+	Buffer k, kPrev;
+	int n = 0;
+	for(; btree_cursor_valid(cur.get()); btree_cursor_next(cur.get(), pio.get()), ++ n)
+	{
+		btree_cursor_get(k.wref(), k.pvalsize(), v.wref(), v.pvalsize(), cur.get(), pio.get());
+		if(n > 0)
+		{
+			EXPECT_GT(0, bufcmp(kPrev.rref(), k.rref()));
+		}
+		kPrev = k.rref();
+	}
+	EXPECT_EQ(COUNT + (COUNT + 6) / 7, n);
+
+	// records as large as btree_put accepts, which don't fit even an empty leaf
+	{
+		t_bulkload_large_src srcLarge(30);
+		idRoot = btree_bulkload(&srcLarge, pio.get());
+
+		// read back w/ cursor, as btree_get doesn't look into dupkey leaves
+		char keyL[Page::BODY_SIZE];
+		Buffer kL(Page::BODY_SIZE), vL(Page::BODY_SIZE);
+		btree_cursor_front(cur.get(), idRoot, pio.get());
+		for(n = 0; btree_cursor_valid(cur.get()); btree_cursor_next(cur.get(), pio.get()), ++ n)
+		{
+			btree_cursor_get(kL.wref(), kL.pvalsize(), vL.wref(), vL.pvalsize(), cur.get(), pio.get());
+			ASSERT_TRUE(bufeq(srcLarge.mkkey(keyL, n), kL.rref())) << n;
+			ASSERT_EQ(t_bulkload_large_src::szValue(n), vL.valsize()) << n;
+			EXPECT_EQ('0' + n % 10, vL.get()[vL.valsize() - 1]);
+		}
+		EXPECT_EQ(srcLarge.count, n);
+	}
+
+	// keys btree_put doesn't accept are rejected
+	{
+		struct oversize_src : public btree_bulkload_src_t
+		{
+			bool bDone;
+			char key[Page::BODY_SIZE];
+
+			bool next(BufferCRef* k, BufferCRef* v)
+			{
+				if(bDone) return false;
+				bDone = true;
+
+				::memset(key, 'k', sizeof(key));
+				*k = BufferCRef(key, Page::BODY_SIZE/2);
+				*v = cstr2ref("v");
+				return true;
+			}
+		} srcOversize;
+		srcOversize.bDone = false;
+		EXPECT_THROW(btree_bulkload(&srcOversize, pio.get()), ptnk_runtime_error);
+	}
+
+	// empty input
+	t_bulkload_src srcEmpty(0);
+	idRoot = btree_bulkload(&srcEmpty, pio.get());
+	btree_cursor_front(cur.get(), idRoot, pio.get());
+	EXPECT_FALSE(btree_cursor_valid(cur.get()));
+}
+
 TEST(ptnk, OverviewPage)
 {
 	unique_ptr<PageIO> pio(new PageIOMem);
@@ -2695,14 +3188,14 @@ TEST(ptnk, btree_cursor_del_wholeleaf)
 	int iFirst, iLast;
 	{
 		Buffer strFirst;
-		strFirst = Leaf(pio->readPage(2)).keyFirst();
+		Leaf(pio->readPage(2)).keyFirst(&strFirst);
 		strFirst.makeNullTerm();
 		
 		iFirst = atoi(strFirst.get());
 	}
 	{
 		Buffer strLast;
-		strLast = Leaf(pio->readPage(3)).keyFirst();
+		Leaf(pio->readPage(3)).keyFirst(&strLast);
 		strLast.makeNullTerm();
 
 		iLast = atoi(strLast.get()) - 1;
@@ -3253,6 +3746,52 @@ TEST(ptnk, TPIO_join)
 	t->join();
 }
 
+TEST(ptnk, TPIO_retire)
+{
+	shared_ptr<PageIO> pio(new PageIOMem);
+	TPIO tpio(pio);
+
+	int count = 0;
+	tpio.retire([&count] () mutable { count ++; }); // => run right away
+	EXPECT_EQ(1, count);
+
+	unique_ptr<TPIOTxSession> tx1(tpio.newTransaction());
+	tpio.retire([&count] () mutable { count ++; });
+	EXPECT_EQ(1, count);
+
+	// retire callback is not blocked by txs started after the call
+	unique_ptr<TPIOTxSession> tx2;
+	std::thread t([&tpio, &tx2] () { tx2 = tpio.newTransaction(); });
+	t.join();
+
+	tx1.reset();
+	EXPECT_EQ(2, count);
+}
+
+TEST(ptnk, TPIO_rebasePolicy)
+{
+	RebasePolicy policy(1024);
+	EXPECT_FALSE(policy.needRebase(1023));
+	EXPECT_TRUE(policy.needRebase(1024));
+
+	// most reads go through ovr entries -> rebase more often
+	usleep(RebasePolicy::INTERVAL_MIN_MS * 1000 * 2);
+	policy.notifyTxEnd(100, 90);
+	EXPECT_EQ(-1, policy.adapt());
+	EXPECT_EQ(512U, policy.threshold());
+
+	// reads barely hit ovr entries -> rebase less often
+	usleep(RebasePolicy::INTERVAL_MIN_MS * 1000 * 2);
+	policy.notifyTxEnd(100, 1);
+	EXPECT_EQ(+1, policy.adapt());
+	EXPECT_EQ(1024U, policy.threshold());
+
+	// threshold crossed too soon -> rebase less often regardless of reads
+	policy.notifyTxEnd(100, 90);
+	EXPECT_EQ(+1, policy.adapt());
+	EXPECT_EQ(2048U, policy.threshold());
+}
+
 TEST(ptnk, nUniquePages)
 {
 	DB db;
@@ -3780,33 +4319,123 @@ TEST(ptnk, intensive_rebase)
 	}
 }
 
-TEST(ptnk, DISABLED_million_key_put_get)
+TEST(ptnk, rebase_parallel)
 {
-	DB db("/home/kouhei/work/ssd/test.ptnk", ODEFAULT | OTRUNCATE);
-	const int NUM_KEYS = 1000000;
+	t_mktmpdir("./_testtmp");
 
-	for(int i = 0; i < NUM_KEYS;)
+	// inserts split pages all over the tables. long keys make the trees have many nodes,
+	// which leaves many subtrees w/ old links to rebase
+	const int NUM_TABLES = 8, NUM_KEYS_INIT = 4000, NUM_TXS = 400, NUM_PUTS_PER_TX = 16;
+	const uint32_t KEY_STRIDE = 1024;
+	std::vector<unique_ptr<TableOffCache> > tables;
+	for(int t = 0; t < NUM_TABLES; ++ t)
 	{
-		unique_ptr<DB::Tx> tx(db.newTransaction());
-		
-		for(int j = 0; j < 100000; ++ j)
-		{
-			char buf[8];
-			sprintf(buf, "%u", i);
-			tx->put_k32u(i, cstr2ref(buf));
-
-			++ i;
-		}
-
-		EXPECT_TRUE(tx->tryCommit());
+		char name[16]; sprintf(name, "table%d", t);
+		tables.push_back(unique_ptr<TableOffCache>(new TableOffCache(cstr2ref(name))));
 	}
-	return;
+	std::vector<std::map<uint32_t, uint32_t> > expected(NUM_TABLES);
 
-	Buffer v(32);
-	for(int i = 0; i < NUM_KEYS; ++ i)
+	struct key_t
 	{
-		char bufCorrect[8];
-		sprintf(bufCorrect, "%u", i);
+		uint32_t kbe;
+		char pad[196];
+
+		explicit key_t(uint32_t k)
+		:	kbe(PTNK_BSWAP32(k))
+		{
+			::memset(pad, 'k', sizeof(pad));
+		}
+	};
+	auto put = [&tables, &expected] (DB::Tx* tx, int t, uint32_t k, uint32_t v) {
+		key_t key(k);
+		tx->put(tables[t].get(), BufferCRef(&key, sizeof(key)), BufferCRef(&v, sizeof(v)));
+		expected[t][k] = v;
+	};
+	auto verify = [&tables, &expected] (DB& db) {
+		unique_ptr<DB::Tx> tx(db.newTransaction());
+		for(int t = 0; t < NUM_TABLES; ++ t)
+		{
+			for(const auto& kv: expected[t])
+			{
+				key_t key(kv.first); uint32_t v = ~0U;
+				ASSERT_EQ((ssize_t)sizeof(v), tx->get(tables[t].get(), BufferCRef(&key, sizeof(key)), BufferRef(&v, sizeof(v))));
+				ASSERT_EQ(kv.second, v) << "table " << t << " key " << kv.first;
+			}
+		}
+	};
+
+	{
+		DB db("./_testtmp/rebasepar", OWRITER | OCREATE | OTRUNCATE | OPARTITIONED);
+		// fan out even on single core
+		db.setRebaseThreads(4);
+
+		{
+			unique_ptr<DB::Tx> tx(db.newTransaction());
+			for(int t = 0; t < NUM_TABLES; ++ t)
+			{
+				tx->tableCreate(tables[t]->getTableId());
+				for(uint32_t k = 0; k < (uint32_t)NUM_KEYS_INIT; ++ k)
+				{
+					put(tx.get(), t, k * KEY_STRIDE, k);
+				}
+			}
+			ASSERT_TRUE(tx->tryCommit());
+		}
+		db.rebase();
+
+		const TPIOStat stBefore = db.tpio_()->stat();
+		for(int i = 0; i < NUM_TXS; ++ i)
+		{
+			unique_ptr<DB::Tx> tx(db.newTransaction());
+			for(int j = 0; j < NUM_PUTS_PER_TX; ++ j)
+			{
+				put(tx.get(), rand() % NUM_TABLES, rand() % (NUM_KEYS_INIT * KEY_STRIDE), i * NUM_PUTS_PER_TX + j);
+			}
+			ASSERT_TRUE(tx->tryCommit());
+
+			if(i % 100 == 99) db.rebase();
+		}
+		const TPIOStat& st = db.tpio_()->stat();
+		const unsigned int nRebase = st.nRebase - stBefore.nRebase;
+		ASSERT_LT(0U, nRebase);
+		EXPECT_LT(64U * nRebase, st.nRebaseOldLink - stBefore.nRebaseOldLink) << "rebases should have been wide enough to fan out";
+
+		verify(db);
+		db.setCheckpointOnClose(false);
+	}
+
+	// rebased pages are restored from the log
+	DB db("./_testtmp/rebasepar", OPARTITIONED);
+	verify(db);
+}
+
+TEST(ptnk, DISABLED_million_key_put_get)
+{
+	DB db("/home/kouhei/work/ssd/test.ptnk", ODEFAULT | OTRUNCATE);
+	const int NUM_KEYS = 1000000;
+
+	for(int i = 0; i < NUM_KEYS;)
+	{
+		unique_ptr<DB::Tx> tx(db.newTransaction());
+		
+		for(int j = 0; j < 100000; ++ j)
+		{
+			char buf[8];
+			sprintf(buf, "%u", i);
+			tx->put_k32u(i, cstr2ref(buf));
+
+			++ i;
+		}
+
+		EXPECT_TRUE(tx->tryCommit());
+	}
+	return;
+
+	Buffer v(32);
+	for(int i = 0; i < NUM_KEYS; ++ i)
+	{
+		char bufCorrect[8];
+		sprintf(bufCorrect, "%u", i);
 
 		db.get_k32u(i, &v);
 		ASSERT_TRUE(v.isValid());
@@ -3956,6 +4585,44 @@ TEST(ptnk, multitable)
 	}
 }
 
+TEST(ptnk, db_bulkload)
+{
+	t_mktmpdir("./_testtmp");
+	const int COUNT = 20000;
+
+	{
+		DB db("./_testtmp/bulkload", OWRITER | OCREATE | OTRUNCATE | OPARTITIONED);
+
+		unique_ptr<DB::Tx> tx(db.newTransaction());
+		tx->tableCreate(cstr2ref("bulk"));
+		t_bulkload_src src(COUNT);
+		tx->bulkLoad(cstr2ref("bulk"), &src);
+		tx->put(cstr2ref("bulk"), cstr2ref("zzz"), cstr2ref("put"));
+
+		// only empty tables can be loaded
+		t_bulkload_src src2(COUNT);
+		EXPECT_THROW(tx->bulkLoad(cstr2ref("bulk"), &src2), ptnk_runtime_error);
+
+		ASSERT_TRUE(tx->tryCommit());
+	}
+
+	{
+		DB db("./_testtmp/bulkload", OWRITER | OPARTITIONED);
+
+		unique_ptr<DB::Tx> tx(db.newTransaction());
+		char key[32]; Buffer v;
+		for(int i = 0; i < COUNT; ++ i)
+		{
+			tx->get(cstr2ref("bulk"), t_bulkload_src::mkkey(key, i), &v);
+			ASSERT_TRUE(v.isValid()) << key;
+			v.makeNullTerm();
+			ASSERT_EQ(i, atoi(v.get()));
+		}
+		tx->get(cstr2ref("bulk"), cstr2ref("zzz"), &v);
+		EXPECT_TRUE(bufeq(cstr2ref("put"), v.rref()));
+	}
+}
+
 TEST(ptnk, PartitionedPageIO_scanfile)
 {
 	t_mktmpdir("./_testtmp");
@@ -4208,6 +4875,56 @@ TEST(ptnk, commit_fail_over_rebase)
 	}
 }
 
+TEST(ptnk, commit_resolve_conflict)
+{
+	DB db;
+	for(int i = 0; i < 10; ++ i)
+	{
+		char buf[8];
+		sprintf(buf, "%u", i);
+		db.put_k32u(i, cstr2ref(buf));
+	}
+
+	Buffer v;
+
+	// diff keys in the same leaf: resolved
+	{
+		unique_ptr<DB::Tx> tx1(db.newTransaction());
+		unique_ptr<DB::Tx> tx2(db.newTransaction());
+
+		tx1->get_k32u(1, &v);
+		tx1->put_k32u(1, cstr2ref("tx1"));
+		tx2->get_k32u(2, &v);
+		tx2->put_k32u(2, cstr2ref("tx2"));
+
+		ASSERT_TRUE(tx1->tryCommit());
+		ASSERT_TRUE(tx2->tryCommit());
+	}
+	db.get_k32u(1, &v); v.makeNullTerm();
+	EXPECT_STREQ("tx1", v.get());
+	db.get_k32u(2, &v); v.makeNullTerm();
+	EXPECT_STREQ("tx2", v.get());
+
+	// tx read key written by other tx: conflict
+	{
+		unique_ptr<DB::Tx> tx1(db.newTransaction());
+		unique_ptr<DB::Tx> tx2(db.newTransaction());
+
+		tx1->put_k32u(3, cstr2ref("tx1"));
+		tx2->get_k32u(3, &v);
+		tx2->put_k32u(4, cstr2ref("tx2"));
+
+		ASSERT_TRUE(tx1->tryCommit());
+		ASSERT_FALSE(tx2->tryCommit());
+	}
+	db.get_k32u(4, &v); v.makeNullTerm();
+	EXPECT_STREQ("4", v.get());
+
+	const TPIOStat& st = db.tpio_()->stat();
+	EXPECT_EQ(1u, st.nConflictResolved);
+	EXPECT_EQ(1u, st.nConflictKey);
+}
+
 struct put_ary_db
 {
 	DB& db;
@@ -4292,6 +5009,139 @@ TEST(ptnk, multithread_put)
 	if(fplist) fclose(fplist);
 }
 
+TEST(ptnk, multithread_put_group_commit)
+{
+	t_mktmpdir("./_testtmp");
+
+	const int NUM_KEYS = 4000;
+	const int NUM_THREADS = 8;
+	const int NUM_KEYS_PER_TH = NUM_KEYS / NUM_THREADS;
+	SETUP_ORD(NUM_KEYS);
+
+	{
+		DB db("./_testtmp/mtgroupcommit", OWRITER | OCREATE | OTRUNCATE | OPARTITIONED | OAUTOSYNC);
+		db.setGroupCommit(100, 16);
+
+		thread_group tg;
+		for(int i = 0; i < NUM_THREADS; ++ i)
+		{
+			tg.create_thread(put_ary_db(db, &ord[NUM_KEYS_PER_TH * i], NUM_KEYS_PER_TH));
+		}
+		tg.join_all();
+
+		const TPIOStat& st = db.tpio_()->stat();
+		EXPECT_LT(0U, st.nSyncBatch);
+		EXPECT_LE(st.nSyncBatch, st.nSyncBatchTx);
+	}
+
+	DB db("./_testtmp/mtgroupcommit", OPARTITIONED);
+	Buffer v(32);
+	for(int i = 0; i < NUM_KEYS; ++ i)
+	{
+		char bufCorrect[8];
+		sprintf(bufCorrect, "%u", i);
+
+		db.get_k32u(i, &v);
+		ASSERT_TRUE(v.isValid()) << "value not found for " << i;
+		v.makeNullTerm();
+		EXPECT_STREQ(bufCorrect, v.get()) << "incorrect val str for " << i;
+	}
+}
+
+TEST(ptnk, multithread_put_w_rebase)
+{
+	t_mktmpdir("./_testtmp");
+
+	const int NUM_KEYS = 8000;
+	const int NUM_THREADS = 4;
+	const int NUM_KEYS_PER_TH = NUM_KEYS / NUM_THREADS;
+	SETUP_ORD(NUM_KEYS);
+
+	{
+		DB db("./_testtmp/mtrebase", OWRITER | OCREATE | OTRUNCATE | OPARTITIONED);
+
+		// txs keep committing while rebase is in progress
+		volatile bool done = false;
+		std::thread thrRebase([&db, &done]() {
+			while(! done) db.rebase();
+		});
+
+		thread_group tg;
+		for(int i = 0; i < NUM_THREADS; ++ i)
+		{
+			tg.create_thread(put_ary_db(db, &ord[NUM_KEYS_PER_TH * i], NUM_KEYS_PER_TH));
+		}
+		tg.join_all();
+		done = true;
+		thrRebase.join();
+
+		EXPECT_LT(0U, db.tpio_()->stat().nRebase);
+
+		Buffer v(32);
+		for(int i = 0; i < NUM_KEYS; ++ i)
+		{
+			db.get_k32u(i, &v);
+			EXPECT_TRUE(v.isValid()) << "value not found for " << i;
+		}
+	}
+
+	// txs carried over to rebased generation must be restored
+	{
+		DB db("./_testtmp/mtrebase", OPARTITIONED);
+
+		Buffer v(32);
+		for(int i = 0; i < NUM_KEYS; ++ i)
+		{
+			char bufCorrect[8];
+			sprintf(bufCorrect, "%u", i);
+
+			db.get_k32u(i, &v);
+			EXPECT_TRUE(v.isValid()) << "value not found for " << i << " after reopen";
+			if(v.isValid())
+			{
+				v.makeNullTerm();
+				EXPECT_STREQ(bufCorrect, v.get()) << "incorrect val str for " << i << " after reopen";
+			}
+		}
+	}
+}
+
+TEST(ptnk, db_snapshot)
+{
+	t_mktmpdir("./_testtmp");
+
+	DB db("./_testtmp/snapshot", OWRITER | OCREATE | OTRUNCATE | OPARTITIONED);
+
+	db.put(cstr2ref("key"), cstr2ref("old"));
+
+	unique_ptr<DB::Snapshot> ss(db.newSnapshot());
+
+	db.put(cstr2ref("key"), cstr2ref("new"));
+	db.put(cstr2ref("key2"), cstr2ref("value2"));
+
+	Buffer v;
+	ss->get(cstr2ref("key"), &v);
+	v.makeNullTerm();
+	EXPECT_STREQ("old", v.get());
+
+	ss->get(cstr2ref("key2"), &v);
+	EXPECT_FALSE(v.isValid()) << "snapshot sees tx committed after its start";
+
+	// snapshot is kept intact across rebase
+	db.rebase();
+	ss->get(cstr2ref("key"), &v);
+	v.makeNullTerm();
+	EXPECT_STREQ("old", v.get());
+
+	ss.reset(db.newSnapshot());
+	ss->get(cstr2ref("key"), &v);
+	v.makeNullTerm();
+	EXPECT_STREQ("new", v.get());
+	ss->get(cstr2ref("key2"), &v);
+	v.makeNullTerm();
+	EXPECT_STREQ("value2", v.get());
+}
+
 TEST(ptnk, db_compactFast)
 {
 	t_mktmpdir("./_testtmp");
@@ -4444,6 +5294,497 @@ TEST(ptnk, capi_tx)
 	::ptnk_close(db);
 }
 
+TEST(ptnk, db_commit_async)
+{
+	t_mktmpdir("./_testtmp");
+
+	const int NUM_TXS = 100;
+	std::vector<std::shared_future<void> > durables;
+	{
+		DB db("./_testtmp/commitasync", OWRITER | OCREATE | OTRUNCATE | OPARTITIONED | OAUTOSYNC | OHELPERTHREAD);
+
+		for(int i = 0; i < NUM_TXS; ++ i)
+		{
+			unique_ptr<DB::Tx> tx(db.newTransaction());
+			tx->put_k32u(i, cstr2ref("async"));
+
+			std::shared_future<void> durable;
+			ASSERT_TRUE(tx->tryCommitAsync(&durable));
+			durables.push_back(durable);
+
+			// visible to txs started after the commit, even before it is durable
+			Buffer v;
+			db.get_k32u(i, &v);
+			v.makeNullTerm();
+			EXPECT_STREQ("async", v.get());
+		}
+		for(auto& durable: durables) durable.get();
+	}
+
+	DB db("./_testtmp/commitasync", OPARTITIONED);
+	for(int i = 0; i < NUM_TXS; ++ i)
+	{
+		Buffer v;
+		db.get_k32u(i, &v);
+		v.makeNullTerm();
+		EXPECT_STREQ("async", v.get());
+	}
+}
+
+TEST(ptnk, db_bounded_sync)
+{
+	t_mktmpdir("./_testtmp");
+
+	const int NUM_TXS = 100;
+	{
+		DB db("./_testtmp/boundedsync", OWRITER | OCREATE | OTRUNCATE | OPARTITIONED | OBOUNDEDSYNC | OHELPERTHREAD);
+		TPIO* tpio = db.tpio_();
+
+		// large interval so that only byte bound triggers flush
+		db.setSyncBound(60*1000, 16 * PTNK_PAGE_SIZE);
+
+		for(int i = 0; i < NUM_TXS; ++ i)
+		{
+			db.put_k32u(i, cstr2ref("bounded"));
+
+			BoundedSync::window_t w = tpio->unsyncedWindow();
+			EXPECT_GE(16 * PTNK_PAGE_SIZE, w.bytes);
+		}
+		EXPECT_LT(0U, tpio->stat().nBoundedFlush);
+		EXPECT_GE(16U * PTNK_PAGE_SIZE, tpio->stat().bytesUnsyncedMax);
+
+		// time bound: flusher thr flushes the window
+		db.setSyncBound(20, 1024 * PTNK_PAGE_SIZE);
+		db.put_k32u(NUM_TXS, cstr2ref("bounded"));
+		EXPECT_LT(0U, tpio->unsyncedWindow().nTx);
+		usleep(100 * 1000);
+		EXPECT_EQ(0U, tpio->unsyncedWindow().nTx);
+
+		// durable callback is called once the window is flushed
+		std::shared_future<void> durable;
+		{
+			unique_ptr<DB::Tx> tx(db.newTransaction());
+			tx->put_k32u(NUM_TXS+1, cstr2ref("bounded"));
+			ASSERT_TRUE(tx->tryCommitAsync(&durable));
+		}
+		durable.get();
+	}
+
+	DB db("./_testtmp/boundedsync", OPARTITIONED);
+	for(int i = 0; i < NUM_TXS+2; ++ i)
+	{
+		Buffer v;
+		db.get_k32u(i, &v);
+		v.makeNullTerm();
+		EXPECT_STREQ("bounded", v.get());
+	}
+}
+
+TEST(ptnk, db_bounded_sync_idle)
+{
+	t_mktmpdir("./_testtmp");
+
+	const unsigned int INTERVAL_MS = 50;
+	{
+		// no helper thr, and no commit follows: the window must be flushed anyway
+		DB db("./_testtmp/boundedsyncidle", OWRITER | OCREATE | OTRUNCATE | OPARTITIONED | OBOUNDEDSYNC);
+		TPIO* tpio = db.tpio_();
+		db.setSyncBound(INTERVAL_MS, 1024 * PTNK_PAGE_SIZE);
+
+		std::shared_future<void> durable;
+		{
+			unique_ptr<DB::Tx> tx(db.newTransaction());
+			tx->put_k32u(1, cstr2ref("idle"));
+			ASSERT_TRUE(tx->tryCommitAsync(&durable));
+		}
+		EXPECT_LT(0U, tpio->unsyncedWindow().nTx);
+
+		usleep(INTERVAL_MS * 1000);
+		EXPECT_EQ(0U, tpio->unsyncedWindow().nTx);
+		EXPECT_EQ(std::future_status::ready, durable.wait_for(std::chrono::milliseconds(0)));
+
+		const TPIOStat& st = tpio->stat();
+		EXPECT_LT(0U, st.nBoundedFlush);
+		EXPECT_EQ(0U, st.nBoundedFlushInline);
+		EXPECT_GE((uint64_t)INTERVAL_MS * NSEC_PER_MSEC, st.nsUnsyncedMax);
+	}
+
+	DB db("./_testtmp/boundedsyncidle", OPARTITIONED);
+	Buffer v;
+	db.get_k32u(1, &v);
+	v.makeNullTerm();
+	EXPECT_STREQ("idle", v.get());
+}
+
+TEST(ptnk, db_eager_writeback)
+{
+	t_mktmpdir("./_testtmp");
+
+	const int NUM_KEYS = 3000;
+	auto expected = [] (int i) { return i % 2 == 0 ? "overwritten" : "eager writeback"; };
+	{
+		DB db("./_testtmp/eagerwb", OWRITER | OCREATE | OTRUNCATE | OPARTITIONED | OAUTOSYNC);
+		db.setEagerWriteback(8);
+		db.setCheckpointOnClose(false); // restore txs from the log, incl. the pages left unstamped
+
+		unique_ptr<DB::Tx> tx(db.newTransaction());
+		for(int i = 0; i < NUM_KEYS; ++ i)
+		{
+			tx->put_k32u(i, cstr2ref("eager writeback"));
+		}
+		ASSERT_TRUE(tx->tryCommit());
+
+		// ovr pages written back early
+		tx.reset(db.newTransaction());
+		for(int i = 0; i < NUM_KEYS; i += 2)
+		{
+			tx->put_k32u(i, cstr2ref("overwritten"));
+		}
+		ASSERT_TRUE(tx->tryCommit());
+
+		const TPIOStat& st = db.tpio_()->stat();
+		EXPECT_LT(0U, st.nEagerWriteback);
+		EXPECT_LT(0U, st.nEagerWritebackPages);
+
+		// commit doesn't dirty the pages written back again
+		EXPECT_LT(0U, st.nEagerUnstampedPages);
+		EXPECT_LE(st.nEagerUnstampedPages, st.nEagerWritebackPages);
+	}
+
+	{
+		DB db("./_testtmp/eagerwb", OWRITER | OPARTITIONED | OAUTOSYNC);
+		db.setCheckpointOnClose(false);
+		for(int i = 0; i < NUM_KEYS; ++ i)
+		{
+			Buffer v;
+			db.get_k32u(i, &v);
+			v.makeNullTerm();
+			EXPECT_STREQ(expected(i), v.get());
+		}
+
+		// pages left unstamped must not be reused after reopen
+		for(int i = NUM_KEYS; i < NUM_KEYS + 100; ++ i)
+		{
+			db.put_k32u(i, cstr2ref("after reopen"));
+		}
+	}
+
+	DB db("./_testtmp/eagerwb", OPARTITIONED);
+	for(int i = 0; i < NUM_KEYS + 100; ++ i)
+	{
+		Buffer v;
+		db.get_k32u(i, &v);
+		v.makeNullTerm();
+		EXPECT_STREQ(i < NUM_KEYS ? expected(i) : "after reopen", v.get());
+	}
+}
+
+TEST(ptnk, db_checkpoint)
+{
+	t_mktmpdir("./_testtmp");
+
+	const int NUM_KEYS = 500;
+	{
+		DB db("./_testtmp/checkpoint", OWRITER | OCREATE | OTRUNCATE | OPARTITIONED | OAUTOSYNC);
+		for(int i = 0; i < NUM_KEYS; ++ i)
+		{
+			db.put_k32u(i, cstr2ref("ckpt"));
+		}
+	}
+
+	{
+		DB db("./_testtmp/checkpoint", OWRITER | OPARTITIONED | OAUTOSYNC);
+
+		// checkpoint is written at the log tail on close
+		PageIO* pio = db.tpio_()->backend();
+		EXPECT_EQ(PT_OVRCHECKPOINT, pio->readPage(pio->getLastPgId()).pageType());
+
+		for(int i = 0; i < NUM_KEYS; ++ i)
+		{
+			Buffer v;
+			db.get_k32u(i, &v);
+			v.makeNullTerm();
+			EXPECT_STREQ("ckpt", v.get());
+		}
+
+		// txs after the checkpoint are restored from the log (as if crashed)
+		for(int i = 0; i < NUM_KEYS; i += 2)
+		{
+			db.put_k32u(i, cstr2ref("tail"));
+		}
+		db.setCheckpointOnClose(false);
+	}
+
+	{
+		DB db("./_testtmp/checkpoint", OWRITER | OPARTITIONED | OAUTOSYNC);
+		for(int i = 0; i < NUM_KEYS; ++ i)
+		{
+			Buffer v;
+			db.get_k32u(i, &v);
+			v.makeNullTerm();
+			EXPECT_STREQ(i % 2 == 0 ? "tail" : "ckpt", v.get());
+		}
+
+		// no new checkpoint if nothing was committed since restore
+		PageIO* pio = db.tpio_()->backend();
+		const page_id_t pgidLast = pio->getLastPgId();
+		db.tpio_()->checkpoint();
+		EXPECT_EQ(pgidLast, pio->getLastPgId());
+
+		db.put_k32u(NUM_KEYS, cstr2ref("ckpt"));
+		db.tpio_()->checkpoint();
+		EXPECT_EQ(PT_OVRCHECKPOINT, pio->readPage(pio->getLastPgId()).pageType());
+	}
+
+	DB db("./_testtmp/checkpoint", OPARTITIONED);
+	for(int i = 0; i < NUM_KEYS; ++ i)
+	{
+		Buffer v;
+		db.get_k32u(i, &v);
+		v.makeNullTerm();
+		EXPECT_STREQ(i % 2 == 0 ? "tail" : "ckpt", v.get());
+	}
+}
+
+TEST(ptnk, db_restore_long_log)
+{
+	t_mktmpdir("./_testtmp");
+
+	// large txs spreading over the tree leave many pages w/ old links,
+	// so that their streaks span multiple pages
+	const int NUM_TXS = 16, NUM_PUTS_PER_TX = 2000;
+	const int NUM_KEYS = NUM_TXS * NUM_PUTS_PER_TX;
+	char value[100]; ::memset(value, 'v', sizeof(value));
+	{
+		DB db("./_testtmp/restorelong", OWRITER | OCREATE | OTRUNCATE | OPARTITIONED);
+		for(int i = 0; i < NUM_TXS; ++ i)
+		{
+			unique_ptr<DB::Tx> tx(db.newTransaction());
+			for(int j = 0; j < NUM_PUTS_PER_TX; ++ j)
+			{
+				const uint32_t k = j * NUM_TXS + i;
+				::memcpy(value, &k, sizeof(k));
+				tx->put_k32u(k, BufferCRef(value, sizeof(value)));
+			}
+			ASSERT_TRUE(tx->tryCommit());
+		}
+
+		// restore from the log only
+		db.setCheckpointOnClose(false);
+	}
+
+	DB db("./_testtmp/restorelong", OPARTITIONED);
+	for(uint32_t k = 0; k < (uint32_t)NUM_KEYS; ++ k)
+	{
+		ASSERT_EQ((ssize_t)sizeof(value), db.get_k32u(k, BufferRef(value, sizeof(value))));
+		uint32_t v; ::memcpy(&v, value, sizeof(v));
+		EXPECT_EQ(k, v);
+	}
+}
+
+TEST(ptnk, PagesOldLink_basic)
+{
+	PagesOldLink pol;
+	const page_id_t pgids[] = {5, 3, 10, 3, 7, 1, 10};
+	for(page_id_t pgid: pgids) pol.add(pgid);
+
+	const page_id_t expected[] = {1, 3, 5, 7, 10};
+	ASSERT_EQ(5U, pol.size());
+	EXPECT_TRUE(std::equal(pol.begin(), pol.end(), expected));
+	for(size_t i = 0; i < 5; ++ i)
+	{
+		EXPECT_TRUE(pol.contains(expected[i]));
+		EXPECT_EQ(i, pol.indexOf(expected[i]));
+	}
+	EXPECT_FALSE(pol.contains(4));
+	EXPECT_EQ((size_t)PagesOldLink::NPOS, pol.indexOf(4));
+	EXPECT_EQ((size_t)PagesOldLink::NPOS, pol.indexOf(11));
+
+	const page_id_t range[] = {12, 2, 7};
+	pol.addRange(range, range + 3);
+	const page_id_t expectedRange[] = {1, 2, 3, 5, 7, 10, 12};
+	ASSERT_EQ(7U, pol.size());
+	EXPECT_TRUE(std::equal(pol.begin(), pol.end(), expectedRange));
+
+	PagesOldLink a, b, c;
+	for(page_id_t pgid = 0; pgid < 100; pgid += 2) a.add(pgid);
+	for(page_id_t pgid = 0; pgid < 100; pgid += 3) b.add(pgid);
+	c.add(1000);
+
+	PagesOldLink m1;
+	m1.merge(a); m1.merge(b); m1.merge(c);
+
+	PagesOldLink m2;
+	std::vector<const PagesOldLink*> os = {&a, &b, &c};
+	m2.merge(os);
+
+	ASSERT_EQ(m1.size(), m2.size());
+	EXPECT_TRUE(std::equal(m1.begin(), m1.end(), m2.begin()));
+	EXPECT_TRUE(std::is_sorted(m2.begin(), m2.end()));
+	EXPECT_EQ(50U + 34U - 17U + 1U, m2.size());
+}
+
+namespace
+{
+
+struct BufferWriter
+{
+	Buffer* buf;
+
+	void write(BufferCRef b)
+	{
+		buf->append(b);
+	}
+};
+
+} // end of anonymous namespace
+
+TEST(ptnk, streak_compact)
+{
+	// varint round trip
+	{
+		const uint64_t vals[] = {0, 1, 127, 128, 300, 0xffffffffULL, ~0ULL};
+		Buffer buf; buf.reset();
+		for(uint64_t v: vals)
+		{
+			char b[VARINT_SIZE_MAX];
+			size_t len = varint_encode(b, v);
+			EXPECT_GE((size_t)VARINT_SIZE_MAX, len);
+			buf.append(BufferCRef(b, len));
+		}
+		EXPECT_EQ(1+1+1+2+2+5+10, buf.rref().size());
+
+		BufferCRef r = buf.rref();
+		for(uint64_t v: vals)
+		{
+			EXPECT_EQ(v, r.popFrontVarint());
+		}
+		EXPECT_TRUE(r.empty());
+	}
+
+	// PagesOldLink compact dump/restore
+	{
+		PagesOldLink pol;
+		for(local_pgid_t i = 0; i < 1000; ++ i)
+		{
+			pol.add(PGID_PARTLOCAL(i % 3, i * 7));
+		}
+
+		Buffer buf; buf.reset();
+		BufferWriter w = {&buf};
+		pol.dumpCompact(w);
+		// sorted deltas are small, so each pgid should take a few bytes at most
+		EXPECT_GT(1000U * 4, buf.rref().size());
+
+		PagesOldLink pol2;
+		BufferCRef r = buf.rref();
+		pol2.restoreCompact(r);
+		EXPECT_TRUE(r.empty());
+
+		std::ostringstream s1, s2;
+		s1 << pol; s2 << pol2;
+		EXPECT_EQ(s1.str(), s2.str());
+	}
+
+	// streak stats are counted on commit, and the db restores from compact streaks
+	t_mktmpdir("./_testtmp");
+	{
+		DB db("./_testtmp/streakcompact", OWRITER | OCREATE | OTRUNCATE | OPARTITIONED);
+		for(uint32_t i = 0; i < 10; ++ i)
+		{
+			unique_ptr<DB::Tx> tx(db.newTransaction());
+			for(uint32_t k = i; k < 10000; k += 10)
+			{
+				tx->put_k32u(k, BufferCRef(&k, sizeof(k)));
+			}
+			ASSERT_TRUE(tx->tryCommit());
+		}
+
+		const TPIOStat& st = db.tpio_()->stat();
+		EXPECT_LE(10U, st.nStreakTx);
+		EXPECT_LT(0U, st.bytesStreak);
+
+		db.setCheckpointOnClose(false);
+	}
+
+	DB db("./_testtmp/streakcompact", OPARTITIONED);
+	for(uint32_t k = 0; k < 10000; ++ k)
+	{
+		uint32_t v = ~0U;
+		ASSERT_EQ((ssize_t)sizeof(v), db.get_k32u(k, BufferRef(&v, sizeof(v))));
+		EXPECT_EQ(k, v);
+	}
+}
+
+static void
+capi_durable_cb(void* arg, int ok)
+{
+	if(ok) __sync_fetch_and_add(static_cast<int*>(arg), 1);
+}
+
+TEST(ptnk, capi_tx_async)
+{
+	t_mktmpdir("./_testtmp");
+
+	volatile int nDurable = 0;
+	{
+		ptnk_db_t* db = ::ptnk_open("./_testtmp/capi_tx_async.ptnk", OWRITER | OCREATE | OTRUNCATE | OAUTOSYNC | OHELPERTHREAD, 0644);
+		ASSERT_TRUE(db);
+
+		ptnk_tx_t* txA = ::ptnk_tx_begin(db);
+		ptnk_tx_t* txB = ::ptnk_tx_begin(db);
+
+		EXPECT_TRUE(::ptnk_tx_put_cstr(txA, "key", "value", PUT_INSERT));
+		EXPECT_TRUE(::ptnk_tx_put_cstr(txB, "key", "valueB", PUT_INSERT));
+		EXPECT_TRUE(::ptnk_tx_get_cstr(txB, "key"));
+
+		EXPECT_NE(0, ::ptnk_tx_end_async(txA, capi_durable_cb, (void*)&nDurable)) << "txA failed";
+		EXPECT_STREQ("value", ::ptnk_get_cstr(db, "key"));
+
+		// conflicting tx fails w/o the callback called
+		EXPECT_EQ(0, ::ptnk_tx_end_async(txB, capi_durable_cb, (void*)&nDurable));
+
+		// pending syncs are completed on close
+		::ptnk_close(db);
+	}
+	EXPECT_EQ(1, nDurable);
+}
+
+TEST(ptnk, capi_snapshot)
+{
+	t_mktmpdir("./_testtmp");
+
+	ptnk_db_t* db = ::ptnk_open("./_testtmp/capi_snapshot.ptnk", ODEFAULT, 0644);
+	ASSERT_TRUE(db);
+
+	EXPECT_TRUE(::ptnk_put_cstr(db, "key", "value", PUT_INSERT));
+
+	ptnk_snapshot_t* ss = ::ptnk_snapshot_begin(db);
+	ASSERT_TRUE(ss);
+
+	EXPECT_TRUE(::ptnk_put_cstr(db, "key2", "value2", PUT_INSERT));
+
+	{
+		ptnk_datum_t k = {(char*)"key", 3};
+		ptnk_datum_t v = ::ptnk_snapshot_get(ss, k);
+		EXPECT_EQ(5, v.dsize);
+
+		EXPECT_STREQ("value", ::ptnk_snapshot_get_cstr(ss, "key"));
+	}
+
+	// record put after snapshot began is not visible
+	EXPECT_STREQ(NULL, ::ptnk_snapshot_get_cstr(ss, "key2"));
+	EXPECT_EQ(0, ::ptnk_snapshot_error(ss));
+
+	::ptnk_snapshot_end(ss);
+
+	ss = ::ptnk_snapshot_begin(db);
+	EXPECT_STREQ("value2", ::ptnk_snapshot_get_cstr(ss, "key2"));
+	::ptnk_snapshot_end(ss);
+
+	::ptnk_close(db);
+}
+
 TEST(ptnk, capi_table)
 {
 	t_mktmpdir("./_testtmp");
@@ -30,18 +30,158 @@ TEST(ptnk, stm_localovr)
 	EXPECT_EQ((page_id_t)3, lo->searchOvr(1).first);
 }
 
+//! find pgids landing on the same OvrHash slot as pgid 0 (in any table of up to 2^16 slots)
+static void
+t_colliding_pgids(page_id_t pgids[], int n)
+{
+	const uint64_t MASK = 0xffff;
+	const uint64_t h0 = hashs(0) & MASK;
+
+	pgids[0] = 0;
+	int i = 1;
+	for(page_id_t pgid = 1; i < n; ++ pgid)
+	{
+		if((hashs(pgid) & MASK) == h0) pgids[i++] = pgid;
+	}
+}
+
 TEST(ptnk, stm_hash_collision)
 {
 	ActiveOvr ao;
 
+	page_id_t pgids[3]; t_colliding_pgids(pgids, 3);
+
 	std::unique_ptr<LocalOvr> lo(ao.newTx());
-	lo->addOvr(0, 1);
-	lo->addOvr(0 + TPIO_NHASH, 2);
-	lo->addOvr(0 + TPIO_NHASH*2, 3);
+	lo->addOvr(pgids[0], 1);
+	lo->addOvr(pgids[1], 2);
+	lo->addOvr(pgids[2], 3);
 	
-	EXPECT_EQ((page_id_t)1, lo->searchOvr(0).first);
-	EXPECT_EQ((page_id_t)2, lo->searchOvr(0 + TPIO_NHASH).first);
-	EXPECT_EQ((page_id_t)3, lo->searchOvr(0 + TPIO_NHASH*2).first);
+	EXPECT_EQ((page_id_t)1, lo->searchOvr(pgids[0]).first);
+	EXPECT_EQ((page_id_t)2, lo->searchOvr(pgids[1]).first);
+	EXPECT_EQ((page_id_t)3, lo->searchOvr(pgids[2]).first);
+}
+
+TEST(ptnk, stm_ovrhash_grow)
+{
+	const int NUM_PGIDS = 10000;
+
+	OvrHash h;
+	std::vector<OvrEntry> es(NUM_PGIDS);
+	for(int i = 0; i < NUM_PGIDS; ++ i)
+	{
+		es[i].pgidOrig = i * OvrHash::NSLOTS_MIN;
+		es[i].pgidOvr = i;
+
+		h.reserve(h.size() + 1);
+		h.push(&es[i]);
+	}
+	EXPECT_EQ((size_t)NUM_PGIDS, h.size());
+	EXPECT_LE((size_t)NUM_PGIDS * 2, h.nslots());
+
+	for(int i = 0; i < NUM_PGIDS; ++ i)
+	{
+		OvrEntry* e = h.head(i * OvrHash::NSLOTS_MIN);
+		ASSERT_TRUE(e);
+		EXPECT_EQ((page_id_t)i, e->pgidOvr);
+		EXPECT_FALSE(e->prev);
+	}
+	EXPECT_FALSE(h.head(1));
+
+	h.erase(0);
+	EXPECT_FALSE(h.head(0));
+	EXPECT_TRUE(h.head(OvrHash::NSLOTS_MIN));
+}
+
+TEST(ptnk, stm_ovrhash_concurrent)
+{
+	const int NUM_THREADS = 8;
+	const int NUM_PGIDS = 20000;
+
+	OvrHash h;
+	std::vector<OvrEntry> es(NUM_PGIDS);
+	for(int i = 0; i < NUM_PGIDS; ++ i)
+	{
+		es[i].pgidOrig = i;
+		es[i].pgidOvr = i + 1;
+		es[i].ver = 1;
+	}
+
+	// all thrs push all entries in different order, while the table grows
+	std::vector<std::thread> thrs;
+	for(int t = 0; t < NUM_THREADS; ++ t)
+	{
+		thrs.push_back(std::thread([&h, &es, t]() {
+			for(int i = 0; i < NUM_PGIDS; ++ i)
+			{
+				h.push(&es[(i * 7 + t * 1000) % NUM_PGIDS]);
+			}
+		}));
+	}
+	for(auto& t: thrs) t.join();
+
+	EXPECT_EQ((size_t)NUM_PGIDS, h.size());
+	for(int i = 0; i < NUM_PGIDS; ++ i)
+	{
+		OvrEntry* e = h.head(i);
+		ASSERT_EQ(&es[i], e);
+		EXPECT_FALSE(e->prev);
+	}
+}
+
+TEST(ptnk, stm_bloomfilter)
+{
+	PgidBloomFilter a, b;
+
+	for(page_id_t pgid = 0; pgid < 1000; ++ pgid)
+	{
+		if(a.needRebuild(pgid + 1))
+		{
+			a.resize(pgid + 1);
+			for(page_id_t p = 0; p < pgid; ++ p) a.add(p * 2);
+		}
+		a.add(pgid * 2);
+	}
+	EXPECT_LE((size_t)1000 * PgidBloomFilter::BITS_PER_ENTRY, a.nbits());
+
+	// no false negatives
+	int nFalsePositive = 0;
+	for(page_id_t pgid = 0; pgid < 1000; ++ pgid)
+	{
+		EXPECT_TRUE(a.mayContain(pgid * 2));
+		if(a.mayContain(pgid * 2 + 1)) ++ nFalsePositive;
+	}
+	EXPECT_GT(100, nFalsePositive);
+
+	// filter-vs-filter w/ different sizes
+	b.add(12345678);
+	EXPECT_TRUE(b.mayContain(12345678));
+	EXPECT_FALSE(b.mayContain(1));
+	b.add(10);
+	EXPECT_TRUE(a.mayContain(b));
+	EXPECT_TRUE(b.mayContain(a));
+
+	PgidBloomFilter c, d;
+	c.add(1); d.add(3);
+	EXPECT_FALSE(c.mayContain(d));
+
+	// filters of small txs w/o common pgid are mostly told apart,
+	// while ones w/ common pgid never are
+	int nDisjoint = 0;
+	for(page_id_t base = 0; base < 1000 * 8; base += 8)
+	{
+		PgidBloomFilter e, f, g;
+		for(page_id_t pgid = base; pgid < base + 4; ++ pgid)
+		{
+			e.add(pgid);
+			f.add(pgid + 4);
+			g.add(pgid + 4);
+		}
+		g.add(base);
+
+		if(! e.mayContain(f)) ++ nDisjoint;
+		EXPECT_TRUE(e.mayContain(g));
+	}
+	EXPECT_LT(800, nDisjoint);
 }
 
 TEST(ptnk, stm_basic)
@@ -86,6 +226,24 @@ TEST(ptnk, stm_basic)
 		EXPECT_FALSE(lo.get());
 	}
 
+	// conflicting tx should fail (many ovrs per tx, filter rebuilt)
+	{
+		std::unique_ptr<LocalOvr> a(ao.newTx());
+		std::unique_ptr<LocalOvr> b(ao.newTx());
+
+		for(page_id_t pgid = 1000; pgid < 2000; ++ pgid)
+		{
+			a->addOvr(pgid, pgid + 10000);
+			b->addOvr(pgid + 1000, pgid + 20000);
+		}
+		b->addOvr(1999, 30000);
+
+		ao.tryCommit(a);
+		EXPECT_FALSE(a.get());
+		ao.tryCommit(b);
+		EXPECT_TRUE(b.get());
+	}
+
 	// conflicting tx should fail
 	{
 		std::unique_ptr<LocalOvr> a(ao.newTx());
@@ -104,15 +262,42 @@ TEST(ptnk, stm_basic)
 	}
 }
 
+TEST(ptnk, stm_arena)
+{
+	OvrArena arena;
+	OvrArena::Stat stat;
+
+	std::vector<char*> ps;
+	for(int i = 0; i < 10000; ++ i)
+	{
+		char* p = reinterpret_cast<char*>(arena.alloc(24, &stat));
+		EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(p) % 8);
+		::memset(p, i & 0xff, 24);
+		ps.push_back(p);
+	}
+	// larger than chunk
+	::memset(arena.alloc(OvrArena::CHUNK_SIZE * 2, &stat), 0, OvrArena::CHUNK_SIZE * 2);
+
+	for(int i = 0; i < 10000; ++ i)
+	{
+		EXPECT_EQ((char)(i & 0xff), ps[i][23]);
+	}
+	EXPECT_EQ(10001u, stat.nAlloc);
+	EXPECT_EQ(arena.numChunks(), stat.nChunkAlloc);
+	EXPECT_GT(10u, stat.nChunkAlloc);
+}
+
 TEST(ptnk, stm_hash_collision_ci)
 {
 	ActiveOvr ao;
 
+	page_id_t pgids[3]; t_colliding_pgids(pgids, 3);
+
 	{
 		std::unique_ptr<LocalOvr> lo(ao.newTx());
-		lo->addOvr(0, 1);
-		lo->addOvr(0 + TPIO_NHASH, 2);
-		lo->addOvr(0 + TPIO_NHASH*2, 3);
+		lo->addOvr(pgids[0], 1);
+		lo->addOvr(pgids[1], 2);
+		lo->addOvr(pgids[2], 3);
 		
 		ao.tryCommit(lo);
 		EXPECT_FALSE(lo.get());
@@ -120,9 +305,9 @@ TEST(ptnk, stm_hash_collision_ci)
 
 	{
 		std::unique_ptr<LocalOvr> lo(ao.newTx());
-		EXPECT_EQ((page_id_t)1, lo->searchOvr(0).first);
-		EXPECT_EQ((page_id_t)2, lo->searchOvr(0 + TPIO_NHASH).first);
-		EXPECT_EQ((page_id_t)3, lo->searchOvr(0 + TPIO_NHASH*2).first);
+		EXPECT_EQ((page_id_t)1, lo->searchOvr(pgids[0]).first);
+		EXPECT_EQ((page_id_t)2, lo->searchOvr(pgids[1]).first);
+		EXPECT_EQ((page_id_t)3, lo->searchOvr(pgids[2]).first);
 	}
 }
 